@@ -5,623 +5,230 @@
 #include "apply.h"
 #include "parse.h"
 #include "proof.h"
+#include "schema.h"
+#include "syntax.h"
 
-#define INVINP()\
-	snprintf(p->errbuf, sizeof(p->errbuf), "invalid rule inputs");
+/*
+ * The natural deduction rules, as schemas. Names are metavariables,
+ * [A ... B] is a box from A to B and ?A is a formula given as input.
+ */
+// *INDENT-OFF*
+static const struct {
+	int rule;
+	const char *schema;
+} builtins[] = {
+	{ RULE_NOT_INTR,     "[A ... " CON_STR "] |- " NOT_STR "A" },
+	{ RULE_NOT_ELIM,     "A, " NOT_STR "A |- " CON_STR },
+	{ RULE_AND_INTR,     "A, B |- A " AND_STR " B" },
+	{ RULE_AND_ELIM_1,   "A " AND_STR " B |- A" },
+	{ RULE_AND_ELIM_2,   "A " AND_STR " B |- B" },
+	{ RULE_OR_INTR_1,    "A, ?B |- A " OR_STR " B" },
+	{ RULE_OR_INTR_2,    "?A, B |- A " OR_STR " B" },
+	{ RULE_OR_ELIM,      "A " OR_STR " B, [A ... C], [B ... C] |- C" },
+	{ RULE_IMPL_INTR,    "[A ... B] |- A " IMPL_STR " B" },
+	{ RULE_IMPL_ELIM,    "A, A " IMPL_STR " B |- B" },
+	{ RULE_CON_ELIM,     CON_STR ", ?A |- A" },
+	{ RULE_NOT_NOT_INTR, "A |- " NOT_STR NOT_STR "A" },
+	{ RULE_NOT_NOT_ELIM, NOT_STR NOT_STR "A |- A" },
+	{ RULE_MT,           "A " IMPL_STR " B, " NOT_STR "B |- " NOT_STR "A" },
+	{ RULE_PBC,          "[" NOT_STR "A ... " CON_STR "] |- A" },
+	{ RULE_LEM,          "?A |- A " OR_STR " " NOT_STR "A" },
+	{ RULE_COPY,         "A |- A" },
+};
+// *INDENT-ON*
 
-static int apply_not_intr(struct proof *p, struct ast *cmd)
-{
-	struct ast *in, *out;
-	struct box *box;
-
-	in = cmd->rhs;
-	if (!in || in->type != INPUT_BOX) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_box(p, in->start, in->end))
-		return 0;
-
-	box = get_box_with_range(p, in->start, in->end);
-
-	if (!box || p->lns[box->end].form->type != FORM_CON) {
-		return INVINP();
-		return 0;
-	}
+struct named {
+	char *name;
+	struct schema *schema;
+	struct named *next;
+};
 
-	in = p->lns[in->start].form;
+static struct schema *rules[RULE_NAMED];
+static struct named *named = NULL;
+static int initialized = 0;
 
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_NOT;
-	out->lhs = ast_copy(in);
-
-	pushln(p, cmd, out);
-	return 1;
-}
+/* The builtin rules as compiled, whatever is loaded over them. */
+static struct schema *builtin_rules[RULE_NAMED];
+static int builtin_only = 0;
+static uint64_t loaded_hash = 0;
 
-static int apply_not_elim(struct proof *p, struct ast *cmd)
+void apply_init(void)
 {
-	struct ast *in1, *in2, *out;
-
-	in1 = cmd->rhs;
-
-	if (!in1 || in1->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	in2 = in1->rhs;
-
-	if (!in2 || in2->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, in1->start)
-	    || !can_ref_ln(p, in2->start)) {
-		return 0;
-	}
+	char errbuf[128];
+	size_t n = sizeof(builtins) / sizeof(builtins[0]);
 
-	in1 = p->lns[in1->start].form;
-	in2 = p->lns[in2->start].form;
+	if (initialized)
+		return;
 
-	if (in2->type != FORM_NOT || !ast_equal(in1, in2->lhs)) {
-		INVINP();
-		return 0;
+	for (size_t i = 0; i < n; i++) {
+		rules[builtins[i].rule] =
+		    schema_compile(builtins[i].schema, errbuf, sizeof(errbuf));
+		assert(rules[builtins[i].rule] && "invalid builtin schema");
+		builtin_rules[builtins[i].rule] =
+		    schema_compile(builtins[i].schema, errbuf, sizeof(errbuf));
 	}
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_CON;
-	pushln(p, cmd, out);
-	return 1;
+	initialized = 1;
 }
 
-static int apply_and_intr(struct proof *p, struct ast *cmd)
+static struct named **find_named(const char *name)
 {
-	struct ast *lhs, *rhs, *res;
-
-	lhs = cmd->rhs;
-
-	if (!lhs || lhs->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	rhs = lhs->rhs;
+	struct named **n;
 
-	if (!rhs || rhs->type != INPUT_LINE) {
-		INVINP();
-		return 0;
+	for (n = &named; *n; n = &(*n)->next) {
+		if (strcmp((*n)->name, name) == 0)
+			break;
 	}
-
-	if (!can_ref_ln(p, rhs->start)
-	    || !can_ref_ln(p, lhs->start))
-		return 0;
-
-	lhs = p->lns[lhs->start].form;
-	rhs = p->lns[rhs->start].form;
-
-	lhs = ast_copy(lhs);
-	rhs = ast_copy(rhs);
-
-	res = calloc(1, sizeof(*res));
-	res->type = FORM_AND;
-	res->lhs = lhs;
-	res->rhs = rhs;
-
-	pushln(p, cmd, res);
-
-	return 1;
+	return n;
 }
-
-static int apply_and_elim_1(struct proof *p, struct ast *cmd)
+
+struct schema *apply_find_rule(struct ast *rule)
 {
-	struct ast *in, *out;
-
-	in = cmd->rhs;
-	if (!in || in->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, in->start))
-		return 0;
-
-	in = p->lns[in->start].form;
+	struct named *n;
+
+	if (!initialized)
+		apply_init();
+
+	if (builtin_only)
+		return rule->type != RULE_NAMED ? builtin_rules[rule->type]
+		    : NULL;
+	if (rule->type != RULE_NAMED)
+		return rules[rule->type];
 
-	if (in->type != FORM_AND) {
-		INVINP();
-		return 0;
-	}
-
-	out = ast_copy(in->lhs);
-	pushln(p, cmd, out);
-	return 1;
+	n = *find_named(rule->text);
+	return n ? n->schema : NULL;
 }
 
-static int apply_and_elim_2(struct proof *p, struct ast *cmd)
+/*
+ * Restricts rules to the builtin ones while on, ignoring those loaded
+ * from files. Lemma proofs are checked this way, so no unsound rule
+ * can prove them.
+ */
+void apply_builtin_only(int on)
 {
-	struct ast *in, *out;
-
-	in = cmd->rhs;
-	if (!in || in->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, in->start))
-		return 0;
-
-	in = p->lns[in->start].form;
-
-	if (in->type != FORM_AND) {
-		INVINP();
-		return 0;
-	}
-
-	out = ast_copy(in->rhs);
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_or_intr_1(struct proof *p, struct ast *cmd)
-{
-	struct ast *lhs, *rhs, *out;
-
-	lhs = cmd->rhs;
-
-	if (!lhs || lhs->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	rhs = lhs->rhs;
-
-	if (!rhs || rhs->type != INPUT_FORM) {
-		INVINP();
-		return 0;
-	}
-
-	rhs = rhs->lhs;
-
-	if (!can_ref_ln(p, lhs->start)) {
-		return 0;
-	}
-
-	lhs = p->lns[lhs->start].form;
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_OR;
-	out->lhs = lhs;
-	out->rhs = rhs;
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_or_intr_2(struct proof *p, struct ast *cmd)
-{
-	struct ast *lhs, *rhs, *out;
-
-	lhs = cmd->rhs;
-
-	if (!lhs || lhs->type != INPUT_FORM) {
-		INVINP();
-		return 0;
-	}
-
-	rhs = lhs->rhs;
-	lhs = lhs->lhs;
-
-	if (!rhs || rhs->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, rhs->start)) {
-		return 0;
-	}
-
-	rhs = p->lns[rhs->start].form;
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_OR;
-	out->lhs = lhs;
-	out->rhs = rhs;
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_or_elim(struct proof *p, struct ast *cmd)
-{
-	struct ast *in1, *in2, *in3, *out;
-	struct box *box1, *box2;
-
-	in1 = cmd->rhs;
-
-	if (!in1 || in1->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	in2 = in1->rhs;
-
-	if (!in2 || in2->type != INPUT_BOX) {
-		INVINP();
-		return 0;
-	}
-
-	in3 = in2->rhs;
-
-	if (!in3 || in3->type != INPUT_BOX) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_box(p, in2->start, in2->end)
-	    || !can_ref_box(p, in3->start, in3->end)) {
-		return 0;
-	}
-
-	in1 = p->lns[in1->start].form;
-
-	if (in1->type != FORM_OR) {
-		INVINP();
-		return 0;
-	}
-
-	box1 = get_box_with_range(p, in2->start, in2->end);
-	box2 = get_box_with_range(p, in3->start, in3->end);
-
-	if (!box1 || !box2) {
-		INVINP();
-		return 0;
-	}
-
-	int match = 1;
-	match &= ast_equal(in1->lhs, p->lns[box1->start].form);
-	match &= ast_equal(in1->rhs, p->lns[box2->start].form);
-	match &= ast_equal(p->lns[box1->end].form, p->lns[box2->end].form);
-	if (!match) {
-		INVINP();
-		return 0;
-	}
-
-	out = ast_copy(p->lns[box1->end].form);
-	pushln(p, cmd, out);
-	return 1;
+	builtin_only = on;
 }
 
-static int apply_impl_intr(struct proof *p, struct ast *cmd)
+static uint64_t fold(uint64_t h, const char *str)
 {
-	struct ast *in, *lhs, *rhs, *out;
-	struct box *box;
-
-	in = cmd->rhs;
-
-	if (!in || in->type != INPUT_BOX) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_box(p, in->start, in->end))
-		return 0;
-
-	box = get_box_with_range(p, in->start, in->end);
-	if (!box) {
-		INVINP();
-		return 0;
-	}
-
-	lhs = p->lns[box->start].form;
-	rhs = p->lns[box->end].form;
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_IMPL;
-	out->lhs = ast_copy(lhs);
-	out->rhs = ast_copy(rhs);
-
-	pushln(p, cmd, out);
-	return 1;
+	for (; *str; str++)
+		h = (h ^ (unsigned char)*str) * 0x100000001b3ULL;
+	return (h ^ '\n') * 0x100000001b3ULL;
 }
 
-static int apply_impl_elim(struct proof *p, struct ast *cmd)
+/*
+ * Registers a rule under the given name, replacing any rule of that name.
+ * Names of builtin rules rebind the builtin. text is the source of the
+ * schema.
+ */
+void apply_add_rule(const char *name, const char *text, struct schema *s)
 {
-	struct ast *in1, *in2, *out;
-
-	in1 = cmd->rhs;
+	struct named **n;
+	int type;
 
-	if (!in1 || in1->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
+	apply_init();
+	loaded_hash = fold(fold(loaded_hash, name), text);
 
-	in2 = in1->rhs;
-
-	if (!in2 || in2->type != INPUT_LINE) {
-		INVINP();
-		return 0;
+	type = rule_type(name);
+	if (type != RULE_NAMED) {
+		schema_destroy(rules[type]);
+		rules[type] = s;
+		return;
 	}
 
-	in1 = p->lns[in1->start].form;
-	in2 = p->lns[in2->start].form;
-
-	if (in2->type != FORM_IMPL || !ast_equal(in1, in2->lhs)) {
-		INVINP();
-		return 0;
+	n = find_named(name);
+	if (*n) {
+		schema_destroy((*n)->schema);
+		(*n)->schema = s;
+		return;
 	}
 
-	out = ast_copy(in2->rhs);
-	pushln(p, cmd, out);
-	return 1;
+	*n = calloc(1, sizeof(**n));
+	(*n)->name = strdup(name);
+	(*n)->schema = s;
 }
 
-static int apply_con_elim(struct proof *p, struct ast *cmd)
+/*
+ * Loads rules from a file with one "name: schema" per line. Blank lines
+ * and lines starting with '#' are ignored.
+ */
+int apply_load_rules(const char *path, char *errbuf, size_t errbufsz)
 {
-	struct ast *in1, *in2, *out;
-
-	in1 = cmd->rhs;
+	char *line = NULL, *c, *colon;
+	char serr[128];
+	struct schema *s;
+	size_t cap = 0;
+	int lnum = 0;
+	FILE *f;
 
-	if (!in1 || in1->type != INPUT_LINE) {
-		INVINP();
+	f = fopen(path, "r");
+	if (!f) {
+		snprintf(errbuf, errbufsz, "%s: unable to read file", path);
 		return 0;
 	}
 
-	if (!can_ref_ln(p, in1->start))
-		return 0;
-
-	in2 = in1->rhs;
-
-	if (!in2 || in2->type != INPUT_FORM) {
-		INVINP();
-		return 0;
-	}
+	while (getline(&line, &cap, f) > 0) {
+		lnum++;
+		line[strcspn(line, "\r\n")] = 0;
+		for (c = line; *c == ' ' || *c == '\t'; c++) ;
+		if (!*c || *c == '#')
+			continue;
 
-	in1 = p->lns[in1->start].form;
-	in2 = in2->lhs;
+		colon = strchr(c, ':');
+		if (!colon) {
+			snprintf(errbuf, errbufsz, "%s:%d: expected name: schema",
+				 path, lnum);
+			goto err;
+		}
+		*colon = 0;
+		c[strcspn(c, " \t")] = 0;
 
-	if (in1->type != FORM_CON) {
-		INVINP();
-		return 0;
+		s = schema_compile(colon + 1, serr, sizeof(serr));
+		if (!s) {
+			snprintf(errbuf, errbufsz, "%s:%d: %s", path, lnum,
+				 serr);
+			goto err;
+		}
+		apply_add_rule(c, colon + 1, s);
 	}
 
-	out = ast_copy(in2);
-	pushln(p, cmd, out);
+	free(line);
+	fclose(f);
 	return 1;
-}
-
-static int apply_not_not_intr(struct proof *p, struct ast *cmd)
-{
-	struct ast *in, *not, *out;
-
-	in = cmd->rhs;
-
-	if (!in || in->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, in->start))
-		return 0;
-
-	in = ast_copy(p->lns[in->start].form);
 
-	not = calloc(1, sizeof(*not));
-	not->type = FORM_NOT;
-	not->lhs = in;
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_NOT;
-	out->lhs = not;
-
-	pushln(p, cmd, out);
-	return 1;
+ err:
+	free(line);
+	fclose(f);
+	return 0;
 }
 
-static int apply_not_not_elim(struct proof *p, struct ast *cmd)
+/* Identifies the rules added at runtime, for keying cached verdicts. */
+uint64_t apply_rules_hash(void)
 {
-	struct ast *target, *form;
-
-	target = cmd->rhs;
-
-	if (!target || target->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, target->start))
-		return 0;
-
-	form = p->lns[target->start].form;
-
-	if (form->type != FORM_NOT) {
-		INVINP();
-		return 0;
-	}
-
-	form = form->lhs;
-
-	if (form->type != FORM_NOT) {
-		INVINP();
-		return 0;
-	}
-
-	form = form->lhs;
-
-	pushln(p, cmd, ast_copy(form));
-	return 1;
+	return loaded_hash;
 }
 
-static int apply_mt(struct proof *p, struct ast *cmd)
-{
-	struct ast *in1, *in2, *out;
-
-	in1 = cmd->rhs;
-
-	if (!in1 || in1->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	in2 = in1->rhs;
-
-	if (!in2 || in2->type != INPUT_LINE) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_ln(p, in1->start)
-	    || !can_ref_ln(p, in2->start)) {
-		return 0;
-	}
-
-	in1 = p->lns[in1->start].form;
-	in2 = p->lns[in2->start].form;
-
-	if (in1->type != FORM_IMPL || in2->type != FORM_NOT) {
-		INVINP();
-		return 0;
-	}
-
-	if (!ast_equal(in2->lhs, in1->rhs)) {
-		INVINP();
-		return 0;
-	}
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_NOT;
-	out->lhs = ast_copy(in1->lhs);
-
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_pbc(struct proof *p, struct ast *cmd)
+int apply_rule(struct proof *p, struct ast *cmd)
 {
-	struct ast *in, *not, *out;
-	struct box *box;
-
-	in = cmd->rhs;
-
-	if (!in || in->type != INPUT_BOX) {
-		INVINP();
-		return 0;
-	}
-
-	if (!can_ref_box(p, in->start, in->end))
-		return 0;
-
-	box = get_box_with_range(p, in->start, in->end);
-	if (!box) {
-		INVINP();
-		return 0;
-	}
+	struct schema *s;
 
-	if (p->lns[box->end].form->type != FORM_CON) {
-		INVINP();
-		return 0;
-	}
-
-	not = p->lns[box->start].form;
-	if (not->type != FORM_NOT) {
-		INVINP();
-		return 0;
-	}
-
-	out = ast_copy(not->lhs);
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_lem(struct proof *p, struct ast *cmd)
-{
-	struct ast *in, *not, *out;
+	assert(cmd->type == CMD_APPLY);
 
-	in = cmd->rhs;
+	p->err = ERR_OK;
+	p->errbuf[0] = 0;
 
-	if (!in || in->type != INPUT_FORM) {
-		INVINP();
+	if (!check_deadline(p))
 		return 0;
-	}
-
-	in = ast_copy(in->lhs);
 
-	not = calloc(1, sizeof(*not));
-	not->type = FORM_NOT;
-	not->lhs = ast_copy(in);
-
-	out = calloc(1, sizeof(*out));
-	out->type = FORM_OR;
-	out->lhs = in;
-	out->rhs = not;
-
-	pushln(p, cmd, out);
-	return 1;
-}
-
-static int apply_copy(struct proof *p, struct ast *cmd)
-{
-	struct ast *in, *out;
-
-	in = cmd->rhs;
-
-	if (!in || in->type != INPUT_LINE) {
-		INVINP();
+	s = apply_find_rule(cmd->lhs);
+	if (!s) {
+		p->err = ERR_INPUTS;
+		snprintf(p->errbuf, sizeof(p->errbuf), "unknown rule %s",
+			 cmd->lhs->text);
 		return 0;
 	}
 
-	if (!can_ref_ln(p, in->start))
+	if (!cmd->rhs && s->nslots && !schema_infer(s, p, cmd))
 		return 0;
 
-	in = p->lns[in->start].form;
-
-	out = ast_copy(in);
-	pushln(p, cmd, out);
-	return 1;
-}
-
-int apply_rule(struct proof *p, struct ast *cmd)
-{
-	assert(cmd->type == CMD_APPLY);
-
-	p->errbuf[0] = 0;
-
-	switch (cmd->lhs->type) {
-	case RULE_NOT_INTR:
-		return apply_not_intr(p, cmd);
-	case RULE_NOT_ELIM:
-		return apply_not_elim(p, cmd);
-	case RULE_AND_INTR:
-		return apply_and_intr(p, cmd);
-	case RULE_AND_ELIM_1:
-		return apply_and_elim_1(p, cmd);
-	case RULE_AND_ELIM_2:
-		return apply_and_elim_2(p, cmd);
-	case RULE_OR_INTR_1:
-		return apply_or_intr_1(p, cmd);
-	case RULE_OR_INTR_2:
-		return apply_or_intr_2(p, cmd);
-	case RULE_OR_ELIM:
-		return apply_or_elim(p, cmd);
-	case RULE_IMPL_INTR:
-		return apply_impl_intr(p, cmd);
-	case RULE_IMPL_ELIM:
-		return apply_impl_elim(p, cmd);
-	case RULE_CON_ELIM:
-		return apply_con_elim(p, cmd);
-	case RULE_NOT_NOT_INTR:
-		return apply_not_not_intr(p, cmd);
-	case RULE_NOT_NOT_ELIM:
-		return apply_not_not_elim(p, cmd);
-	case RULE_MT:
-		return apply_mt(p, cmd);
-	case RULE_PBC:
-		return apply_pbc(p, cmd);
-	case RULE_LEM:
-		return apply_lem(p, cmd);
-	case RULE_COPY:
-		return apply_copy(p, cmd);
-	default:
-		assert(0 && "invalid rule");
-	}
+	return schema_apply(s, p, cmd);
 }
@@ -1,8 +1,17 @@
 #ifndef APPLY_H
 #define APPLY_H
 
+#include <stdint.h>
 #include "proof.h"
 
+struct schema;
+
+void apply_init(void);
+int apply_load_rules(const char *path, char *errbuf, size_t errbufsz);
+void apply_add_rule(const char *name, const char *text, struct schema *s);
+struct schema *apply_find_rule(struct ast *rule);
+void apply_builtin_only(int on);
+uint64_t apply_rules_hash(void);
 int apply_rule(struct proof *p, struct ast *cmd);
 
 #endif
@@ -0,0 +1,580 @@
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "cache.h"
+#include "spec.h"
+#include "proof.h"
+#include "parse.h"
+#include "apply.h"
+#include "valid.h"
+#include "sat.h"
+#include "cnf.h"
+#include "bdd.h"
+
+struct specent {
+	char *path;
+	struct spec *spec;
+	struct specent *next;
+};
+
+static char *read_file(const char *path, size_t *length)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t cap = 0, n = 0, r;
+
+	f = fopen(path, "r");
+	if (!f)
+		return NULL;
+
+	do {
+		if (n == cap) {
+			cap = cap ? 2 * cap : 4096;
+			buf = realloc(buf, cap);
+		}
+		r = fread(buf + n, 1, cap - n, f);
+		n += r;
+	} while (r);
+
+	fclose(f);
+	*length = n;
+	return buf;
+}
+
+static double now_usec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void json_str(const char *str, size_t len)
+{
+	putchar('"');
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+static void json_report(void *arg, const struct lnresult *r)
+{
+	size_t len = r->textlen;
+
+	while (len && (r->text[len - 1] == ' ' || r->text[len - 1] == '\t'
+		       || r->text[len - 1] == '\r'))
+		len--;
+
+	printf("{\"proof\":");
+	json_str(arg, strlen(arg));
+	printf(",\"line\":%d,\"cmd\":", r->line);
+	json_str(r->text, len);
+	printf(",\"rule\":");
+	if (r->rule)
+		json_str(r->rule, strlen(r->rule));
+	else
+		printf("null");
+	printf(",\"code\":%d,\"error\":\"%s\",\"msg\":", r->err,
+	       errstr(r->err));
+	if (r->msg)
+		json_str(r->msg, strlen(r->msg));
+	else
+		printf("null");
+	printf(",\"us\":%.1f}\n", r->usec);
+}
+
+static void print_verdict(struct batch_opts *opts, const char *path,
+			  const struct verdict *v, int cached, double usec)
+{
+	if (opts->format == FORMAT_TEXT) {
+		if (v->ok)
+			printf("%s: ok\n", path);
+		else if (v->line)
+			printf("%s:%d: error: %s\n", path, v->line, v->msg);
+		else
+			printf("%s: error: %s\n", path, v->msg);
+		return;
+	}
+
+	printf("{\"proof\":");
+	json_str(path, strlen(path));
+	printf(",\"verdict\":\"%s\",\"line\":%d,\"code\":%d,"
+	       "\"error\":\"%s\",\"msg\":", v->ok ? "ok" : "error", v->line,
+	       v->err, errstr(v->err));
+	if (v->ok)
+		printf("null");
+	else
+		json_str(v->msg, strlen(v->msg));
+	printf(",\"cached\":%s,\"us\":%.1f}\n", cached ? "true" : "false",
+	       usec);
+}
+
+/* Budgets decide verdicts too, so they are part of the cache key. */
+static uint64_t limits_hash(const struct limits *lim)
+{
+	uint64_t f[] = {
+		lim->max_lines, lim->max_depth, lim->max_form_nodes,
+		lim->max_form_depth, lim->max_time_ms, lim->max_mem,
+		lim->oracle,
+	};
+	uint64_t h = 0;
+
+	for (size_t i = 0; i < sizeof(f) / sizeof(f[0]); i++)
+		h = (h ^ f[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+static int check_one(struct batch_opts *opts, struct cache *c,
+		     struct spec *spec, const char *path)
+{
+	struct verdict v = { 0 }, cv;
+	uint64_t key;
+	size_t length;
+	char *text;
+	int cached;
+	double t0;
+
+	t0 = now_usec();
+	text = read_file(path, &length);
+	if (!text) {
+		v.err = ERR_IO;
+		snprintf(v.msg, sizeof(v.msg), "unable to read file");
+		print_verdict(opts, path, &v, 0, 0);
+		return 0;
+	}
+
+	key = script_hash(text, length);
+	if (spec)
+		key = (key ^ spec->hash) * 0x100000001b3ULL;
+	key = (key ^ limits_hash(&opts->lim)) * 0x100000001b3ULL;
+	key = (key ^ apply_rules_hash()) * 0x100000001b3ULL;
+	cached = c && cache_lookup(c, key, &v);
+	if (cached) {
+		v.line = script_cmd_line(text, length, v.line);
+	} else {
+		if (opts->format == FORMAT_JSON)
+			check_script(text, length, spec, &opts->lim, &v,
+				     json_report, (void *)path);
+		else
+			check_script(text, length, spec, &opts->lim, &v,
+				     NULL, NULL);
+		if (c) {
+			cv = v;
+			cv.line = script_cmd_index(text, length, v.line);
+			cache_store(c, key, &cv);
+		}
+	}
+	free(text);
+
+	print_verdict(opts, path, &v, cached, now_usec() - t0);
+	return v.ok;
+}
+
+static struct cache *open_cache(struct batch_opts *opts)
+{
+	struct cache *c;
+
+	if (!opts->cache_path)
+		return NULL;
+
+	c = cache_open(opts->cache_path, opts->cache_size);
+	if (!c)
+		perror("cache_open");
+	return c;
+}
+
+static void close_cache(struct cache *c)
+{
+	uint64_t hits, misses;
+	uint32_t used, nslots;
+
+	if (!c)
+		return;
+
+	cache_stats(c, &hits, &misses, &used, &nslots);
+	fflush(stdout);
+	fprintf(stderr, "cache: %llu hits, %llu misses, %u/%u slots used\n",
+		(unsigned long long)hits, (unsigned long long)misses,
+		used, nslots);
+	cache_close(c);
+}
+
+/* Specs are compiled on first use and kept for the rest of the run. */
+static struct spec *get_spec(struct batch_opts *opts, struct specent **specs,
+			     const char *path)
+{
+	struct verdict v = { 0 };
+	struct specent *e;
+	struct spec *s;
+
+	for (e = *specs; e; e = e->next) {
+		if (strcmp(e->path, path) == 0)
+			return e->spec;
+	}
+
+	s = spec_load(path, v.msg, sizeof(v.msg));
+	if (!s) {
+		v.err = ERR_PARSE;
+		print_verdict(opts, path, &v, 0, 0);
+		return NULL;
+	}
+
+	e = malloc(sizeof(*e));
+	e->path = strdup(path);
+	e->spec = s;
+	e->next = *specs;
+	*specs = e;
+	return s;
+}
+
+static void free_specs(struct specent *specs)
+{
+	struct specent *next;
+
+	for (; specs; specs = next) {
+		next = specs->next;
+		spec_destroy(specs->spec);
+		free(specs->path);
+		free(specs);
+	}
+}
+
+int batch_check(struct batch_opts *opts, char **paths, int npaths)
+{
+	struct specent *specs = NULL;
+	struct spec *spec = NULL;
+	struct cache *c;
+	int ok = 1;
+
+	if (opts->spec_path) {
+		spec = get_spec(opts, &specs, opts->spec_path);
+		if (!spec)
+			return 0;
+	}
+
+	c = open_cache(opts);
+	for (int i = 0; i < npaths; i++)
+		ok &= check_one(opts, c, spec, paths[i]);
+
+	close_cache(c);
+	free_specs(specs);
+	return ok;
+}
+
+/*
+ * Check script paths read from stdin, one per line, until EOF. A line may
+ * name an exercise spec after the script path, separated by a tab.
+ */
+int batch_daemon(struct batch_opts *opts)
+{
+	struct specent *specs = NULL;
+	struct spec *spec;
+	struct cache *c;
+	char *line = NULL, *tab;
+	size_t cap = 0;
+	ssize_t n;
+
+	c = open_cache(opts);
+	while ((n = getline(&line, &cap, stdin)) > 0) {
+		if (line[n - 1] == '\n')
+			line[--n] = 0;
+		if (!n)
+			continue;
+
+		spec = NULL;
+		tab = strchr(line, '\t');
+		if (tab)
+			*tab++ = 0;
+		if (tab || opts->spec_path) {
+			spec = get_spec(opts, &specs, tab ? tab : opts->spec_path);
+			if (!spec)
+				continue;
+		}
+
+		(void)check_one(opts, c, spec, line);
+		fflush(stdout);
+	}
+
+	free(line);
+	close_cache(c);
+	free_specs(specs);
+	return 1;
+}
+
+/*
+ * Prove the goal of each spec and print the proof as a script. Scripts
+ * are run through the checker before they are printed.
+ */
+int batch_solve(struct batch_opts *opts, char **paths, int npaths)
+{
+	struct verdict v = { 0 };
+	struct spec *spec;
+	char *text;
+	int ok = 1;
+	double t0;
+
+	for (int i = 0; i < npaths; i++) {
+		t0 = now_usec();
+		spec = spec_load(paths[i], v.msg, sizeof(v.msg));
+		if (!spec) {
+			v.ok = 0;
+			v.line = 0;
+			v.err = ERR_PARSE;
+			print_verdict(opts, paths[i], &v, 0, 0);
+			ok = 0;
+			continue;
+		}
+
+		v.ok = 0;
+		v.line = 0;
+		v.err = ERR_GOAL;
+		text = prove_spec(spec, &opts->prove, v.msg, sizeof(v.msg));
+		if (text)
+			check_script(text, strlen(text), spec, &opts->lim, &v,
+				     NULL, NULL);
+		spec_destroy(spec);
+
+		if (!v.ok) {
+			print_verdict(opts, paths[i], &v, 0, now_usec() - t0);
+			ok = 0;
+		} else if (opts->format == FORMAT_TEXT) {
+			printf("# %s\n%s\n", paths[i], text);
+		} else {
+			printf("{\"spec\":");
+			json_str(paths[i], strlen(paths[i]));
+			printf(",\"verdict\":\"ok\",\"script\":");
+			json_str(text, strlen(text));
+			printf(",\"us\":%.1f}\n", now_usec() - t0);
+		}
+		free(text);
+	}
+	return ok;
+}
+
+/* Decides whether the goal of each spec follows from its premises. */
+int batch_valid(struct batch_opts *opts, char **paths, int npaths)
+{
+	struct verdict v = { 0 };
+	struct spec *spec;
+	char *model;
+	int ok = 1, res;
+	double t0;
+
+	for (int i = 0; i < npaths; i++) {
+		t0 = now_usec();
+		spec = spec_load(paths[i], v.msg, sizeof(v.msg));
+		res = -1;
+		v.err = ERR_PARSE;
+		if (spec) {
+			res = valid(spec->prems, spec->nprems, spec->goal,
+				    &model, v.msg, sizeof(v.msg));
+			v.err = ERR_LIMIT;
+			spec_destroy(spec);
+		}
+
+		if (res < 0) {
+			v.ok = 0;
+			v.line = 0;
+			print_verdict(opts, paths[i], &v, 0, now_usec() - t0);
+			ok = 0;
+			continue;
+		}
+		if (opts->format == FORMAT_TEXT) {
+			if (res)
+				printf("%s: valid\n", paths[i]);
+			else if (*model)
+				printf("%s: invalid, false when %s\n",
+				       paths[i], model);
+			else
+				printf("%s: invalid\n", paths[i]);
+		} else {
+			printf("{\"spec\":");
+			json_str(paths[i], strlen(paths[i]));
+			printf(",\"verdict\":\"%s\",\"model\":",
+			       res ? "valid" : "invalid");
+			if (res)
+				printf("null");
+			else
+				json_str(model, strlen(model));
+			printf(",\"us\":%.1f}\n", now_usec() - t0);
+		}
+		ok &= res;
+		free(model);
+	}
+	return ok;
+}
+
+/*
+ * Writes premises and negated goal of each spec as DIMACS CNF, to the
+ * path of the spec with ".cnf" appended.
+ */
+int batch_export_cnf(struct batch_opts *opts, char **paths, int npaths)
+{
+	struct verdict v = { 0 };
+	struct spec *spec;
+	char *out;
+	FILE *f;
+	int ok = 1;
+	double t0;
+
+	for (int i = 0; i < npaths; i++) {
+		t0 = now_usec();
+		out = malloc(strlen(paths[i]) + 5);
+		sprintf(out, "%s.cnf", paths[i]);
+		f = NULL;
+		spec = spec_load(paths[i], v.msg, sizeof(v.msg));
+		v.err = ERR_PARSE;
+		if (spec && !(f = fopen(out, "w"))) {
+			snprintf(v.msg, sizeof(v.msg), "unable to open %s", out);
+			v.err = ERR_IO;
+		}
+		if (!spec || !f) {
+			v.ok = 0;
+			v.line = 0;
+			print_verdict(opts, paths[i], &v, 0, 0);
+			spec_destroy(spec);
+			free(out);
+			ok = 0;
+			continue;
+		}
+
+		cnf_export(f, paths[i], spec->prems, spec->nprems, spec->goal);
+		fclose(f);
+		spec_destroy(spec);
+		if (opts->format == FORMAT_TEXT) {
+			printf("%s: %s\n", paths[i], out);
+		} else {
+			printf("{\"spec\":");
+			json_str(paths[i], strlen(paths[i]));
+			printf(",\"cnf\":");
+			json_str(out, strlen(out));
+			printf(",\"us\":%.1f}\n", now_usec() - t0);
+		}
+		free(out);
+	}
+	return ok;
+}
+
+struct fingerprint {
+	int prems;		/* BDD of their conjunction */
+	int goal;
+	int spec;		/* the first with it, plus one */
+};
+
+/*
+ * Finds the specs that are the same exercise up to equivalence: premises
+ * whose conjunction is equivalent, and an equivalent goal. With one BDD
+ * manager for all of them, that is the same pair of nodes.
+ */
+int batch_dedup(struct batch_opts *opts, char **paths, int npaths)
+{
+	struct fingerprint *fps;
+	struct bdd *m = bdd_new(opts->bdd_order);
+	struct verdict v = { 0 };
+	struct spec *spec;
+	int ok = 1, prems, goal, cap = 1, same;
+	double t0;
+	size_t s;
+
+	while (cap < 2 * npaths)
+		cap *= 2;
+	fps = calloc(cap, sizeof(*fps));
+	for (int i = 0; i < npaths; i++) {
+		t0 = now_usec();
+		spec = spec_load(paths[i], v.msg, sizeof(v.msg));
+		prems = goal = -1;
+		v.err = ERR_PARSE;
+		if (spec) {
+			prems = BDD_TRUE;
+			for (int j = 0; j < spec->nprems; j++)
+				prems = bdd_and(m, prems,
+						bdd_of(m, spec->prems[j]));
+			goal = prems < 0 ? -1 : bdd_of(m, spec->goal);
+			snprintf(v.msg, sizeof(v.msg), "too many BDD nodes");
+			v.err = ERR_LIMIT;
+			spec_destroy(spec);
+		}
+		if (goal < 0) {
+			v.ok = 0;
+			v.line = 0;
+			print_verdict(opts, paths[i], &v, 0, now_usec() - t0);
+			ok = 0;
+			continue;
+		}
+
+		s = ((size_t)prems * 0x9e3779b97f4a7c15ULL ^ goal) & (cap - 1);
+		for (; fps[s].spec; s = (s + 1) & (cap - 1)) {
+			if (fps[s].prems == prems && fps[s].goal == goal)
+				break;
+		}
+		if (!fps[s].spec)
+			fps[s] = (struct fingerprint){ prems, goal, i + 1 };
+		same = fps[s].spec - 1;
+
+		if (opts->format == FORMAT_TEXT) {
+			if (same == i)
+				printf("%s: unique\n", paths[i]);
+			else
+				printf("%s: same as %s\n", paths[i],
+				       paths[same]);
+		} else {
+			printf("{\"spec\":");
+			json_str(paths[i], strlen(paths[i]));
+			printf(",\"fingerprint\":\"%d:%d\",\"same_as\":",
+			       prems, goal);
+			if (same == i)
+				printf("null");
+			else
+				json_str(paths[same], strlen(paths[same]));
+			printf(",\"us\":%.1f}\n", now_usec() - t0);
+		}
+	}
+	bdd_destroy(m);
+	free(fps);
+	return ok;
+}
+
+/* Solves each DIMACS file, for regression runs of the SAT solver. */
+int batch_sat(struct batch_opts *opts, char **paths, int npaths)
+{
+	static const char *names[] = { "unsatisfiable", "satisfiable" };
+	struct verdict v = { 0 };
+	struct sat *s;
+	int ok = 1, res;
+	double t0;
+
+	for (int i = 0; i < npaths; i++) {
+		t0 = now_usec();
+		s = sat_load(paths[i], v.msg, sizeof(v.msg));
+		if (!s) {
+			v.ok = 0;
+			v.line = 0;
+			v.err = ERR_PARSE;
+			print_verdict(opts, paths[i], &v, 0, 0);
+			ok = 0;
+			continue;
+		}
+
+		res = sat_solve(s, 0);
+		if (opts->format == FORMAT_TEXT) {
+			printf("%s: %s\n", paths[i], names[res]);
+		} else {
+			printf("{\"spec\":");
+			json_str(paths[i], strlen(paths[i]));
+			printf(",\"verdict\":\"%s\",\"conflicts\":%ld,"
+			       "\"us\":%.1f}\n", names[res], sat_conflicts(s),
+			       now_usec() - t0);
+		}
+		sat_destroy(s);
+	}
+	return ok;
+}
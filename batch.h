@@ -0,0 +1,31 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "proof.h"
+#include "prove.h"
+
+enum {
+	FORMAT_TEXT,
+	FORMAT_JSON,
+};
+
+struct batch_opts {
+	int format;
+	const char *cache_path;
+	const char *spec_path;
+	uint32_t cache_size;
+	struct limits lim;
+	struct prove_opts prove;
+	const char *bdd_order;
+};
+
+int batch_check(struct batch_opts *opts, char **paths, int npaths);
+int batch_daemon(struct batch_opts *opts);
+int batch_solve(struct batch_opts *opts, char **paths, int npaths);
+int batch_valid(struct batch_opts *opts, char **paths, int npaths);
+int batch_export_cnf(struct batch_opts *opts, char **paths, int npaths);
+int batch_dedup(struct batch_opts *opts, char **paths, int npaths);
+int batch_sat(struct batch_opts *opts, char **paths, int npaths);
+
+#endif
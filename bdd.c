@@ -0,0 +1,277 @@
+#include "bdd.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+
+#define CACHE_SIZE (1 << 16)
+
+enum {
+	OP_NOT,
+	OP_AND,
+	OP_OR,
+	OP_XOR,
+};
+
+struct node {
+	int var;		/* INT_MAX for the terminals */
+	int lo;
+	int hi;
+};
+
+struct centry {
+	int op;
+	int a;
+	int b;
+	int res;
+};
+
+struct bdd {
+	struct node *nodes;
+	int n;
+	int cap;
+	int *table;		/* open addressing, node plus one */
+	int tabcap;
+	struct centry *cache;
+	char **names;		/* of the variables, in order */
+	int nvars;
+};
+
+static uint64_t mix(uint64_t h)
+{
+	h *= 0x9e3779b97f4a7c15ULL;
+	return h ^ h >> 29;
+}
+
+static size_t slot(int a, int b, int c, int cap)
+{
+	return mix(((uint64_t)a * 0x100000001b3ULL ^ (uint32_t)b)
+		   * 0x100000001b3ULL ^ (uint32_t)c) & (cap - 1);
+}
+
+static void rehash(struct bdd *m)
+{
+	struct node *nd;
+	size_t s;
+
+	free(m->table);
+	m->tabcap *= 2;
+	m->table = calloc(m->tabcap, sizeof(*m->table));
+	for (int i = 2; i < m->n; i++) {
+		nd = &m->nodes[i];
+		s = slot(nd->var, nd->lo, nd->hi, m->tabcap);
+		while (m->table[s])
+			s = (s + 1) & (m->tabcap - 1);
+		m->table[s] = i + 1;
+	}
+}
+
+/* The node testing var, reduced and unique, or -1 if out of nodes. */
+static int mk(struct bdd *m, int var, int lo, int hi)
+{
+	struct node *nd;
+	size_t s;
+
+	if (lo < 0 || hi < 0)
+		return -1;
+	if (lo == hi)
+		return lo;
+	if (2 * (m->n + 1) > m->tabcap)
+		rehash(m);
+	s = slot(var, lo, hi, m->tabcap);
+	for (; m->table[s]; s = (s + 1) & (m->tabcap - 1)) {
+		nd = &m->nodes[m->table[s] - 1];
+		if (nd->var == var && nd->lo == lo && nd->hi == hi)
+			return m->table[s] - 1;
+	}
+
+	if (m->n == BDD_MAX_NODES)
+		return -1;
+	if (m->n == m->cap) {
+		m->cap *= 2;
+		m->nodes = realloc(m->nodes, m->cap * sizeof(*m->nodes));
+	}
+	m->nodes[m->n] = (struct node){ var, lo, hi };
+	m->table[s] = m->n + 1;
+	return m->n++;
+}
+
+static int var_of(struct bdd *m, const char *name, size_t len)
+{
+	for (int i = 0; i < m->nvars; i++) {
+		if (strlen(m->names[i]) == len
+		    && strncmp(m->names[i], name, len) == 0)
+			return i;
+	}
+	m->names = realloc(m->names, (m->nvars + 1) * sizeof(*m->names));
+	m->names[m->nvars] = strndup(name, len);
+	return m->nvars++;
+}
+
+struct bdd *bdd_new(const char *order)
+{
+	struct bdd *m = calloc(1, sizeof(*m));
+	size_t len;
+
+	m->cap = 1024;
+	m->nodes = malloc(m->cap * sizeof(*m->nodes));
+	m->nodes[BDD_FALSE] = (struct node){ INT_MAX, BDD_FALSE, BDD_FALSE };
+	m->nodes[BDD_TRUE] = (struct node){ INT_MAX, BDD_TRUE, BDD_TRUE };
+	m->n = 2;
+	m->tabcap = 1024;
+	m->table = calloc(m->tabcap, sizeof(*m->table));
+	/* zeroed entries match no lookup, those are of inner nodes */
+	m->cache = calloc(CACHE_SIZE, sizeof(*m->cache));
+
+	for (; order && *order; order += len + (order[len] == ',')) {
+		len = strcspn(order, ",");
+		if (len)
+			var_of(m, order, len);
+	}
+	return m;
+}
+
+void bdd_destroy(struct bdd *m)
+{
+	if (!m)
+		return;
+	for (int i = 0; i < m->nvars; i++)
+		free(m->names[i]);
+	free(m->names);
+	free(m->nodes);
+	free(m->table);
+	free(m->cache);
+	free(m);
+}
+
+static int cofactor(struct bdd *m, int u, int var, int hi)
+{
+	if (m->nodes[u].var != var)
+		return u;
+	return hi ? m->nodes[u].hi : m->nodes[u].lo;
+}
+
+static int apply(struct bdd *m, int op, int a, int b)
+{
+	struct centry *e;
+	int t, var, lo, hi;
+
+	switch (op) {
+	case OP_NOT:
+		if (a <= BDD_TRUE)
+			return !a;
+		break;
+	case OP_AND:
+		if (a == BDD_FALSE || b == BDD_FALSE)
+			return BDD_FALSE;
+		if (a == BDD_TRUE || a == b)
+			return b;
+		if (b == BDD_TRUE)
+			return a;
+		break;
+	case OP_OR:
+		if (a == BDD_TRUE || b == BDD_TRUE)
+			return BDD_TRUE;
+		if (a == BDD_FALSE || a == b)
+			return b;
+		if (b == BDD_FALSE)
+			return a;
+		break;
+	case OP_XOR:
+		if (a == b)
+			return BDD_FALSE;
+		if (a == BDD_FALSE)
+			return b;
+		if (b == BDD_FALSE)
+			return a;
+		if (a == BDD_TRUE)
+			return apply(m, OP_NOT, b, 0);
+		if (b == BDD_TRUE)
+			return apply(m, OP_NOT, a, 0);
+		break;
+	}
+	if (op != OP_NOT && a > b) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	e = &m->cache[slot(op, a, b, CACHE_SIZE)];
+	if (e->op == op && e->a == a && e->b == b)
+		return e->res;
+
+	var = m->nodes[a].var;
+	if (op != OP_NOT && m->nodes[b].var < var)
+		var = m->nodes[b].var;
+	lo = apply(m, op, cofactor(m, a, var, 0), cofactor(m, b, var, 0));
+	hi = lo < 0 ? -1 : apply(m, op, cofactor(m, a, var, 1),
+				 cofactor(m, b, var, 1));
+	t = mk(m, var, lo, hi);
+	if (t >= 0)
+		*e = (struct centry){ op, a, b, t };
+	return t;
+}
+
+int bdd_and(struct bdd *m, int a, int b)
+{
+	return a < 0 || b < 0 ? -1 : apply(m, OP_AND, a, b);
+}
+
+int bdd_xor(struct bdd *m, int a, int b)
+{
+	return a < 0 || b < 0 ? -1 : apply(m, OP_XOR, a, b);
+}
+
+/* The node of form, or -1 if it takes more than BDD_MAX_NODES. */
+int bdd_of(struct bdd *m, struct ast *form)
+{
+	int a, b;
+
+	switch (form->type) {
+	case FORM_NAME:
+		return mk(m, var_of(m, form->text, strlen(form->text)),
+			  BDD_FALSE, BDD_TRUE);
+	case FORM_CON:
+		return BDD_FALSE;
+	case FORM_NOT:
+		a = bdd_of(m, form->lhs);
+		return a < 0 ? -1 : apply(m, OP_NOT, a, 0);
+	default:
+		a = bdd_of(m, form->lhs);
+		if (a >= 0 && form->type == FORM_IMPL)
+			a = apply(m, OP_NOT, a, 0);
+		b = a < 0 ? -1 : bdd_of(m, form->rhs);
+		if (b < 0)
+			return -1;
+		return apply(m, form->type == FORM_AND ? OP_AND : OP_OR, a, b);
+	}
+}
+
+/*
+ * An assignment to the atoms on a path from node to true, such as
+ * "p = T, q = F", to be freed. The other atoms do not matter.
+ */
+char *bdd_sat(struct bdd *m, int node)
+{
+	char *text = NULL;
+	size_t len;
+	FILE *f;
+	int hi;
+
+	f = open_memstream(&text, &len);
+	for (int k = 0; node > BDD_TRUE; k++) {
+		hi = m->nodes[node].lo == BDD_FALSE;
+		fprintf(f, "%s%s = %c", k ? ", " : "",
+			m->names[m->nodes[node].var], hi ? 'T' : 'F');
+		node = hi ? m->nodes[node].hi : m->nodes[node].lo;
+	}
+	fclose(f);
+	return text;
+}
+
+int bdd_nodes(struct bdd *m)
+{
+	return m->n;
+}
@@ -0,0 +1,27 @@
+#ifndef BDD_H
+#define BDD_H
+
+struct ast;
+
+#define BDD_FALSE 0
+#define BDD_TRUE 1
+#define BDD_MAX_NODES (1 << 22)
+
+/*
+ * Reduced ordered BDDs. Nodes are hash-consed in a unique table, so two
+ * formulas are equivalent exactly when their nodes are the same, and
+ * apply results are kept in a lossy computed table. Atoms named in the
+ * order, comma separated, come first and in that order, the others
+ * after them in the order they are met.
+ */
+struct bdd;
+
+struct bdd *bdd_new(const char *order);
+void bdd_destroy(struct bdd *m);
+int bdd_of(struct bdd *m, struct ast *form);
+int bdd_and(struct bdd *m, int a, int b);
+int bdd_xor(struct bdd *m, int a, int b);
+char *bdd_sat(struct bdd *m, int node);
+int bdd_nodes(struct bdd *m);
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Rule dispatch microbenchmark: checks one proof using most of the
+ * builtin rules over and over, commands parsed once up front, and prints
+ * the time per rule application. Proof setup and teardown are included,
+ * as they are for every checked script.
+ *
+ *	make bench
+ *	bench/apply [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "apply.h"
+#include "parse.h"
+#include "proof.h"
+
+static const char *script[] = {
+	"presume ((a ^ b) => c) ^ ((c / d) => -(e ^ f))",
+	"presume (a ^ b) / -(c => d)",
+	"presume -(e ^ f) => -(g / h)",
+	"apply ^e1 1",
+	"apply ^e2 1",
+	"open",
+	"assume a ^ b",
+	"apply =>e 6, 4",
+	"apply /i1 7, d",
+	"apply =>e 8, 5",
+	"apply =>e 9, 3",
+	"close",
+	"apply =>i 6-10",
+	"open",
+	"assume -(c => d)",
+	"apply copy 12",
+	"close",
+	"apply =>i 12-13",
+	"apply ^i 11, 14",
+	"apply LEM (a ^ b) => -(g / h)",
+	"apply --i 15",
+	"apply --e 17",
+	"apply ^e1 15",
+	"apply ^e2 15",
+	"open",
+	"assume (a ^ b) => -(g / h)",
+	"apply copy 21",
+	"close",
+	"open",
+	"assume -((a ^ b) => -(g / h))",
+	"apply -e 11, 23",
+	"apply _|_e 24, (a ^ b) => -(g / h)",
+	"close",
+	"apply /e 16, 21-22, 23-25",
+	"open",
+	"assume -((a ^ b) => -(g / h))",
+	"apply -e 26, 27",
+	"close",
+	"apply -i 27-28",
+	"presume --(g / h)",
+	"apply MT 11, 30",
+	"open",
+	"assume -(g / h)",
+	"apply -e 32, 30",
+	"close",
+	"apply PBC 32-33",
+	"apply /i2 a, 34",
+};
+
+#define NCMDS ((int)(sizeof(script) / sizeof(*script)))
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Commands stay owned by the caller, so they are reused every run. */
+static int run(struct ast **cmds)
+{
+	struct proof p = new_proof();
+	int ok = 1;
+
+	for (int i = 0; i < NCMDS && ok; i++) {
+		switch (cmds[i]->type) {
+		case CMD_OPEN:
+			ok = push_box(&p);
+			break;
+		case CMD_CLOSE:
+			ok = pop_box(&p);
+			break;
+		case CMD_PRESUME:
+		case CMD_ASSUME:
+			ok = pushln(&p, cmds[i], cmds[i]->lhs);
+			break;
+		case CMD_APPLY:
+			ok = apply_rule(&p, cmds[i]);
+			break;
+		}
+		if (!ok)
+			fprintf(stderr, "%s: %s\n", script[i], p.errbuf);
+	}
+	destroy_proof(&p);
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	struct ast *cmds[NCMDS];
+	char errbuf[256];
+	int iters = argc > 1 ? atoi(argv[1]) : 100000, napply = 0;
+	double t;
+
+	for (int i = 0; i < NCMDS; i++) {
+		cmds[i] = parse(script[i], strlen(script[i]), errbuf,
+				sizeof(errbuf));
+		if (!cmds[i]) {
+			fprintf(stderr, "%s: %s\n", script[i], errbuf);
+			return 1;
+		}
+		napply += cmds[i]->type == CMD_APPLY;
+	}
+
+	if (!run(cmds))
+		return 1;
+
+	t = now_sec();
+	for (int i = 0; i < iters; i++)
+		run(cmds);
+	t = now_sec() - t;
+
+	printf("%d runs of %d rule applications: %.1f ns per application\n",
+	       iters, napply, t * 1e9 / ((double)iters * napply));
+
+	for (int i = 0; i < NCMDS; i++)
+		ast_destroy(cmds[i]);
+	return 0;
+}
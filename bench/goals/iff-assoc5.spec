@@ -0,0 +1,2 @@
+# <=> is associative, 5 atoms
+goal ((((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))))) => ((a => ((b => ((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c))) ^ (((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c)) => b))) ^ (((b => ((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c))) ^ (((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c)) => b)) => a))) ^ (((a => ((b => ((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c))) ^ (((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c)) => b))) ^ (((b => ((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c))) ^ (((c => ((d => e) ^ (e => d))) ^ (((d => e) ^ (e => d)) => c)) => b)) => a)) => ((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a))))))))))
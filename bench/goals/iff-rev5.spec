@@ -0,0 +1,2 @@
+# a chain of <=> reversed, 5 atoms
+goal ((((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))))) => ((((((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))) => b) ^ (b => ((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))))) => a) ^ (a => ((((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))) => b) ^ (b => ((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e))))))))) ^ (((((((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))) => b) ^ (b => ((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))))) => a) ^ (a => ((((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))) => b) ^ (b => ((((e => d) ^ (d => e)) => c) ^ (c => ((e => d) ^ (d => e)))))))) => ((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a))))))))))
@@ -0,0 +1,2 @@
+# a chain of <=> reversed, 6 atoms
+goal ((((((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))))) => f) ^ (f => ((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))))))) => ((((((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))) => b) ^ (b => ((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))))) => a) ^ (a => ((((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))) => b) ^ (b => ((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f))))))))))) ^ (((((((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))) => b) ^ (b => ((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))))) => a) ^ (a => ((((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))) => b) ^ (b => ((((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))) => c) ^ (c => ((((f => e) ^ (e => f)) => d) ^ (d => ((f => e) ^ (e => f)))))))))) => ((((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))))) => f) ^ (f => ((((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))))) => e) ^ (e => ((((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a)))) => d) ^ (d => ((((a => b) ^ (b => a)) => c) ^ (c => ((a => b) ^ (b => a))))))))))))
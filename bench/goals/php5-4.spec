@@ -0,0 +1,47 @@
+# 5 pigeons do not fit in 4 holes
+presume paa / pab / pac / pad
+presume pba / pbb / pbc / pbd
+presume pca / pcb / pcc / pcd
+presume pda / pdb / pdc / pdd
+presume pea / peb / pec / ped
+presume -(paa ^ pba)
+presume -(paa ^ pca)
+presume -(paa ^ pda)
+presume -(paa ^ pea)
+presume -(pba ^ pca)
+presume -(pba ^ pda)
+presume -(pba ^ pea)
+presume -(pca ^ pda)
+presume -(pca ^ pea)
+presume -(pda ^ pea)
+presume -(pab ^ pbb)
+presume -(pab ^ pcb)
+presume -(pab ^ pdb)
+presume -(pab ^ peb)
+presume -(pbb ^ pcb)
+presume -(pbb ^ pdb)
+presume -(pbb ^ peb)
+presume -(pcb ^ pdb)
+presume -(pcb ^ peb)
+presume -(pdb ^ peb)
+presume -(pac ^ pbc)
+presume -(pac ^ pcc)
+presume -(pac ^ pdc)
+presume -(pac ^ pec)
+presume -(pbc ^ pcc)
+presume -(pbc ^ pdc)
+presume -(pbc ^ pec)
+presume -(pcc ^ pdc)
+presume -(pcc ^ pec)
+presume -(pdc ^ pec)
+presume -(pad ^ pbd)
+presume -(pad ^ pcd)
+presume -(pad ^ pdd)
+presume -(pad ^ ped)
+presume -(pbd ^ pcd)
+presume -(pbd ^ pdd)
+presume -(pbd ^ ped)
+presume -(pcd ^ pdd)
+presume -(pcd ^ ped)
+presume -(pdd ^ ped)
+goal _|_
@@ -0,0 +1,83 @@
+# 6 pigeons do not fit in 5 holes
+presume paa / pab / pac / pad / pae
+presume pba / pbb / pbc / pbd / pbe
+presume pca / pcb / pcc / pcd / pce
+presume pda / pdb / pdc / pdd / pde
+presume pea / peb / pec / ped / pee
+presume pfa / pfb / pfc / pfd / pfe
+presume -(paa ^ pba)
+presume -(paa ^ pca)
+presume -(paa ^ pda)
+presume -(paa ^ pea)
+presume -(paa ^ pfa)
+presume -(pba ^ pca)
+presume -(pba ^ pda)
+presume -(pba ^ pea)
+presume -(pba ^ pfa)
+presume -(pca ^ pda)
+presume -(pca ^ pea)
+presume -(pca ^ pfa)
+presume -(pda ^ pea)
+presume -(pda ^ pfa)
+presume -(pea ^ pfa)
+presume -(pab ^ pbb)
+presume -(pab ^ pcb)
+presume -(pab ^ pdb)
+presume -(pab ^ peb)
+presume -(pab ^ pfb)
+presume -(pbb ^ pcb)
+presume -(pbb ^ pdb)
+presume -(pbb ^ peb)
+presume -(pbb ^ pfb)
+presume -(pcb ^ pdb)
+presume -(pcb ^ peb)
+presume -(pcb ^ pfb)
+presume -(pdb ^ peb)
+presume -(pdb ^ pfb)
+presume -(peb ^ pfb)
+presume -(pac ^ pbc)
+presume -(pac ^ pcc)
+presume -(pac ^ pdc)
+presume -(pac ^ pec)
+presume -(pac ^ pfc)
+presume -(pbc ^ pcc)
+presume -(pbc ^ pdc)
+presume -(pbc ^ pec)
+presume -(pbc ^ pfc)
+presume -(pcc ^ pdc)
+presume -(pcc ^ pec)
+presume -(pcc ^ pfc)
+presume -(pdc ^ pec)
+presume -(pdc ^ pfc)
+presume -(pec ^ pfc)
+presume -(pad ^ pbd)
+presume -(pad ^ pcd)
+presume -(pad ^ pdd)
+presume -(pad ^ ped)
+presume -(pad ^ pfd)
+presume -(pbd ^ pcd)
+presume -(pbd ^ pdd)
+presume -(pbd ^ ped)
+presume -(pbd ^ pfd)
+presume -(pcd ^ pdd)
+presume -(pcd ^ ped)
+presume -(pcd ^ pfd)
+presume -(pdd ^ ped)
+presume -(pdd ^ pfd)
+presume -(ped ^ pfd)
+presume -(pae ^ pbe)
+presume -(pae ^ pce)
+presume -(pae ^ pde)
+presume -(pae ^ pee)
+presume -(pae ^ pfe)
+presume -(pbe ^ pce)
+presume -(pbe ^ pde)
+presume -(pbe ^ pee)
+presume -(pbe ^ pfe)
+presume -(pce ^ pde)
+presume -(pce ^ pee)
+presume -(pce ^ pfe)
+presume -(pde ^ pee)
+presume -(pde ^ pfe)
+presume -(pee ^ pfe)
+goal _|_
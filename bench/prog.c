@@ -0,0 +1,216 @@
+/*
+ * Truth table microbenchmark: evaluates random 10000-node formulas over
+ * every valuation of their atoms, once as compiled code and once by the
+ * tree walk that code replaced, and prints the time each takes. Both see
+ * the same atom registers and must agree on every valuation.
+ *
+ *	make bench
+ *	bench/prog [atoms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "parse.h"
+#include "prog.h"
+
+#if defined(__x86_64__)
+#define LANE_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_CLONES
+#endif
+
+#define NODES 10000
+
+/* A formula for the tree walk, atoms numbered as in the program. */
+struct wnode {
+	int type;
+	int atom;
+	struct wnode *lhs;
+	struct wnode *rhs;
+};
+
+static unsigned long long seed = 1;
+
+static int rnd(int n)
+{
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (seed >> 33) % n;
+}
+
+static struct ast *node(int type, struct ast *lhs, struct ast *rhs)
+{
+	struct ast *form = calloc(1, sizeof(*form));
+
+	form->type = type;
+	form->lhs = lhs;
+	form->rhs = rhs;
+	return form;
+}
+
+/* A random formula of about n nodes. */
+static struct ast *gen(int n, int natoms)
+{
+	static const int ops[] = { FORM_AND, FORM_OR, FORM_IMPL };
+	struct ast *form;
+	char name[16];
+	int l;
+
+	if (n <= 1) {
+		form = node(FORM_NAME, NULL, NULL);
+		snprintf(name, sizeof(name), "a%d", rnd(natoms));
+		form->text = strdup(name);
+		return form;
+	}
+	if (rnd(5) == 0)
+		return node(FORM_NOT, gen(n - 1, natoms), NULL);
+	l = 1 + rnd(n - 1);
+	return node(ops[rnd(3)], gen(l, natoms), gen(n - l, natoms));
+}
+
+static struct wnode *wnode(const struct prog *p, struct ast *form)
+{
+	struct wnode *n;
+
+	if (!form)
+		return NULL;
+	n = calloc(1, sizeof(*n));
+	n->type = form->type;
+	if (form->type == FORM_NAME) {
+		while (strcmp(p->atoms[n->atom], form->text) != 0)
+			n->atom++;
+	}
+	n->lhs = wnode(p, form->lhs);
+	n->rhs = wnode(p, form->rhs);
+	return n;
+}
+
+static void wnode_destroy(struct wnode *n)
+{
+	if (!n)
+		return;
+	wnode_destroy(n->lhs);
+	wnode_destroy(n->rhs);
+	free(n);
+}
+
+LANE_CLONES
+static void eval(struct wnode *n, const block *regs, lane *out)
+{
+	block b;
+
+	switch (n->type) {
+	case FORM_NAME:
+		memcpy(out, regs[n->atom], sizeof(b));
+		return;
+	case FORM_CON:
+		memset(out, 0, sizeof(b));
+		return;
+	case FORM_NOT:
+		eval(n->lhs, regs, out);
+		for (int i = 0; i < PROG_LANES; i++)
+			out[i] = ~out[i];
+		return;
+	}
+
+	eval(n->lhs, regs, out);
+	eval(n->rhs, regs, b);
+	for (int i = 0; i < PROG_LANES; i++) {
+		switch (n->type) {
+		case FORM_AND:
+			out[i] &= b[i];
+			break;
+		case FORM_OR:
+			out[i] |= b[i];
+			break;
+		case FORM_IMPL:
+			out[i] = ~out[i] | b[i];
+			break;
+		}
+	}
+}
+
+static long ones(const lane *m)
+{
+	long n = 0;
+
+	for (int i = 0; i < PROG_LANES; i++) {
+		for (int j = 0; j < PROG_LANE_WORDS; j++)
+			n += __builtin_popcountll(m[i][j]);
+	}
+	return n;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Times both evaluations of form, returning 0 if they disagree. */
+static int run(const char *name, struct ast *form)
+{
+	struct prog *p = prog_compile(&form, 1);
+	struct wnode *w = wnode(p, form);
+	block *regs = prog_regs(p), *out = prog_regs(p);
+	long walked = 0, ran = 0;
+	double t, tw, tp;
+
+	t = now_sec();
+	for (uint64_t blk = 0; blk < prog_blocks(p); blk++) {
+		prog_set_atoms(p, regs, blk);
+		eval(w, (const block *)regs, *out);
+		walked += ones(*out);
+	}
+	tw = now_sec() - t;
+
+	t = now_sec();
+	for (uint64_t blk = 0; blk < prog_blocks(p); blk++) {
+		prog_set_atoms(p, regs, blk);
+		prog_run(p, 0, p->n, regs);
+		ran += ones(regs[p->outs[0]]);
+	}
+	tp = now_sec() - t;
+
+	printf("%-22s %3d atoms %6d insns  tree walk %8.1f ms  "
+	       "compiled %8.1f ms\n", name, p->natoms, p->n, tw * 1e3,
+	       tp * 1e3);
+	if (walked != ran)
+		fprintf(stderr, "%s: %ld true valuations walked, %ld run\n",
+			name, walked, ran);
+
+	free(regs);
+	free(out);
+	wnode_destroy(w);
+	prog_destroy(p);
+	return walked == ran;
+}
+
+int main(int argc, char **argv)
+{
+	int natoms = argc > 1 ? atoi(argv[1]) : 20, ok = 1;
+	struct ast *form, *f;
+
+	if (natoms < 1 || natoms > 30) {
+		fprintf(stderr, "atoms must be 1 to 30\n");
+		return 1;
+	}
+
+	form = gen(NODES, natoms);
+	ok &= run("random", form);
+	ast_destroy(form);
+
+	/* both halves of F / -F share their code */
+	f = gen(NODES / 2, natoms);
+	form = node(FORM_OR, f, node(FORM_NOT, ast_copy(f), NULL));
+	ok &= run("F / -F", form);
+	ast_destroy(form);
+
+	form = gen(NODES, natoms);
+	form = node(FORM_IMPL, node(FORM_CON, NULL, NULL), form);
+	ok &= run("_|_ => random", form);
+	ast_destroy(form);
+
+	return !ok;
+}
@@ -0,0 +1,96 @@
+/*
+ * Proof search benchmark: proves each spec in bench/goals once for every
+ * thread count given, checks the proof found, and prints the time each
+ * search takes. The iff specs of 5 atoms and php5-4 are proved before a
+ * search forks, iff-rev6 and php6-5 well after.
+ *
+ *	make bench
+ *	bench/prove [jobs...]
+ */
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "prove.h"
+#include "spec.h"
+
+#define DEPTH 28
+#define STEPS (1L << 24)
+
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Times one search for spec, returning 0 if no checked proof is found. */
+static int run(const char *path, struct spec *spec, int jobs, double *total)
+{
+	struct prove_opts opts = { DEPTH, STEPS, jobs, 0, 0, 0, 0, 0, 0, 0 };
+	struct verdict v = { 0 };
+	char *text;
+	double t;
+
+	t = now_sec();
+	text = prove_spec(spec, &opts, v.msg, sizeof(v.msg));
+	t = now_sec() - t;
+	*total += t;
+
+	if (text)
+		check_script(text, strlen(text), spec, NULL, &v, NULL, NULL);
+	if (!v.ok)
+		fprintf(stderr, "%s: %s\n", path, v.msg);
+	else
+		printf("%-28s %2d jobs %8.1f ms\n", path, jobs, t * 1e3);
+	free(text);
+	return v.ok;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *defaults[] = { "1", "2", "4" };
+	const char **jobs = argc > 1 ? (const char **)argv + 1 : defaults;
+	int njobs = argc > 1 ? argc - 1 : 3, ok = 1;
+	struct spec **specs;
+	char errbuf[128];
+	double total;
+	glob_t g;
+
+	for (int i = 0; i < njobs; i++) {
+		if (atoi(jobs[i]) < 1) {
+			fprintf(stderr, "jobs must be at least 1\n");
+			return 1;
+		}
+	}
+	if (glob("bench/goals/*.spec", 0, NULL, &g) != 0) {
+		fprintf(stderr, "no specs in bench/goals\n");
+		return 1;
+	}
+
+	specs = calloc(g.gl_pathc, sizeof(*specs));
+	for (size_t i = 0; i < g.gl_pathc; i++) {
+		specs[i] = spec_load(g.gl_pathv[i], errbuf, sizeof(errbuf));
+		if (!specs[i]) {
+			fprintf(stderr, "%s: %s\n", g.gl_pathv[i], errbuf);
+			ok = 0;
+		}
+	}
+
+	for (int i = 0; ok && i < njobs; i++) {
+		total = 0;
+		for (size_t j = 0; j < g.gl_pathc; j++)
+			ok &= run(g.gl_pathv[j], specs[j], atoi(jobs[i]),
+				  &total);
+		printf("%-28s %2d jobs %8.1f ms\n", "total", atoi(jobs[i]),
+		       total * 1e3);
+	}
+
+	for (size_t i = 0; i < g.gl_pathc; i++)
+		spec_destroy(specs[i]);
+	free(specs);
+	globfree(&g);
+	return !ok;
+}
@@ -0,0 +1,166 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "ndecache"
+#define CACHE_VERSION 2
+#define PROBE 8
+
+/*
+ * On-disk layout: a header followed by a fixed number of slots, open
+ * addressing with a bounded probe window. The file never grows; when all
+ * slots in a key's window are taken the least recently used one is
+ * evicted.
+ */
+struct cache_hdr {
+	char magic[8];
+	uint32_t version;
+	uint32_t nslots;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t clock;
+	uint32_t used;
+	uint32_t pad;
+};
+
+struct cache_slot {
+	uint64_t key;
+	uint64_t stamp;
+	struct verdict v;
+};
+
+struct cache {
+	int fd;
+	size_t size;
+	struct cache_hdr *hdr;
+	struct cache_slot *slots;
+};
+
+static size_t cache_size(uint32_t nslots)
+{
+	return sizeof(struct cache_hdr) + nslots * sizeof(struct cache_slot);
+}
+
+struct cache *cache_open(const char *path, uint32_t nslots)
+{
+	struct cache *c;
+	struct cache_hdr hdr;
+	struct stat st;
+	ssize_t n;
+	void *mem;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0)
+		goto err;
+
+	n = pread(fd, &hdr, sizeof(hdr), 0);
+	if (n == sizeof(hdr) && memcmp(hdr.magic, CACHE_MAGIC, 8) == 0
+	    && hdr.version == CACHE_VERSION
+	    && (size_t)st.st_size == cache_size(hdr.nslots)) {
+		nslots = hdr.nslots;
+	} else {
+		if (nslots < PROBE)
+			nslots = PROBE;
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, CACHE_MAGIC, 8);
+		hdr.version = CACHE_VERSION;
+		hdr.nslots = nslots;
+		if (ftruncate(fd, 0) < 0
+		    || ftruncate(fd, cache_size(nslots)) < 0
+		    || pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+			goto err;
+	}
+
+	mem = mmap(NULL, cache_size(nslots), PROT_READ | PROT_WRITE,
+		   MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED)
+		goto err;
+
+	c = calloc(1, sizeof(*c));
+	c->fd = fd;
+	c->size = cache_size(nslots);
+	c->hdr = mem;
+	c->slots = (struct cache_slot *)(c->hdr + 1);
+	return c;
+
+ err:
+	close(fd);
+	return NULL;
+}
+
+void cache_close(struct cache *c)
+{
+	if (!c)
+		return;
+	munmap(c->hdr, c->size);
+	close(c->fd);
+	free(c);
+}
+
+static struct cache_slot *slot(struct cache *c, uint64_t key, int i)
+{
+	return &c->slots[(key + i) % c->hdr->nslots];
+}
+
+int cache_lookup(struct cache *c, uint64_t key, struct verdict *v)
+{
+	struct cache_slot *s;
+
+	if (!key)
+		key = 1;
+
+	for (int i = 0; i < PROBE; i++) {
+		s = slot(c, key, i);
+		if (s->key == key) {
+			s->stamp = ++c->hdr->clock;
+			*v = s->v;
+			c->hdr->hits++;
+			return 1;
+		}
+	}
+
+	c->hdr->misses++;
+	return 0;
+}
+
+void cache_store(struct cache *c, uint64_t key, const struct verdict *v)
+{
+	struct cache_slot *s, *victim = NULL;
+
+	if (!key)
+		key = 1;
+
+	for (int i = 0; i < PROBE; i++) {
+		s = slot(c, key, i);
+		if (s->key == key || !s->key) {
+			victim = s;
+			break;
+		}
+		if (!victim || s->stamp < victim->stamp)
+			victim = s;
+	}
+
+	if (!victim->key)
+		c->hdr->used++;
+	victim->key = key;
+	victim->stamp = ++c->hdr->clock;
+	victim->v = *v;
+}
+
+void cache_stats(struct cache *c, uint64_t *hits, uint64_t *misses,
+		 uint32_t *used, uint32_t *nslots)
+{
+	*hits = c->hdr->hits;
+	*misses = c->hdr->misses;
+	*used = c->hdr->used;
+	*nslots = c->hdr->nslots;
+}
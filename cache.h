@@ -0,0 +1,16 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include "check.h"
+
+struct cache;
+
+struct cache *cache_open(const char *path, uint32_t nslots);
+void cache_close(struct cache *c);
+int cache_lookup(struct cache *c, uint64_t key, struct verdict *v);
+void cache_store(struct cache *c, uint64_t key, const struct verdict *v);
+void cache_stats(struct cache *c, uint64_t *hits, uint64_t *misses,
+		 uint32_t *used, uint32_t *nslots);
+
+#endif
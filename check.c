@@ -0,0 +1,293 @@
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "parse.h"
+#include "proof.h"
+#include "apply.h"
+#include "spec.h"
+#include "oracle.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static int wspc(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int fail(struct verdict *v, int line, int err, const char *msg)
+{
+	v->ok = 0;
+	v->line = line;
+	v->err = err;
+	snprintf(v->msg, sizeof(v->msg), "%s", msg);
+	return 0;
+}
+
+static double now_usec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int check_cmd(struct proof *p, struct ast *cmd, struct spec *spec,
+		     int lnum, struct verdict *v)
+{
+	char errbuf[sizeof(p->errbuf) + 32];
+
+	switch (cmd->type) {
+	case CMD_OPEN:
+		if (!push_box(p))
+			return fail(v, lnum, p->err, p->errbuf);
+		break;
+	case CMD_CLOSE:
+		if (!pop_box(p))
+			return fail(v, lnum, ERR_NO_BOX,
+				    "no boxes to close");
+		break;
+	case CMD_PRESUME:
+		if (spec && !spec_allows_premise(spec, cmd->lhs))
+			return fail(v, lnum, ERR_PREMISE,
+				    "premise not allowed by exercise");
+		if (!pushln(p, cmd, cmd->lhs))
+			return fail(v, lnum, p->err, p->errbuf);
+		break;
+	case CMD_ASSUME:
+		if (!at_beginning_of_box(p))
+			return fail(v, lnum, ERR_ASSUME,
+				    "assumption must appear at beginning of box");
+		if (!pushln(p, cmd, cmd->lhs))
+			return fail(v, lnum, p->err, p->errbuf);
+		break;
+	case CMD_APPLY:
+		if (!apply_rule(p, cmd)) {
+			snprintf(errbuf, sizeof(errbuf),
+				 "unable to apply rule: %s", p->errbuf);
+			return fail(v, lnum, p->err, errbuf);
+		}
+		break;
+	case CMD_EXPORT:
+	case CMD_EXPORT_CNF:
+		/* never write files on behalf of a checked script */
+		ast_destroy(cmd);
+		return 1;
+	case CMD_FIND:
+	case CMD_VALID:
+	case CMD_EQUIV:
+	case CMD_NNF:
+	case CMD_CNF:
+	case CMD_DNF:
+	case CMD_SIMPLIFY:
+		ast_destroy(cmd);
+		return 1;
+	case CMD_PROVE:
+		return fail(v, lnum, ERR_INPUTS,
+			    "prove is not allowed in checked proofs");
+	case CMD_NEW:
+		return fail(v, lnum, ERR_INPUTS,
+			    "new is not allowed in checked proofs");
+	}
+
+	pushcmd(p, cmd);
+	return 1;
+}
+
+int check_script(const char *text, size_t length, struct spec *spec,
+		 const struct limits *lim, struct verdict *v,
+		 check_report_fn report, void *arg)
+{
+	const char *line, *end = text + length, *nl;
+	char errbuf[sizeof(v->msg)];
+	struct parse_limits plim = { PARSE_MAX_NODES, PARSE_MAX_DEPTH, 0 };
+	struct lnresult r;
+	struct ast *cmd;
+	struct proof p;
+	int lnum = 0, lastcmd = 0, ok = 1, nsrc = 0, bad;
+	int *srclines = NULL;	/* the script line of each proof line */
+	char *model;
+	double t0 = 0;
+
+	p = new_proof();
+	if (lim) {
+		proof_set_limits(&p, lim);
+		if (lim->max_form_nodes && lim->max_form_nodes < plim.max_nodes)
+			plim.max_nodes = lim->max_form_nodes;
+		if (lim->max_form_depth && lim->max_form_depth < plim.max_depth)
+			plim.max_depth = lim->max_form_depth;
+	}
+	v->ok = 1;
+	v->line = 0;
+	v->err = ERR_OK;
+	v->msg[0] = 0;
+
+	for (line = text; ok && line < end; line = nl + 1) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+		lnum++;
+
+		const char *c = line;
+		while (c < nl && wspc(*c))
+			c++;
+		if (c == nl || *c == '#')
+			continue;
+
+		if (report)
+			t0 = now_usec();
+
+		r.rule = NULL;
+		cmd = parse_limited(line, nl - line, &plim, errbuf,
+				    sizeof(errbuf));
+		if (!cmd) {
+			ok = fail(v, lnum, plim.exceeded ? ERR_LIMIT : ERR_PARSE,
+				  errbuf);
+		} else {
+			if (cmd->type == CMD_APPLY)
+				r.rule = ast_rule_name(cmd);
+			ok = check_cmd(&p, cmd, spec, lnum, v);
+		}
+		lastcmd = lnum;
+		if (p.nlns > nsrc) {
+			srclines = realloc(srclines,
+					   p.nlns * sizeof(*srclines));
+			while (nsrc < p.nlns)
+				srclines[nsrc++] = lnum;
+		}
+
+		if (report) {
+			r.usec = now_usec() - t0;
+			r.line = lnum;
+			r.text = c;
+			r.textlen = nl - c;
+			r.err = ok ? ERR_OK : v->err;
+			r.msg = ok ? NULL : v->msg;
+			report(arg, &r);
+		}
+
+		if (!ok)
+			ast_destroy(cmd);
+	}
+
+	if (lim && lim->oracle && !oracle_check(&p, 0, &bad, &model)) {
+		snprintf(errbuf, sizeof(errbuf), "checker bug: the line does "
+			 "not follow, false when %s", model);
+		ok = fail(v, srclines[bad], ERR_ORACLE, errbuf);
+		free(model);
+	}
+	free(srclines);
+
+	if (ok && spec && !spec_reaches_goal(spec, &p))
+		ok = fail(v, lastcmd, ERR_GOAL, spec_ends_equivalent(spec, &p)
+			  ? "proof ends with an equivalent of the goal"
+			  : "proof does not end with the goal");
+
+	destroy_proof(&p);
+	return ok;
+}
+
+/* Runs commands, one line of input each, on p. */
+int check_cmds(struct proof *p, char **cmds, int n, struct verdict *v)
+{
+	char errbuf[sizeof(v->msg)];
+	struct ast *cmd;
+
+	v->ok = 1;
+	v->line = 0;
+	v->err = ERR_OK;
+	v->msg[0] = 0;
+
+	for (int i = 0; i < n; i++) {
+		cmd = parse(cmds[i], strlen(cmds[i]), errbuf, sizeof(errbuf));
+		if (!cmd)
+			return fail(v, i + 1, ERR_PARSE, errbuf);
+		if (!check_cmd(p, cmd, NULL, i + 1, v)) {
+			ast_destroy(cmd);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Hash of the script with comment lines and blank lines dropped and runs
+ * of whitespace collapsed to a single space, so reformatting a submission
+ * does not change its key. Whitespace is collapsed rather than removed
+ * since it separates tokens, e.g. "presume a b" vs. "presume ab".
+ */
+uint64_t script_hash(const char *text, size_t length)
+{
+	const char *line, *end = text + length, *nl;
+	uint64_t h = FNV_OFFSET;
+
+	for (line = text; line < end; line = nl + 1) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+
+		const char *c = line, *e = nl;
+		while (c < e && wspc(*c))
+			c++;
+		while (e > c && wspc(e[-1]))
+			e--;
+		if (c == e || *c == '#')
+			continue;
+
+		for (; c < e; c++) {
+			if (wspc(*c)) {
+				while (c + 1 < e && wspc(c[1]))
+					c++;
+				h = (h ^ ' ') * FNV_PRIME;
+			} else {
+				h = (h ^ (unsigned char)*c) * FNV_PRIME;
+			}
+		}
+		h = (h ^ '\n') * FNV_PRIME;
+	}
+
+	return h;
+}
+
+/* Whether the line is hashed, being neither blank nor a comment. */
+static int hashed(const char *line, const char *nl)
+{
+	while (line < nl && wspc(*line))
+		line++;
+	return line < nl && *line != '#';
+}
+
+/*
+ * Cached verdicts cannot keep script line numbers, which comments and
+ * blank lines shift without changing the hash. They keep the index of
+ * the command instead, counting from 1; 0 stays 0 either way.
+ */
+int script_cmd_index(const char *text, size_t length, int lnum)
+{
+	const char *line, *end = text + length, *nl;
+	int n = 0;
+
+	for (line = text; lnum > 0 && line < end; line = nl + 1, lnum--) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+		n += hashed(line, nl);
+	}
+	return n;
+}
+
+int script_cmd_line(const char *text, size_t length, int index)
+{
+	const char *line, *end = text + length, *nl;
+	int lnum = 0;
+
+	for (line = text; index > 0 && line < end; line = nl + 1) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+		lnum++;
+		index -= hashed(line, nl);
+	}
+	return lnum;
+}
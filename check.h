@@ -0,0 +1,39 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct verdict {
+	int ok;
+	int line;
+	int err;
+	char msg[108];
+};
+
+/* Outcome of a single command, passed to the report callback. */
+struct lnresult {
+	int line;
+	const char *text;
+	size_t textlen;
+	const char *rule;
+	int err;
+	const char *msg;
+	double usec;
+};
+
+struct spec;
+struct limits;
+struct proof;
+
+typedef void (*check_report_fn)(void *arg, const struct lnresult *r);
+
+int check_script(const char *text, size_t length, struct spec *spec,
+		 const struct limits *lim, struct verdict *v,
+		 check_report_fn report, void *arg);
+int check_cmds(struct proof *p, char **cmds, int n, struct verdict *v);
+uint64_t script_hash(const char *text, size_t length);
+int script_cmd_index(const char *text, size_t length, int lnum);
+int script_cmd_line(const char *text, size_t length, int index);
+
+#endif
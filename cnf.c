@@ -0,0 +1,188 @@
+#include "cnf.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+
+struct gate {
+	int op;			/* FORM_AND or FORM_OR */
+	int a;
+	int b;
+	int var;
+};
+
+struct cnf *cnf_new(void)
+{
+	return calloc(1, sizeof(struct cnf));
+}
+
+void cnf_destroy(struct cnf *c)
+{
+	if (!c)
+		return;
+	free(c->lits);
+	free(c->atoms);
+	free(c->atom_vars);
+	free(c->gates);
+	free(c->table);
+	free(c);
+}
+
+void cnf_clause(struct cnf *c, const int *lits, int n)
+{
+	if (c->nlits + n + 1 > c->litcap) {
+		c->litcap = 2 * (c->nlits + n + 1);
+		c->lits = realloc(c->lits, c->litcap * sizeof(*c->lits));
+	}
+	memcpy(c->lits + c->nlits, lits, n * sizeof(*lits));
+	c->nlits += n;
+	c->lits[c->nlits++] = 0;
+	c->nclauses++;
+}
+
+static size_t slot(int op, int a, int b, int tabcap)
+{
+	uint64_t h = ((uint64_t)op * 31 + (uint32_t)a) * 0x100000001b3ULL
+	    ^ (uint32_t)b;
+
+	h *= 0x9e3779b97f4a7c15ULL;
+	return (h >> 32) & (tabcap - 1);
+}
+
+static void rehash(struct cnf *c)
+{
+	struct gate *g;
+	size_t s;
+
+	free(c->table);
+	c->tabcap = c->tabcap ? 2 * c->tabcap : 1024;
+	c->table = calloc(c->tabcap, sizeof(*c->table));
+	for (int i = 0; i < c->ngates; i++) {
+		g = &c->gates[i];
+		s = slot(g->op, g->a, g->b, c->tabcap);
+		while (c->table[s])
+			s = (s + 1) & (c->tabcap - 1);
+		c->table[s] = i + 1;
+	}
+}
+
+/* The variable of a and b, or a or b, defined unless it is already. */
+static int gate(struct cnf *c, int op, int a, int b)
+{
+	struct gate *g;
+	size_t s;
+	int t, v;
+
+	if (a > b) {
+		t = a;
+		a = b;
+		b = t;
+	}
+	if (2 * (c->ngates + 1) > c->tabcap) {
+		rehash(c);
+		c->gates = realloc(c->gates, c->tabcap / 2 * sizeof(*c->gates));
+	}
+	s = slot(op, a, b, c->tabcap);
+	for (; c->table[s]; s = (s + 1) & (c->tabcap - 1)) {
+		g = &c->gates[c->table[s] - 1];
+		if (g->op == op && g->a == a && g->b == b)
+			return g->var;
+	}
+
+	v = ++c->nvars;
+	c->gates[c->ngates] = (struct gate){ op, a, b, v };
+	c->table[s] = ++c->ngates;
+	if (op == FORM_AND) {
+		cnf_clause(c, (int[]){ -v, a }, 2);
+		cnf_clause(c, (int[]){ -v, b }, 2);
+		cnf_clause(c, (int[]){ v, -a, -b }, 3);
+	} else {
+		cnf_clause(c, (int[]){ -v, a, b }, 3);
+		cnf_clause(c, (int[]){ v, -a }, 2);
+		cnf_clause(c, (int[]){ v, -b }, 2);
+	}
+	return v;
+}
+
+static int atom(struct cnf *c, const char *name)
+{
+	for (int i = 0; i < c->natoms; i++) {
+		if (strcmp(c->atoms[i], name) == 0)
+			return c->atom_vars[i];
+	}
+	c->atoms = realloc(c->atoms, (c->natoms + 1) * sizeof(*c->atoms));
+	c->atom_vars = realloc(c->atom_vars,
+			       (c->natoms + 1) * sizeof(*c->atom_vars));
+	c->atoms[c->natoms] = name;
+	c->atom_vars[c->natoms] = ++c->nvars;
+	return c->atom_vars[c->natoms++];
+}
+
+/* The literal equivalent to form, given the clauses added. */
+int cnf_lit(struct cnf *c, struct ast *form)
+{
+	int a;
+
+	switch (form->type) {
+	case FORM_NAME:
+		return atom(c, form->text);
+	case FORM_CON:
+		if (!c->false_var) {
+			c->false_var = ++c->nvars;
+			cnf_clause(c, (int[]){ -c->false_var }, 1);
+		}
+		return c->false_var;
+	case FORM_NOT:
+		return -cnf_lit(c, form->lhs);
+	case FORM_AND:
+	case FORM_OR:
+		a = cnf_lit(c, form->lhs);
+		return gate(c, form->type, a, cnf_lit(c, form->rhs));
+	default:
+		/* A -> B is -A / B */
+		a = cnf_lit(c, form->lhs);
+		return gate(c, FORM_OR, -a, cnf_lit(c, form->rhs));
+	}
+}
+
+/*
+ * The premises and the negated goal, as unit clauses over their literals:
+ * satisfiable exactly when some valuation makes the goal false and the
+ * premises true.
+ */
+struct cnf *cnf_sequent(struct ast **prems, int nprems, struct ast *goal)
+{
+	struct cnf *c = cnf_new();
+	int lit;
+
+	lit = -cnf_lit(c, goal);
+	cnf_clause(c, &lit, 1);
+	for (int i = 0; i < nprems; i++) {
+		lit = cnf_lit(c, prems[i]);
+		cnf_clause(c, &lit, 1);
+	}
+	return c;
+}
+
+/* Writes the clauses in DIMACS, naming the atoms in comments. */
+void cnf_write(struct cnf *c, FILE *f)
+{
+	for (int i = 0; i < c->natoms; i++)
+		fprintf(f, "c atom %d %s\n", c->atom_vars[i], c->atoms[i]);
+	fprintf(f, "p cnf %d %d\n", c->nvars, c->nclauses);
+	for (int i = 0; i < c->nlits; i++)
+		fprintf(f, c->lits[i] ? "%d " : "%d\n", c->lits[i]);
+}
+
+/* Writes the encoding of a sequent, under a comment saying where from. */
+void cnf_export(FILE *f, const char *title, struct ast **prems, int nprems,
+		struct ast *goal)
+{
+	struct cnf *c = cnf_sequent(prems, nprems, goal);
+
+	fprintf(f, "c %s\n", title);
+	fprintf(f, "c %d premises and the negated conclusion, unsatisfiable "
+		"iff valid\n", nprems);
+	cnf_write(c, f);
+	cnf_destroy(c);
+}
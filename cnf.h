@@ -0,0 +1,39 @@
+#ifndef CNF_H
+#define CNF_H
+
+#include <stdio.h>
+
+struct ast;
+
+/*
+ * A Tseitin encoding: every compound subformula gets a variable, defined
+ * by clauses equivalent to it, and equal subformulas share one, up to the
+ * order of the operands of ^ and /. Clauses are stored one after the
+ * other, each ended by 0 as in DIMACS.
+ */
+struct cnf {
+	int nvars;
+	int *lits;
+	int nlits;
+	int litcap;
+	int nclauses;
+	const char **atoms;	/* names, pointing into the formulas */
+	int *atom_vars;
+	int natoms;
+	struct gate *gates;
+	int ngates;
+	int *table;		/* open addressing, gate plus one */
+	int tabcap;
+	int false_var;
+};
+
+struct cnf *cnf_new(void);
+void cnf_destroy(struct cnf *c);
+int cnf_lit(struct cnf *c, struct ast *form);
+void cnf_clause(struct cnf *c, const int *lits, int n);
+void cnf_write(struct cnf *c, FILE *f);
+struct cnf *cnf_sequent(struct ast **prems, int nprems, struct ast *goal);
+void cnf_export(FILE *f, const char *title, struct ast **prems, int nprems,
+		struct ast *goal);
+
+#endif
@@ -0,0 +1,622 @@
+#include "egraph.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+
+/*
+ * The rewrites adding nodes, each allowed so many a round: one that
+ * reaches its allowance is banned for a round or more, and allowed
+ * twice as many after, so no one of them fills the graph on its own.
+ */
+enum rule { R_INPUT, R_NOT, R_IMPL, R_DIST, R_ASSOC, R_FACTOR, NRULES };
+
+#define RULE_SHARE 128	/* a rule adds at first 1/128 of the budget */
+
+/* An operator over classes, for an atom the index of its name in a. */
+struct enode {
+	int op;
+	int a;
+	int b;
+	int dup;		/* congruent to a node met before it */
+};
+
+struct egraph {
+	struct enode *nodes;
+	int *parent;		/* union-find, a class being its root */
+	int n;
+	int cap;
+	int max_nodes;
+	int *table;		/* open addressing, node plus one */
+	int tabcap;
+	char **names;
+	int nnames;
+	int bot;
+	int top;
+	int *pend;		/* pairs of classes to merge */
+	int npend;
+	int pendcap;
+	int *start;		/* the nodes of class c from start[c] */
+	int *members;
+	int round;
+	int rule;		/* the one new nodes are charged to */
+	int added[NRULES];	/* this round */
+	int bans[NRULES];
+	int until[NRULES];	/* round a ban ends */
+};
+
+int egraph_find(struct egraph *g, int c)
+{
+	while (g->parent[c] != c)
+		c = g->parent[c] = g->parent[g->parent[c]];
+	return c;
+}
+
+static int merge(struct egraph *g, int a, int b)
+{
+	a = egraph_find(g, a);
+	b = egraph_find(g, b);
+	if (a == b)
+		return 0;
+	if (a < b)
+		g->parent[b] = a;
+	else
+		g->parent[a] = b;
+	return 1;
+}
+
+static int dual(int op)
+{
+	return op == FORM_AND ? FORM_OR : FORM_AND;
+}
+
+static size_t slot(struct egraph *g, int op, int a, int b)
+{
+	uint64_t h = ((uint64_t)op * 31 + (uint32_t)a) * 0x100000001b3ULL
+	    ^ (uint32_t)b;
+
+	h *= 0x9e3779b97f4a7c15ULL;
+	return (h >> 32) & (g->tabcap - 1);
+}
+
+/* The operands as classes, those of ^ and / in order. */
+static void canon(struct egraph *g, int op, int *a, int *b)
+{
+	int t;
+
+	if (op == FORM_NAME || op == FORM_CON)
+		return;
+	*a = egraph_find(g, *a);
+	if (op == FORM_NOT)
+		return;
+	*b = egraph_find(g, *b);
+	if (op != FORM_IMPL && *a > *b) {
+		t = *a;
+		*a = *b;
+		*b = t;
+	}
+}
+
+/* The slot of the node, or the empty one it would go in. */
+static int *lookup(struct egraph *g, int op, int a, int b)
+{
+	struct enode *e;
+	size_t s = slot(g, op, a, b);
+
+	for (; g->table[s]; s = (s + 1) & (g->tabcap - 1)) {
+		e = &g->nodes[g->table[s] - 1];
+		if (e->op == op && e->a == a && e->b == b)
+			break;
+	}
+	return &g->table[s];
+}
+
+static void rehash(struct egraph *g)
+{
+	struct enode *e;
+
+	free(g->table);
+	g->tabcap = g->tabcap ? 2 * g->tabcap : 1024;
+	g->table = calloc(g->tabcap, sizeof(*g->table));
+	for (int i = 0; i < g->n; i++) {
+		e = &g->nodes[i];
+		if (!e->dup)
+			*lookup(g, e->op, e->a, e->b) = i + 1;
+	}
+}
+
+/* The nodes rule r may add in a round. */
+static int allowance(struct egraph *g, int r)
+{
+	if (r == R_INPUT)
+		return INT_MAX;
+	return (g->max_nodes + RULE_SHARE - 1) / RULE_SHARE << g->bans[r];
+}
+
+/*
+ * Whether rule r may fire this round, charging it for the nodes added
+ * until the next call. Past its allowance it still merges into nodes
+ * already there.
+ */
+static int may(struct egraph *g, int r)
+{
+	g->rule = r;
+	return g->round >= g->until[r];
+}
+
+/*
+ * The class of the node, added unless it is there already. An operand
+ * of -1, or a new node past the budget or the rule's allowance, gives
+ * -1.
+ */
+static int add(struct egraph *g, int op, int a, int b)
+{
+	int *s;
+
+	if (op != FORM_NAME && op != FORM_CON
+	    && (a < 0 || (op != FORM_NOT && b < 0)))
+		return -1;
+	canon(g, op, &a, &b);
+	s = lookup(g, op, a, b);
+	if (*s)
+		return egraph_find(g, *s - 1);
+	if (g->n == g->max_nodes || g->added[g->rule] >= allowance(g, g->rule))
+		return -1;
+
+	g->added[g->rule]++;
+	if (g->n == g->cap) {
+		g->cap = g->cap ? 2 * g->cap : 256;
+		g->nodes = realloc(g->nodes, g->cap * sizeof(*g->nodes));
+		g->parent = realloc(g->parent, g->cap * sizeof(*g->parent));
+	}
+	if (2 * (g->n + 1) > g->tabcap) {
+		rehash(g);
+		s = lookup(g, op, a, b);
+	}
+	g->nodes[g->n] = (struct enode){ op, a, b, 0 };
+	g->parent[g->n] = g->n;
+	*s = g->n + 1;
+	return g->n++;
+}
+
+struct egraph *egraph_new(int max_nodes)
+{
+	struct egraph *g = calloc(1, sizeof(*g));
+
+	g->max_nodes = max_nodes < 2 ? 2 : max_nodes;
+	rehash(g);
+	g->bot = add(g, FORM_CON, -1, -1);
+	g->top = add(g, FORM_NOT, g->bot, -1);
+	return g;
+}
+
+void egraph_destroy(struct egraph *g)
+{
+	if (!g)
+		return;
+	for (int i = 0; i < g->nnames; i++)
+		free(g->names[i]);
+	free(g->names);
+	free(g->nodes);
+	free(g->parent);
+	free(g->table);
+	free(g->pend);
+	free(g->start);
+	free(g->members);
+	free(g);
+}
+
+int egraph_nodes(struct egraph *g)
+{
+	return g->n;
+}
+
+/* The class of form, or -1 past the budget. */
+int egraph_add(struct egraph *g, struct ast *form)
+{
+	int a, i;
+
+	switch (form->type) {
+	case FORM_NAME:
+		for (i = 0; i < g->nnames; i++) {
+			if (strcmp(g->names[i], form->text) == 0)
+				break;
+		}
+		if (i == g->nnames) {
+			g->names = realloc(g->names,
+					   (g->nnames + 1) * sizeof(*g->names));
+			g->names[g->nnames++] = strdup(form->text);
+		}
+		return add(g, FORM_NAME, i, -1);
+	case FORM_CON:
+		return egraph_find(g, g->bot);
+	case FORM_NOT:
+		return add(g, FORM_NOT, egraph_add(g, form->lhs), -1);
+	default:
+		a = egraph_add(g, form->lhs);
+		return add(g, form->type, a, egraph_add(g, form->rhs));
+	}
+}
+
+/* Notes classes to merge once matching is done, b of -1 being none. */
+static void pend(struct egraph *g, int a, int b)
+{
+	if (b < 0 || a == b)
+		return;
+	if (g->npend + 2 > g->pendcap) {
+		g->pendcap = g->pendcap ? 2 * g->pendcap : 256;
+		g->pend = realloc(g->pend, g->pendcap * sizeof(*g->pend));
+	}
+	g->pend[g->npend++] = a;
+	g->pend[g->npend++] = b;
+}
+
+/* The nodes of each class, other than duplicates. */
+static void index_classes(struct egraph *g)
+{
+	int *pos;
+
+	free(g->start);
+	free(g->members);
+	g->start = calloc(g->n + 1, sizeof(*g->start));
+	g->members = malloc(g->n * sizeof(*g->members));
+	for (int i = 0; i < g->n; i++) {
+		if (!g->nodes[i].dup)
+			g->start[egraph_find(g, i) + 1]++;
+	}
+	for (int c = 0; c < g->n; c++)
+		g->start[c + 1] += g->start[c];
+	pos = malloc(g->n * sizeof(*pos));
+	memcpy(pos, g->start, g->n * sizeof(*pos));
+	for (int i = 0; i < g->n; i++) {
+		if (!g->nodes[i].dup)
+			g->members[pos[egraph_find(g, i)]++] = i;
+	}
+	free(pos);
+}
+
+/*
+ * Restores congruence after merging: nodes whose operands are now in
+ * one class are merged in turn, until a pass merges nothing and every
+ * node in the table is canonical.
+ */
+static void rebuild(struct egraph *g)
+{
+	struct enode *e;
+	int changed, *s;
+
+	do {
+		changed = 0;
+		memset(g->table, 0, g->tabcap * sizeof(*g->table));
+		for (int i = 0; i < g->n; i++) {
+			e = &g->nodes[i];
+			if (e->dup)
+				continue;
+			canon(g, e->op, &e->a, &e->b);
+			s = lookup(g, e->op, e->a, e->b);
+			if (*s) {
+				changed |= merge(g, i, *s - 1);
+				e->dup = 1;
+			} else {
+				*s = i + 1;
+			}
+		}
+	} while (changed);
+}
+
+/*
+ * Nodes are copied out of the graph, as adding to it may move them.
+ * Rewrites -x, in class c.
+ */
+static void match_not(struct egraph *g, int c, int x)
+{
+	struct enode m;
+	int ok = may(g, R_NOT);
+
+	for (int i = g->start[x]; i < g->start[x + 1]; i++) {
+		m = g->nodes[g->members[i]];
+		switch (m.op) {
+		case FORM_NOT:
+			/* --a = a */
+			pend(g, c, m.a);
+			break;
+		case FORM_AND:
+		case FORM_OR:
+			/* -(a ^ b) = -a / -b, -(a / b) = -a ^ -b */
+			if (!ok)
+				break;
+			pend(g, c, add(g, dual(m.op), add(g, FORM_NOT, m.a, -1),
+				       add(g, FORM_NOT, m.b, -1)));
+			break;
+		case FORM_IMPL:
+			/* -(a => b) = a ^ -b */
+			if (!ok)
+				break;
+			pend(g, c, add(g, FORM_AND, m.a,
+				       add(g, FORM_NOT, m.b, -1)));
+			break;
+		}
+	}
+}
+
+/*
+ * Whether x ^ y, or x / y, comes apart at once: y is x, a constant or
+ * the negation of x, or absorbs x.
+ */
+static int meets(struct egraph *g, int op, int x, int y)
+{
+	struct enode *m;
+
+	if (x == y || y == egraph_find(g, g->bot)
+	    || y == egraph_find(g, g->top))
+		return 1;
+	for (int i = g->start[y]; i < g->start[y + 1]; i++) {
+		m = &g->nodes[g->members[i]];
+		if ((m->op == FORM_NOT && m->a == x)
+		    || (m->op == dual(op) && (m->a == x || m->b == x)))
+			return 1;
+	}
+	for (int i = g->start[x]; i < g->start[x + 1]; i++) {
+		m = &g->nodes[g->members[i]];
+		if (m->op == FORM_NOT && m->a == y)
+			return 1;
+	}
+	return 0;
+}
+
+/* Rewrites x ^ y or x / y by the members of y, in class c. */
+static void match_join(struct egraph *g, int c, int op, int x, int y)
+{
+	int bot = egraph_find(g, g->bot), top = egraph_find(g, g->top);
+	int zero = op == FORM_AND ? bot : top, du = dual(op);
+	struct enode m;
+
+	/* a ^ a = a, a ^ _|_ = _|_, a ^ -_|_ = a */
+	if (x == y || y == (op == FORM_AND ? top : bot))
+		pend(g, c, x);
+	if (y == zero)
+		pend(g, c, zero);
+
+	for (int i = g->start[y]; i < g->start[y + 1]; i++) {
+		m = g->nodes[g->members[i]];
+		if (m.op == FORM_NOT && m.a == x) {
+			/* a ^ -a = _|_ */
+			pend(g, c, zero);
+		} else if (m.op == du) {
+			/* a ^ (a / b) = a */
+			if (m.a == x || m.b == x)
+				pend(g, c, x);
+			/*
+			 * a ^ (b / c) = (a ^ b) / (a ^ c), only where a
+			 * product then simplifies: distributing blindly
+			 * multiplies out every conjunction of disjunctions
+			 */
+			if (may(g, R_DIST) && (meets(g, op, x, m.a)
+					       || meets(g, op, x, m.b)))
+				pend(g, c, add(g, du, add(g, op, x, m.a),
+					       add(g, op, x, m.b)));
+		} else if (m.op == op && may(g, R_ASSOC)) {
+			/* a ^ (b ^ c) = (a ^ b) ^ c */
+			pend(g, c, add(g, op, add(g, op, x, m.a), m.b));
+			pend(g, c, add(g, op, add(g, op, x, m.b), m.a));
+		}
+	}
+
+	if (op != FORM_OR || !may(g, R_IMPL))
+		return;
+	for (int i = g->start[x]; i < g->start[x + 1]; i++) {
+		m = g->nodes[g->members[i]];
+		/* -a / b = a => b */
+		if (m.op == FORM_NOT)
+			pend(g, c, add(g, FORM_IMPL, m.a, y));
+	}
+}
+
+/* (a / b) ^ (a / c) = a / (b ^ c), for a shared operand s. */
+static void factor(struct egraph *g, int c, int op, int s, int p, int q)
+{
+	pend(g, c, add(g, dual(op), s, add(g, op, p, q)));
+}
+
+/* The rewrites of x ^ y or x / y needing members of both. */
+static void match_pair(struct egraph *g, int c, int op, int x, int y)
+{
+	struct enode m, k;
+	int du = dual(op);
+
+	for (int i = g->start[x]; i < g->start[x + 1]; i++) {
+		m = g->nodes[g->members[i]];
+		if ((m.op != FORM_NOT && m.op != du)
+		    || !may(g, m.op == FORM_NOT ? R_NOT : R_FACTOR))
+			continue;
+		for (int j = g->start[y]; j < g->start[y + 1]; j++) {
+			k = g->nodes[g->members[j]];
+			if (k.op != m.op)
+				continue;
+			/* -a ^ -b = -(a / b) */
+			if (m.op == FORM_NOT) {
+				pend(g, c, add(g, FORM_NOT,
+					       add(g, du, m.a, k.a), -1));
+				continue;
+			}
+			if (m.a == k.a)
+				factor(g, c, op, m.a, m.b, k.b);
+			if (m.a == k.b)
+				factor(g, c, op, m.a, m.b, k.a);
+			if (m.b == k.a)
+				factor(g, c, op, m.b, m.a, k.b);
+			if (m.b == k.b)
+				factor(g, c, op, m.b, m.a, k.a);
+		}
+	}
+}
+
+static void match(struct egraph *g, int i)
+{
+	struct enode e = g->nodes[i];
+	int c = egraph_find(g, i);
+
+	switch (e.op) {
+	case FORM_NOT:
+		match_not(g, c, e.a);
+		break;
+	case FORM_AND:
+	case FORM_OR:
+		match_join(g, c, e.op, e.a, e.b);
+		match_join(g, c, e.op, e.b, e.a);
+		match_pair(g, c, e.op, e.a, e.b);
+		break;
+	case FORM_IMPL:
+		/* a => b = -a / b */
+		if (may(g, R_IMPL))
+			pend(g, c, add(g, FORM_OR, add(g, FORM_NOT, e.a, -1),
+				       e.b));
+		break;
+	}
+}
+
+/*
+ * Bans the rules that used up their allowance this round, each for
+ * twice as many rounds as last time; returns whether any is banned.
+ */
+static int ban(struct egraph *g)
+{
+	int banned = 0;
+
+	for (int r = R_INPUT + 1; r < NRULES; r++) {
+		if (g->added[r] >= allowance(g, r)) {
+			g->until[r] = g->round + (1 << g->bans[r]);
+			if (allowance(g, r) < g->max_nodes)
+				g->bans[r]++;
+		}
+		banned |= g->until[r] > g->round;
+		g->added[r] = 0;
+	}
+	return banned;
+}
+
+/*
+ * Each round matches the nodes there are against the classes as they
+ * were, then merges and rebuilds. A round changing nothing while rules
+ * are banned lifts the bans; otherwise it ends saturation with 1. Gives
+ * 0 if the rounds, zero for no limit, or the node budget run out first.
+ * Bans are only set by rounds adding nodes, so the budget alone ends it.
+ */
+int egraph_saturate(struct egraph *g, int max_iters)
+{
+	int n, changed;
+
+	for (int it = 0; !max_iters || it < max_iters; it++) {
+		n = g->n;
+		g->npend = 0;
+		index_classes(g);
+		for (int i = 0; i < n; i++) {
+			if (!g->nodes[i].dup)
+				match(g, i);
+		}
+		g->rule = R_INPUT;
+		g->round++;
+		changed = g->n > n;
+		for (int i = 0; i < g->npend; i += 2)
+			changed |= merge(g, g->pend[i], g->pend[i + 1]);
+		rebuild(g);
+		if (ban(g) && !changed) {
+			memset(g->until, 0, sizeof(g->until));
+			continue;
+		}
+		if (!changed)
+			return 1;
+		if (g->n == g->max_nodes)
+			return 0;
+	}
+	return 0;
+}
+
+static struct ast *build(struct egraph *g, const int *pick, int c)
+{
+	struct enode *e = &g->nodes[pick[egraph_find(g, c)]];
+	struct ast *form = calloc(1, sizeof(*form));
+
+	form->type = e->op;
+	switch (e->op) {
+	case FORM_NAME:
+		form->text = strdup(g->names[e->a]);
+		break;
+	case FORM_CON:
+		break;
+	case FORM_NOT:
+		form->lhs = build(g, pick, e->a);
+		break;
+	default:
+		form->lhs = build(g, pick, e->a);
+		form->rhs = build(g, pick, e->b);
+	}
+	return form;
+}
+
+/*
+ * The smallest formula of class c, counting atoms, constants and
+ * operators. Costs are relaxed until they settle, every node costing
+ * more than its operands, so the picks never loop.
+ */
+struct ast *egraph_extract(struct egraph *g, int c)
+{
+	int *best = malloc(g->n * sizeof(*best));
+	int *pick = malloc(g->n * sizeof(*pick));
+	struct enode *e;
+	struct ast *form;
+	long cost;
+	int changed, r;
+
+	for (int i = 0; i < g->n; i++)
+		best[i] = INT_MAX;
+	do {
+		changed = 0;
+		for (int i = 0; i < g->n; i++) {
+			e = &g->nodes[i];
+			if (e->dup)
+				continue;
+			cost = 1;
+			if (e->op != FORM_NAME && e->op != FORM_CON)
+				cost += best[egraph_find(g, e->a)];
+			if (e->op == FORM_AND || e->op == FORM_OR
+			    || e->op == FORM_IMPL)
+				cost += best[egraph_find(g, e->b)];
+			r = egraph_find(g, i);
+			if (cost < best[r]) {
+				best[r] = cost;
+				pick[r] = i;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	form = build(g, pick, c);
+	free(best);
+	free(pick);
+	return form;
+}
+
+/*
+ * Whether the formulas end up in one class, saturating a round at a time
+ * and stopping as soon as they do or the budget is full. Not being shown
+ * equal, they may still be equivalent.
+ */
+int egraph_equiv(struct ast *a, struct ast *b, int max_nodes)
+{
+	struct egraph *g = egraph_new(max_nodes);
+	int x, y, res = 0;
+
+	x = egraph_add(g, a);
+	y = x < 0 ? -1 : egraph_add(g, b);
+	while (y >= 0 && egraph_find(g, x) != egraph_find(g, y)
+	       && g->n < g->max_nodes) {
+		if (egraph_saturate(g, 1))
+			break;
+	}
+	if (y >= 0)
+		res = egraph_find(g, x) == egraph_find(g, y);
+	egraph_destroy(g);
+	return res;
+}
@@ -0,0 +1,31 @@
+#ifndef EGRAPH_H
+#define EGRAPH_H
+
+struct ast;
+
+#define EGRAPH_MAX_NODES (1 << 14)
+
+/*
+ * An e-graph: e-nodes are hash-consed over the classes of their operands
+ * and classes of equivalent nodes are kept in a union-find, so a class
+ * stands for every formula its nodes can spell. Saturation rewrites by
+ * double negation, De Morgan, implication elimination, distribution,
+ * factoring, absorption, associativity, idempotence and the constants,
+ * until nothing changes, the rounds run out or the nodes reach the
+ * budget; each rewrite adding nodes has a share of the budget a round
+ * and is banned for a while past it. Operands of ^ and / are kept in
+ * order of class, commutativity being left to matching. Two formulas in one class are equivalent; in
+ * different ones they may still be, short of saturation.
+ */
+struct egraph;
+
+struct egraph *egraph_new(int max_nodes);
+void egraph_destroy(struct egraph *g);
+int egraph_add(struct egraph *g, struct ast *form);
+int egraph_saturate(struct egraph *g, int max_iters);
+int egraph_find(struct egraph *g, int c);
+int egraph_nodes(struct egraph *g);
+struct ast *egraph_extract(struct egraph *g, int c);
+int egraph_equiv(struct ast *a, struct ast *b, int max_nodes);
+
+#endif
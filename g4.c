@@ -0,0 +1,281 @@
+#include "g4.h"
+#include "parse.h"
+#include "prover.h"
+#include "term.h"
+
+/* The antecedent and consequent of t, if it is an implication. */
+static int arrow_parts(struct prover *pv, struct term *t, struct term **a,
+		       struct term **b)
+{
+	if (t->type == FORM_IMPL) {
+		*a = t->lhs;
+		*b = t->rhs;
+		return 1;
+	}
+	if (t->type == FORM_NOT) {
+		*a = t->lhs;
+		*b = pv->sh->bot;
+		return 1;
+	}
+	return 0;
+}
+
+static struct term *arrow(struct prover *pv, struct term *a, struct term *b)
+{
+	if (b == pv->sh->bot)
+		return neg(pv, a);
+	return term_make(pv->sh->terms, FORM_IMPL, a, b);
+}
+
+static struct deriv *arrow_elim(struct prover *pv, struct term *t,
+				struct deriv *dt, struct deriv *da)
+{
+	if (t->type == FORM_NOT)
+		return elim2(pv, RULE_NOT_ELIM, pv->sh->bot, da, dt);
+	return elim2(pv, RULE_IMPL_ELIM, t->rhs, da, dt);
+}
+
+static struct deriv *arrow_intro(struct prover *pv, struct term *t,
+				 struct deriv *body)
+{
+	int rule = t->type == FORM_NOT ? RULE_NOT_INTR : RULE_IMPL_INTR;
+	return boxed(pv, rule, t, t->lhs, body);
+}
+
+static void hide(struct prover *pv, int i)
+{
+	pv->ctx[i].hidden = 1;
+	pv->where[pv->ctx[i].t->id] = 0;
+	pv->ctxkey ^= pv->ctx[i].t->hash;
+}
+
+static void unhide(struct prover *pv, int i)
+{
+	pv->ctx[i].hidden = 0;
+	pv->where[pv->ctx[i].t->id] = i + 1;
+	pv->ctxkey ^= pv->ctx[i].t->hash;
+}
+
+/* Proves g in a box opened with hyp. */
+static struct deriv *g4_box(struct prover *pv, struct term *hyp,
+			    struct term *g)
+{
+	struct deriv *d;
+	int n;
+
+	n = assume(pv, hyp, mk(pv, HYP, hyp));
+	d = g4(pv, g);
+	pop(pv, n);
+	return d;
+}
+
+/* Proves g with t, derived by d, in place of the formula at i. */
+static struct deriv *g4_replace(struct prover *pv, int i, struct term *t,
+				struct deriv *d, struct term *g)
+{
+	int n;
+
+	hide(pv, i);
+	n = assume(pv, t, d);
+	d = g4(pv, g);
+	pop(pv, n);
+	unhide(pv, i);
+	return d;
+}
+
+/* The invertible left rules, on the first formula one applies to. Returns
+ * 0 if there is none. */
+static int g4_left(struct prover *pv, struct term *g, struct deriv **res)
+{
+	struct term *t, *a, *b, *c;
+	struct deriv *d, *e, *b1, *b2;
+	struct hyp h;
+	int n;
+
+	for (int i = 0; i < pv->nctx; i++) {
+		h = pv->ctx[i];
+		t = h.t;
+		if (h.hidden)
+			continue;
+
+		if (t->type == FORM_AND
+		    && (!lookup(pv, t->lhs) || !lookup(pv, t->rhs))) {
+			hide(pv, i);
+			n = assume(pv, t->lhs,
+				   elim1(pv, RULE_AND_ELIM_1, t->lhs, h.d));
+			n += assume(pv, t->rhs,
+				    elim1(pv, RULE_AND_ELIM_2, t->rhs, h.d));
+			*res = g4(pv, g);
+			pop(pv, n);
+			unhide(pv, i);
+			return 1;
+		}
+
+		if (t->type == FORM_OR && !lookup(pv, t->lhs)
+		    && !lookup(pv, t->rhs)) {
+			hide(pv, i);
+			*res = NULL;
+			if ((b1 = g4_box(pv, t->lhs, g))
+			    && (b2 = g4_box(pv, t->rhs, g))) {
+				d = mk(pv, RULE_OR_ELIM, g);
+				line_in(d, h.d);
+				box_in(d, t->lhs, b1);
+				box_in(d, t->rhs, b2);
+				*res = d;
+			}
+			unhide(pv, i);
+			return 1;
+		}
+
+		if (!arrow_parts(pv, t, &a, &b))
+			continue;
+
+		/* A => B and A */
+		if ((e = lookup(pv, a))) {
+			*res = g4_replace(pv, i, b, arrow_elim(pv, t, h.d, e),
+					  g);
+			return 1;
+		}
+
+		/* _|_ => B says nothing */
+		if (a == pv->sh->bot) {
+			hide(pv, i);
+			*res = g4(pv, g);
+			unhide(pv, i);
+			return 1;
+		}
+
+		/* C ^ D => B becomes C => D => B */
+		if (a->type == FORM_AND) {
+			c = arrow(pv, a->rhs, b);
+			d = elim2(pv, RULE_AND_INTR, a, mk(pv, HYP, a->lhs),
+				  mk(pv, HYP, a->rhs));
+			d = arrow_intro(pv, c, arrow_elim(pv, t, h.d, d));
+			c = arrow(pv, a->lhs, c);
+			*res = g4_replace(pv, i, c, arrow_intro(pv, c, d), g);
+			return 1;
+		}
+
+		/* C / D => B becomes C => B and D => B */
+		if (a->type == FORM_OR) {
+			hide(pv, i);
+			d = elim1(pv, RULE_OR_INTR_1, a, mk(pv, HYP, a->lhs));
+			form_in(d, a->rhs);
+			c = arrow(pv, a->lhs, b);
+			n = assume(pv, c, arrow_intro(pv, c,
+						      arrow_elim(pv, t, h.d,
+								 d)));
+			d = mk(pv, RULE_OR_INTR_2, a);
+			form_in(d, a->lhs);
+			line_in(d, mk(pv, HYP, a->rhs));
+			c = arrow(pv, a->rhs, b);
+			n += assume(pv, c, arrow_intro(pv, c,
+						       arrow_elim(pv, t, h.d,
+								  d)));
+			*res = g4(pv, g);
+			pop(pv, n);
+			unhide(pv, i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* (C => D) => B, proving C => D with D => B in place of it, then g with
+ * B in place of it. */
+static struct deriv *g4_impl_impl(struct prover *pv, int i, struct term *g)
+{
+	struct term *t = pv->ctx[i].t, *a, *b, *c, *d, *db;
+	struct deriv *dt = pv->ctx[i].d, *p1, *e;
+	int n = 0;
+
+	arrow_parts(pv, t, &a, &b);
+	arrow_parts(pv, a, &c, &d);
+
+	hide(pv, i);
+	/* _|_ => B says nothing */
+	if (d != pv->sh->bot) {
+		db = arrow(pv, d, b);
+		e = arrow_elim(pv, t, dt, arrow_intro(pv, a, mk(pv, HYP, d)));
+		n = assume(pv, db, arrow_intro(pv, db, e));
+	}
+	p1 = g4(pv, a);
+	pop(pv, n);
+
+	e = NULL;
+	if (p1) {
+		n = assume(pv, b, arrow_elim(pv, t, dt, p1));
+		e = g4(pv, g);
+		pop(pv, n);
+	}
+	unhide(pv, i);
+	return e;
+}
+
+static struct deriv *g4_expand(struct prover *pv, struct term *g)
+{
+	struct deriv *d, *a, *b;
+	struct term *t, *x, *y;
+
+	if (g4_left(pv, g, &d))
+		return d;
+
+	switch (g->type) {
+	case FORM_AND:
+		if (!(a = g4(pv, g->lhs)) || !(b = g4(pv, g->rhs)))
+			return NULL;
+		return elim2(pv, RULE_AND_INTR, g, a, b);
+	case FORM_IMPL:
+	case FORM_NOT:
+		arrow_parts(pv, g, &x, &y);
+		return arrow_intro(pv, g, g4_box(pv, x, y));
+	case FORM_OR:
+		if ((a = g4(pv, g->lhs))) {
+			d = elim1(pv, RULE_OR_INTR_1, g, a);
+			form_in(d, g->rhs);
+			return d;
+		}
+		if ((a = g4(pv, g->rhs))) {
+			d = mk(pv, RULE_OR_INTR_2, g);
+			form_in(d, g->lhs);
+			line_in(d, a);
+			return d;
+		}
+		break;
+	}
+
+	for (int i = 0; i < pv->nctx && !stopped(pv); i++) {
+		t = pv->ctx[i].t;
+		if (pv->ctx[i].hidden || !arrow_parts(pv, t, &x, &y)
+		    || (x->type != FORM_IMPL && x->type != FORM_NOT))
+			continue;
+		if ((d = g4_impl_impl(pv, i, g)))
+			return d;
+	}
+	return NULL;
+}
+
+struct deriv *g4(struct prover *pv, struct term *g)
+{
+	struct deriv *d;
+	int failed;
+
+	if ((d = lookup(pv, g)))
+		return d;
+	if ((d = lookup(pv, pv->sh->bot))) {
+		d = elim1(pv, RULE_CON_ELIM, g, d);
+		form_in(d, g);
+		return d;
+	}
+	if (stopped(pv) || !tick(pv))
+		return NULL;
+
+	recall(pv, g, 0, &failed);
+	if (failed)
+		return NULL;
+
+	d = g4_expand(pv, g);
+	if (!d && !stopped(pv))
+		memoize(pv, g, 0, NULL);
+	return d;
+}
@@ -0,0 +1,21 @@
+#ifndef G4_H
+#define G4_H
+
+struct deriv;
+struct prover;
+struct term;
+
+/*
+ * Deciding intuitionistic provability, with the contraction-free sequent
+ * calculus G4ip. Each left rule replaces its principal formula by smaller
+ * ones, which makes the search terminate without loop checks. The
+ * principal formula is hidden from the context instead of removed, and
+ * every formula added comes with its derivation, so a successful search
+ * is a natural deduction proof without PBC, LEM or --e.
+ *
+ * -A is taken as A => _|_ throughout, introduced with -i and eliminated
+ * with -e.
+ */
+struct deriv *g4(struct prover *pv, struct term *g);
+
+#endif
@@ -0,0 +1,199 @@
+#include "index.h"
+#include <stdlib.h>
+#include <string.h>
+#include "proof.h"
+
+#define MAX_METAVARS 16
+
+struct bind {
+	const char *name;
+	struct ast *form;
+};
+
+void index_destroy(struct index *idx)
+{
+	free(idx->ents);
+	free(idx->buckets);
+	memset(idx, 0, sizeof(*idx));
+}
+
+static void rehash(struct index *idx)
+{
+	int mask;
+
+	free(idx->buckets);
+	idx->nbuckets = idx->nbuckets ? 2 * idx->nbuckets : 64;
+	idx->buckets = calloc(idx->nbuckets, sizeof(*idx->buckets));
+	mask = idx->nbuckets - 1;
+
+	for (int i = 0; i < idx->nents; i++) {
+		struct ient *e = &idx->ents[i];
+		e->next = idx->buckets[e->hash & mask];
+		idx->buckets[e->hash & mask] = i + 1;
+	}
+}
+
+void index_add(struct index *idx, int line, struct ast *form)
+{
+	struct ient *e;
+	int *bucket;
+
+	if (idx->nents == idx->cap) {
+		idx->cap = idx->cap ? 2 * idx->cap : 32;
+		idx->ents = realloc(idx->ents, idx->cap * sizeof(*idx->ents));
+	}
+	if (idx->nents >= idx->nbuckets)
+		rehash(idx);
+
+	e = &idx->ents[idx->nents++];
+	e->hash = ast_hash(form);
+	e->line = line;
+	e->type = form->type;
+
+	bucket = &idx->buckets[e->hash & (idx->nbuckets - 1)];
+	e->next = *bucket;
+	*bucket = idx->nents;
+	e->nexttype = idx->bytype[form->type];
+	idx->bytype[form->type] = idx->nents;
+}
+
+/* Drops the entries for line and every line after it. */
+void index_truncate(struct index *idx, int line)
+{
+	struct ient *e;
+
+	while (idx->nents && idx->ents[idx->nents - 1].line >= line) {
+		e = &idx->ents[idx->nents - 1];
+		idx->buckets[e->hash & (idx->nbuckets - 1)] = e->next;
+		idx->bytype[e->type] = e->nexttype;
+		idx->nents--;
+	}
+}
+
+/* Returns the most recent visible line holding form, or -1. */
+int index_find(struct proof *p, struct ast *form)
+{
+	struct index *idx = &p->idx;
+	uint64_t h;
+	int i;
+
+	if (!idx->nents)
+		return -1;
+
+	h = ast_hash(form);
+	for (i = idx->buckets[h & (idx->nbuckets - 1)]; i;
+	     i = idx->ents[i - 1].next) {
+		struct ient *e = &idx->ents[i - 1];
+		if (e->hash == h && ast_equal(p->lns[e->line].form, form))
+			return e->line;
+	}
+	return -1;
+}
+
+static int is_metavar(struct ast *pat)
+{
+	return pat->type == FORM_NAME && pat->text[0] == '?';
+}
+
+/* Whether pat has no metavariables, so that it can be looked up by hash. */
+int pat_is_exact(struct ast *pat)
+{
+	if (!pat)
+		return 1;
+	if (is_metavar(pat))
+		return 0;
+	return pat_is_exact(pat->lhs) && pat_is_exact(pat->rhs);
+}
+
+static int match(struct ast *pat, struct ast *form, struct bind *b, int *nb)
+{
+	if (is_metavar(pat)) {
+		for (int i = 0; i < *nb; i++) {
+			if (strcmp(b[i].name, pat->text) == 0)
+				return ast_equal(b[i].form, form);
+		}
+		if (*nb == MAX_METAVARS)
+			return 0;
+		b[*nb].name = pat->text;
+		b[(*nb)++].form = form;
+		return 1;
+	}
+
+	if (pat->type != form->type)
+		return 0;
+	if (pat->type == FORM_NAME)
+		return strcmp(pat->text, form->text) == 0;
+	if (pat->lhs && !match(pat->lhs, form->lhs, b, nb))
+		return 0;
+	return !pat->rhs || match(pat->rhs, form->rhs, b, nb);
+}
+
+/*
+ * Stores up to max visible lines whose formula matches pat, most recent
+ * first, and returns how many there are in total. Names starting with
+ * '?' in pat are metavariables.
+ */
+int index_match(struct proof *p, struct ast *pat, int *lines, int max)
+{
+	struct index *idx = &p->idx;
+	struct bind b[MAX_METAVARS];
+	struct ient *e;
+	uint64_t h;
+	int n = 0, nb, i;
+
+	if (!idx->nents)
+		return 0;
+
+	if (pat_is_exact(pat)) {
+		h = ast_hash(pat);
+		for (i = idx->buckets[h & (idx->nbuckets - 1)]; i; i = e->next) {
+			e = &idx->ents[i - 1];
+			if (e->hash != h || !ast_equal(p->lns[e->line].form, pat))
+				continue;
+			if (n < max)
+				lines[n] = e->line;
+			n++;
+		}
+		return n;
+	}
+
+	if (is_metavar(pat)) {
+		for (i = idx->nents; i; i--) {
+			if (n < max)
+				lines[n] = idx->ents[i - 1].line;
+			n++;
+		}
+		return n;
+	}
+
+	for (i = idx->bytype[pat->type]; i; i = idx->ents[i - 1].nexttype) {
+		nb = 0;
+		if (!match(pat, p->lns[idx->ents[i - 1].line].form, b, &nb))
+			continue;
+		if (n < max)
+			lines[n] = idx->ents[i - 1].line;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Stores up to max visible lines whose main connective is type, or all
+ * visible lines if type is negative, most recent first.
+ */
+int index_lines(struct proof *p, int type, int *lines, int max)
+{
+	struct index *idx = &p->idx;
+	int n = 0, i;
+
+	if (type < 0) {
+		for (i = idx->nents; i && n < max; i--)
+			lines[n++] = idx->ents[i - 1].line;
+		return n;
+	}
+
+	for (i = idx->bytype[type]; i && n < max;
+	     i = idx->ents[i - 1].nexttype)
+		lines[n++] = idx->ents[i - 1].line;
+	return n;
+}
@@ -0,0 +1,41 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdint.h>
+#include "parse.h"
+
+struct proof;
+
+/*
+ * The lines visible from the end of the proof, indexed by formula hash
+ * and by main connective. Closing a box hides exactly the most recently
+ * added lines, so the entries form a stack and every chain is kept
+ * newest first. Chain links are entry numbers plus one, so a zeroed index
+ * is empty.
+ */
+struct ient {
+	uint64_t hash;
+	int line;
+	int type;
+	int next;
+	int nexttype;
+};
+
+struct index {
+	struct ient *ents;
+	int nents;
+	int cap;
+	int *buckets;
+	int nbuckets;
+	int bytype[FORM_NAME + 1];
+};
+
+void index_destroy(struct index *idx);
+void index_add(struct index *idx, int line, struct ast *form);
+void index_truncate(struct index *idx, int line);
+int index_find(struct proof *p, struct ast *form);
+int index_match(struct proof *p, struct ast *pat, int *lines, int max);
+int index_lines(struct proof *p, int type, int *lines, int max);
+int pat_is_exact(struct ast *pat);
+
+#endif
@@ -0,0 +1,161 @@
+#include "lemma.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "apply.h"
+#include "check.h"
+#include "schema.h"
+#include "spec.h"
+
+/*
+ * A lemma file holds derived rules together with their proofs:
+ *
+ *	lemma HS: A => B, B => C |- A => C
+ *	presume A => B
+ *	...
+ *	qed
+ *
+ * The proof is checked once, when the file is loaded, against the
+ * premises and conclusion in the header, with the builtin rules only and
+ * within the limits of checked proofs. The lemma is then registered as
+ * a rule, and applying it instantiates the header by uniform substitution
+ * of its atoms without looking at the proof again.
+ */
+
+struct lemma {
+	char *name;
+	char *sequent;
+	char *body;
+	size_t bodylen;
+	size_t bodycap;
+	int line;
+};
+
+static void append(struct lemma *l, const char *line)
+{
+	size_t n = strlen(line);
+
+	while (l->bodylen + n + 2 > l->bodycap) {
+		l->bodycap = l->bodycap ? 2 * l->bodycap : 256;
+		l->body = realloc(l->body, l->bodycap);
+	}
+	memcpy(l->body + l->bodylen, line, n);
+	l->bodylen += n;
+	l->body[l->bodylen++] = '\n';
+}
+
+static int verify(struct lemma *l, const char *path,
+		  const struct limits *lim, char *errbuf, size_t errbufsz)
+{
+	struct verdict v;
+	struct schema *s;
+	struct spec *spec;
+	char serr[128];
+
+	s = schema_compile(l->sequent, serr, sizeof(serr));
+	if (!s) {
+		snprintf(errbuf, errbufsz, "%s:%d: %s", path, l->line, serr);
+		return 0;
+	}
+
+	spec = spec_new();
+	for (int i = 0; i < s->nslots; i++) {
+		if (s->slots[i].type == INPUT_BOX) {
+			snprintf(errbuf, errbufsz,
+				 "%s:%d: lemma premises cannot be boxes",
+				 path, l->line);
+			spec_destroy(spec);
+			schema_destroy(s);
+			return 0;
+		}
+		if (s->slots[i].type == INPUT_LINE)
+			spec_add_premise(spec,
+					 pat_to_ast(s, s->slots[i].first));
+	}
+	spec_set_goal(spec, pat_to_ast(s, s->concl));
+
+	apply_builtin_only(1);
+	check_script(l->body, l->bodylen, spec, lim, &v, NULL, NULL);
+	apply_builtin_only(0);
+	spec_destroy(spec);
+
+	if (!v.ok) {
+		snprintf(errbuf, errbufsz, "%s:%d: lemma %s: %s", path,
+			 l->line + v.line, l->name, v.msg);
+		schema_destroy(s);
+		return 0;
+	}
+
+	apply_add_rule(l->name, l->sequent, s);
+	return 1;
+}
+
+int lemma_load(const char *path, const struct limits *lim, char *errbuf,
+	       size_t errbufsz)
+{
+	struct lemma l = { 0 };
+	char *line = NULL, *c, *colon;
+	size_t cap = 0;
+	int lnum = 0, inside = 0, ok = 1;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		snprintf(errbuf, errbufsz, "%s: unable to read file", path);
+		return 0;
+	}
+
+	while (ok && getline(&line, &cap, f) > 0) {
+		lnum++;
+		line[strcspn(line, "\r\n")] = 0;
+		for (c = line; *c == ' ' || *c == '\t'; c++) ;
+
+		if (inside) {
+			if (strcmp(c, "qed") == 0) {
+				ok = verify(&l, path, lim, errbuf, errbufsz);
+				inside = 0;
+			} else {
+				append(&l, line);
+			}
+			continue;
+		}
+
+		if (!*c || *c == '#')
+			continue;
+
+		colon = strchr(c, ':');
+		if (strncmp(c, "lemma ", 6) != 0 || !colon) {
+			snprintf(errbuf, errbufsz,
+				 "%s:%d: expected lemma name: sequent", path,
+				 lnum);
+			ok = 0;
+			break;
+		}
+
+		*colon = 0;
+		for (c += 6; *c == ' ' || *c == '\t'; c++) ;
+		c[strcspn(c, " \t")] = 0;
+
+		free(l.name);
+		free(l.sequent);
+		l.name = strdup(c);
+		l.sequent = strdup(colon + 1);
+		l.bodylen = 0;
+		l.line = lnum;
+		inside = 1;
+	}
+
+	if (ok && inside) {
+		snprintf(errbuf, errbufsz, "%s:%d: lemma %s: missing qed", path,
+			 l.line, l.name);
+		ok = 0;
+	}
+
+	free(l.name);
+	free(l.sequent);
+	free(l.body);
+	free(line);
+	fclose(f);
+	return ok;
+}
@@ -0,0 +1,11 @@
+#ifndef LEMMA_H
+#define LEMMA_H
+
+#include <stddef.h>
+
+struct limits;
+
+int lemma_load(const char *path, const struct limits *lim, char *errbuf,
+	       size_t errbufsz);
+
+#endif
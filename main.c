@@ -3,21 +3,65 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <termios.h>
+#include <getopt.h>
+#include <errno.h>
+#include <limits.h>
 #include "parse.h"
 #include "linenoise.h"
 #include "proof.h"
 #include "apply.h"
 #include "log.h"
 #include "tex.h"
+#include "batch.h"
+#include "lemma.h"
+#include "prove.h"
+#include "syntax.h"
+#include "valid.h"
+#include "cnf.h"
+#include "bdd.h"
+#include "oracle.h"
+#include "term.h"
+#include "norm.h"
+#include "egraph.h"
 
 #define ERROR "    \x1b[31merror:\x1b[0m "
 #define OK "    \x1b[32mok:\x1b[0m "
 #define CLEAR "\x1b[2K\r"
+#define STREAM_BUFSZ (1 << 16)
+#define MAX_FOUND 16
 
 struct termios old, new;
 const char *boxlines = "| | | | | | | | | | | | | | | | | | | | | ";
 const int annotcol = 80;
 
+/*
+ * In stream mode nde is a filter: commands are read from a buffered stdin
+ * and the annotated proof is written to a fully buffered stdout, without
+ * terminal control sequences.
+ */
+static int streaming = 0;
+
+/* The proof being edited, for tab completion. */
+static struct proof *editing;
+
+/* Errors reported so far, to stop replaying generated commands. */
+static int nerrors = 0;
+
+/*
+ * In stream mode the rest of a proof is skipped after an error, up to
+ * the next new command, and nde exits with 1 at the end.
+ */
+static int skipping = 0;
+
+/* Whether lines are cross-checked by truth tables as they are added. */
+static int oracle;
+
+/* Variable order of the BDDs built by equiv. */
+static const char *bdd_order;
+
+static struct prove_opts popts = { PROVE_MAX_DEPTH, PROVE_MAX_STEPS, 1,
+	PROVE_MAX_TIME, 0, 0, 0, 0, 0, 0 };
+
 void term_restore(void)
 {
 	tcsetattr(STDIN_FILENO, TCSANOW, &old);
@@ -25,11 +69,13 @@ void term_restore(void)
 
 void error(const char *msg)
 {
-	printf(ERROR "%s", msg);
-	if (!isatty(STDIN_FILENO)) {
-		printf("\n");
-		exit(1);
+	nerrors++;
+	if (streaming) {
+		printf("error: %s\n", msg);
+		skipping = 1;
+		return;
 	}
+	printf(ERROR "%s", msg);
 	(void)fgetc(stdin);
 	printf(CLEAR);
 	fflush(stdout);
@@ -37,16 +83,24 @@ void error(const char *msg)
 
 void msg(const char *msg)
 {
-	printf(OK "%s", msg);
-	if (!isatty(STDIN_FILENO)) {
-		printf("\n");
-		exit(1);
+	if (streaming) {
+		printf("ok: %s\n", msg);
+		return;
 	}
+	printf(OK "%s", msg);
 	(void)fgetc(stdin);
 	printf(CLEAR);
 	fflush(stdout);
 }
 
+void clear(void)
+{
+	if (streaming)
+		return;
+	printf(CLEAR);
+	fflush(stdout);
+}
+
 char first_non_wspc(const char *str)
 {
 	while (*str && (*str == ' ' || *str == '\t' || *str == '\n'))
@@ -56,14 +110,720 @@ char first_non_wspc(const char *str)
 
 void println(const char *prompt, const char *formstr, const char *annot)
 {
+	int n;
+
+	if (streaming) {
+		n = printf("%s%s", prompt, formstr);
+		if (*annot)
+			printf("%*s%s", n < annotcol - 1 ? annotcol - 1 - n : 1,
+			       "", annot);
+		putchar('\n');
+		return;
+	}
 	printf("%s%s\x1b[%dG%s\n", prompt, formstr, annotcol, annot);
 	fflush(stdout);
 }
 
+static char *read_line(const char *prompt)
+{
+	static char *buf = NULL;
+	static size_t cap = 0;
+	ssize_t n;
+
+	if (!streaming)
+		return linenoise(prompt);
+
+	n = getline(&buf, &cap, stdin);
+	if (n < 0)
+		return NULL;
+	if (n && buf[n - 1] == '\n')
+		buf[n - 1] = 0;
+	return buf;
+}
+
+static void free_line(char *line)
+{
+	if (!streaming)
+		linenoiseFree(line);
+}
+
+static void find(struct proof *p, struct ast *pat)
+{
+	char buf[512];
+	int lines[MAX_FOUND];
+	int n, len, shown;
+
+	n = index_match(p, pat, lines, MAX_FOUND);
+	if (!n) {
+		msg("no visible line matches");
+		return;
+	}
+
+	shown = n < MAX_FOUND ? n : MAX_FOUND;
+	len = snprintf(buf, sizeof(buf), n == 1 ? "line" : "lines");
+	for (int i = shown - 1; i >= 0; i--)
+		len += snprintf(buf + len, sizeof(buf) - len, "%s %d",
+				i == shown - 1 ? "" : ",", lines[i] + 1);
+	if (n > shown)
+		snprintf(buf + len, sizeof(buf) - len, " and %d more",
+			 n - shown);
+	msg(buf);
+}
+
+/*
+ * Completes the last input of an apply command given as a formula or
+ * pattern, e.g. "apply =>e 1, ?A => q", to the visible lines matching it.
+ */
+static void complete(const char *buf, linenoiseCompletions *lc)
+{
+	char errbuf[128];
+	char out[1024];
+	int lines[MAX_FOUND];
+	const char *arg;
+	struct ast *pat;
+	int n;
+
+	if (strncmp(buf, "apply ", 6) != 0)
+		return;
+	arg = strrchr(buf, ',');
+	if (arg) {
+		arg++;
+	} else {
+		for (arg = buf + 6; *arg == ' '; arg++) ;
+		arg += strcspn(arg, " ");
+	}
+	arg += strspn(arg, " ");
+	if (!*arg)
+		return;
+
+	pat = parse_pattern(arg, strlen(arg), errbuf, sizeof(errbuf));
+	if (!pat)
+		return;
+
+	n = index_match(editing, pat, lines, MAX_FOUND);
+	for (int i = 0; i < n && i < MAX_FOUND; i++) {
+		snprintf(out, sizeof(out), "%.*s%d", (int)(arg - buf), buf,
+			 lines[i] + 1);
+		linenoiseAddCompletion(lc, out);
+	}
+	ast_destroy(pat);
+}
+
+/* Reports whether the premises of cmd entail its conclusion. */
+static void run_valid(struct ast *cmd)
+{
+	struct ast *prems[64], **v = prems;
+	char errbuf[256], *model, *text;
+	int n = 0, res;
+
+	for (struct ast *in = cmd->lhs; in; in = in->rhs)
+		n++;
+	if (n > 64)
+		v = malloc(n * sizeof(*v));
+	n = 0;
+	for (struct ast *in = cmd->lhs; in; in = in->rhs)
+		v[n++] = in->lhs;
+
+	res = valid(v, n, cmd->rhs, &model, errbuf, sizeof(errbuf));
+	if (v != prems)
+		free(v);
+	if (res < 0) {
+		error(errbuf);
+		return;
+	}
+	if (res) {
+		msg("valid");
+		return;
+	}
+	/* without atoms there is the one valuation */
+	text = malloc(strlen(model) + 32);
+	sprintf(text, *model ? "invalid, false when %s" : "invalid", model);
+	msg(text);
+	free(text);
+	free(model);
+}
+
+/*
+ * Writes the sequent of a line as CNF: the premises and the assumptions
+ * of the boxes around it, entailing its formula.
+ */
+static void run_export_cnf(struct proof *p, struct ast *cmd)
+{
+	struct ast **prems;
+	char text[512];
+	int n = cmd->rhs ? cmd->rhs->start : p->nlns - 1, nprems;
+	FILE *outf;
+
+	if (n < 0 || n >= p->nlns) {
+		error(p->nlns ? "no such line" : "no lines to export");
+		return;
+	}
+	prems = malloc((n + 1) * sizeof(*prems));
+	nprems = proof_context(p, n, prems);
+
+	outf = fopen(cmd->text, "w");
+	if (!outf) {
+		error("unable to open file for writing");
+	} else {
+		snprintf(text, sizeof(text), "line %d", n + 1);
+		cnf_export(outf, text, prems, nprems, p->lns[n].form);
+		fclose(outf);
+		snprintf(text, sizeof(text), "exported line %d to %s", n + 1,
+			 cmd->text);
+		msg(text);
+	}
+	free(prems);
+}
+
+/* Reports whether the two formulas of cmd are equivalent. */
+static void run_equiv(struct ast *cmd)
+{
+	struct bdd *m = bdd_new(bdd_order);
+	char *model, *text;
+	int a, b, x;
+
+	a = bdd_of(m, cmd->lhs);
+	b = a < 0 ? -1 : bdd_of(m, cmd->rhs);
+	x = bdd_xor(m, a, b);
+	if (x < 0) {
+		/* the e-graph can still show them equal */
+		if (egraph_equiv(cmd->lhs, cmd->rhs, EGRAPH_MAX_NODES))
+			msg("equivalent");
+		else
+			error("too many BDD nodes, try another --bdd-order");
+	} else if (x == BDD_FALSE) {
+		msg("equivalent");
+	} else {
+		model = bdd_sat(m, x);
+		text = malloc(strlen(model) + 32);
+		sprintf(text, *model ? "not equivalent, differ when %s"
+			: "not equivalent", model);
+		msg(text);
+		free(text);
+		free(model);
+	}
+	bdd_destroy(m);
+}
+
+/*
+ * Prints the formula of cmd in the normal form asked for. A CNF past the
+ * size limit falls back to the Tseitin encoding, with fresh atoms.
+ */
+static void run_normal(struct ast *cmd)
+{
+	struct terms *t = terms_new();
+	struct normalizer *n = norm_new(t, NORM_MAX_LITS);
+	struct term *form = term_from_ast(t, cmd->lhs), *res;
+	char *prefix = NULL, *str, *text;
+	int nfresh = 0;
+
+	if (cmd->type == CMD_NNF)
+		res = norm_nnf(n, form);
+	else if (cmd->type == CMD_DNF)
+		res = norm_dnf(n, form);
+	else if (!(res = norm_cnf(n, form)))
+		res = norm_tseitin(n, form, &prefix, &nfresh);
+
+	if (!res) {
+		text = malloc(64);
+		sprintf(text, "DNF over %d literals", NORM_MAX_LITS);
+		error(text);
+	} else {
+		str = term_str(res);
+		text = malloc(strlen(str) + 128);
+		if (prefix)
+			sprintf(text, "CNF over %d literals, equisatisfiable "
+				"with %d fresh atoms %s...: %s", NORM_MAX_LITS,
+				nfresh, prefix, str);
+		else
+			strcpy(text, str);
+		msg(text);
+		free(str);
+	}
+	free(text);
+	free(prefix);
+	norm_destroy(n);
+	terms_destroy(t);
+}
+
+/*
+ * Prints the smallest formula equivalent to that of cmd found by
+ * saturating an e-graph, noting if the budget cut it short.
+ */
+static void run_simplify(struct ast *cmd)
+{
+	struct egraph *g = egraph_new(EGRAPH_MAX_NODES);
+	struct terms *t;
+	struct ast *form;
+	char *str, *text;
+	int c, done;
+
+	if ((c = egraph_add(g, cmd->lhs)) < 0) {
+		error("formula over the e-graph node budget");
+		egraph_destroy(g);
+		return;
+	}
+	done = egraph_saturate(g, 0);
+	form = egraph_extract(g, c);
+	t = terms_new();
+	str = term_str(term_from_ast(t, form));
+	text = malloc(strlen(str) + 64);
+	if (done)
+		strcpy(text, str);
+	else
+		sprintf(text, "%s, not saturated at %d e-nodes", str,
+			egraph_nodes(g));
+	msg(text);
+	free(text);
+	free(str);
+	terms_destroy(t);
+	ast_destroy(form);
+	egraph_destroy(g);
+}
+
+/* Reports the last line if it does not follow from its context. */
+static void run_oracle(struct proof *p)
+{
+	char *model, *text;
+	int bad;
+
+	if (oracle_check(p, p->nlns - 1, &bad, &model))
+		return;
+	text = malloc(strlen(model) + 64);
+	sprintf(text, "checker bug: line %d does not follow, false when %s",
+		bad + 1, model);
+	error(text);
+	free(text);
+	free(model);
+}
+
+static void run_line(struct proof *p, char *line);
+
+/* Runs the commands of a proof of goal as if they had been typed. */
+static void run_prove(struct proof *p, struct ast *cmd)
+{
+	struct prove_opts opts = popts;
+	struct cmdlist cl = { 0 };
+	char errbuf[256];
+	int errs = nerrors;
+
+	if (cmd->text && strstr(cmd->text, PORTFOLIO_STR))
+		opts.portfolio = 1;
+	if (cmd->text && strstr(cmd->text, MINIMAL_STR))
+		opts.minimal = 1;
+	if (cmd->text && strstr(cmd->text, INTUITIONISTIC_STR))
+		opts.intuitionistic = 1;
+	if (cmd->text && strstr(cmd->text, NO_PRUNE_STR))
+		opts.no_prune = 1;
+	if (cmd->text && strstr(cmd->text, RESOLUTION_STR))
+		opts.resolution = 1;
+	if (cmd->text && strstr(cmd->text, TABLEAU_STR))
+		opts.tableau = 1;
+	if (!prove(p, cmd->lhs, &opts, &cl, errbuf, sizeof(errbuf))) {
+		error(errbuf);
+		return;
+	}
+	for (int i = 0; i < cl.n && nerrors == errs; i++)
+		run_line(p, cl.cmds[i]);
+	cmdlist_free(&cl);
+}
+
+static void run_line(struct proof *p, char *line)
+{
+	char prompt[32];
+	char formbuf[512];
+	char cmdbuf[512];
+	char errbuf[1024];
+	struct ast *cmd;
+	FILE *outf;
+
+	snprintf(prompt, sizeof(prompt), "%4d. %.*s",
+		 p->nlns + 1, 2 * box_depth(p->boxhead), boxlines);
+
+	cmd = parse(line, strlen(line), errbuf, sizeof(errbuf));
+
+	if (skipping && (!cmd || cmd->type != CMD_NEW)) {
+		ast_destroy(cmd);
+		return;
+	}
+	if (!cmd) {
+		error(errbuf);
+		return;
+	}
+
+	switch (cmd->type) {
+	case CMD_OPEN:
+		memset(prompt, ' ', 5);
+		snprintf(prompt, sizeof(prompt), "      %.*s",
+			 2 * box_depth(p->boxhead), boxlines);
+		if (!push_box(p)) {
+			error(p->errbuf);
+			break;
+		}
+		println(prompt, "", "");
+		pushcmd(p, cmd);
+		break;
+	case CMD_CLOSE:
+		if (!pop_box(p))
+			error("no boxes to close");
+		else {
+			snprintf(prompt, sizeof(prompt), "      %.*s",
+				 2 * box_depth(p->boxhead), boxlines);
+			println(prompt, "", "");
+		}
+		pushcmd(p, cmd);
+		break;
+	case CMD_PRESUME:
+		if (!pushln(p, cmd, cmd->lhs)) {
+			error(p->errbuf);
+			break;
+		}
+		print_form(cmd->lhs, formbuf, sizeof(formbuf));
+		println(prompt, formbuf, "premise");
+		pushcmd(p, cmd);
+		break;
+	case CMD_ASSUME:
+		if (!at_beginning_of_box(p)) {
+			error("assumption must appear at beginning of box");
+			break;
+		}
+		if (!pushln(p, cmd, cmd->lhs)) {
+			error(p->errbuf);
+			break;
+		}
+		print_form(cmd->lhs, formbuf, sizeof(formbuf));
+		println(prompt, formbuf, "assumption");
+		pushcmd(p, cmd);
+		break;
+	case CMD_APPLY:
+		if (!apply_rule(p, cmd)) {
+			if (streaming)
+				snprintf(errbuf, sizeof(errbuf),
+					 "\"%s\", unable to apply rule: %s",
+					 line, p->errbuf);
+			else
+				snprintf(errbuf, sizeof(errbuf),
+					 "\x1b[33m\"%s\"\x1b[0m, unable to apply rule: %s",
+					 line, p->errbuf);
+			error(errbuf);
+			break;
+		}
+		print_apply(cmd, cmdbuf, sizeof(cmdbuf));
+		print_form(p->lns[p->nlns - 1].form, formbuf, sizeof(formbuf));
+		println(prompt, formbuf, cmdbuf);
+		pushcmd(p, cmd);
+		if (oracle)
+			run_oracle(p);
+		break;
+	case CMD_FIND:
+		find(p, cmd->lhs);
+		ast_destroy(cmd);
+		break;
+	case CMD_PROVE:
+		run_prove(p, cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_NEW:
+		if (streaming && !skipping)
+			printf("ok: the proof is correct.\n");
+		skipping = 0;
+		destroy_proof(p);
+		*p = new_proof();
+		ast_destroy(cmd);
+		if (!streaming)
+			msg("started a new proof");
+		break;
+	case CMD_VALID:
+		run_valid(cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_EQUIV:
+		run_equiv(cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_NNF:
+	case CMD_CNF:
+	case CMD_DNF:
+		run_normal(cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_SIMPLIFY:
+		run_simplify(cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_EXPORT_CNF:
+		run_export_cnf(p, cmd);
+		ast_destroy(cmd);
+		break;
+	case CMD_EXPORT:
+		outf = fopen(cmd->text, "w");
+		if (!outf)
+			error("unable to open file for writing");
+		else {
+			export_tex(outf, p);
+			fclose(outf);
+			snprintf(errbuf, sizeof(errbuf),
+				 "successfully exported to %s", cmd->text);
+			msg(errbuf);
+		}
+		break;
+	}
+}
+
+/* The value of a limit option, or -1 after reporting a bad one. */
+static long limit_arg(const char *name, const char *arg, long max)
+{
+	char *end;
+	long n;
+
+	errno = 0;
+	n = strtol(arg, &end, 10);
+	if (errno || end == arg || *end || n < 0 || n > max) {
+		fprintf(stderr, "invalid --%s: %s\n", name, arg);
+		return -1;
+	}
+	return n;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [--stream] [--rules=FILE] [--lemmas=FILE] [log-fifo]\n"
+		"       %s --check [OPTIONS] FILE...\n"
+		"       %s --daemon [OPTIONS]\n"
+		"       %s --solve [OPTIONS] SPEC...\n"
+		"       %s --valid [OPTIONS] SPEC...\n"
+		"       %s --export-cnf [--format=FORMAT] SPEC...\n"
+		"       %s --dedup [OPTIONS] SPEC...\n"
+		"       %s --sat [--format=FORMAT] CNF...\n",
+		prog, prog, prog, prog, prog, prog, prog, prog);
+}
+
 int main(int argc, char **argv)
 {
-	if (argc > 1) {
-		if (!ndelog_init(argv[1])) {
+	enum { OPT_CACHE = 256, OPT_CACHE_SIZE, OPT_SPEC, OPT_FORMAT,
+		OPT_MAX_LINES, OPT_MAX_DEPTH, OPT_MAX_FORM_SIZE, OPT_MAX_TIME,
+		OPT_MAX_MEM, OPT_RULES, OPT_LEMMAS, OPT_PROVE_DEPTH,
+		OPT_PROVE_STEPS, OPT_PROVE_TIME, OPT_PORTFOLIO, OPT_MINIMAL,
+		OPT_INTUITIONISTIC, OPT_NO_PRUNE, OPT_JOBS, OPT_SAT,
+		OPT_EXPORT_CNF, OPT_DEDUP, OPT_BDD_ORDER, OPT_ORACLE,
+		OPT_RESOLUTION, OPT_TABLEAU
+	};
+	static const struct option longopts[] = {
+		{ "stream", no_argument, NULL, 's' },
+		{ "check", no_argument, NULL, 'c' },
+		{ "daemon", no_argument, NULL, 'd' },
+		{ "solve", no_argument, NULL, 'S' },
+		{ "valid", no_argument, NULL, 'V' },
+		{ "sat", no_argument, NULL, OPT_SAT },
+		{ "export-cnf", no_argument, NULL, OPT_EXPORT_CNF },
+		{ "dedup", no_argument, NULL, OPT_DEDUP },
+		{ "bdd-order", required_argument, NULL, OPT_BDD_ORDER },
+		{ "oracle", no_argument, NULL, OPT_ORACLE },
+		{ "cache", required_argument, NULL, OPT_CACHE },
+		{ "cache-size", required_argument, NULL, OPT_CACHE_SIZE },
+		{ "spec", required_argument, NULL, OPT_SPEC },
+		{ "format", required_argument, NULL, OPT_FORMAT },
+		{ "max-lines", required_argument, NULL, OPT_MAX_LINES },
+		{ "max-depth", required_argument, NULL, OPT_MAX_DEPTH },
+		{ "max-form-size", required_argument, NULL, OPT_MAX_FORM_SIZE },
+		{ "max-time", required_argument, NULL, OPT_MAX_TIME },
+		{ "max-mem", required_argument, NULL, OPT_MAX_MEM },
+		{ "rules", required_argument, NULL, OPT_RULES },
+		{ "lemmas", required_argument, NULL, OPT_LEMMAS },
+		{ "prove-depth", required_argument, NULL, OPT_PROVE_DEPTH },
+		{ "prove-steps", required_argument, NULL, OPT_PROVE_STEPS },
+		{ "prove-time", required_argument, NULL, OPT_PROVE_TIME },
+		{ "portfolio", no_argument, NULL, OPT_PORTFOLIO },
+		{ "minimal", no_argument, NULL, OPT_MINIMAL },
+		{ "intuitionistic", no_argument, NULL, OPT_INTUITIONISTIC },
+		{ "no-prune", no_argument, NULL, OPT_NO_PRUNE },
+		{ "resolution", no_argument, NULL, OPT_RESOLUTION },
+		{ "tableau", no_argument, NULL, OPT_TABLEAU },
+		{ "jobs", required_argument, NULL, OPT_JOBS },
+		{ "help", no_argument, NULL, 'h' },
+		{ 0 },
+	};
+	struct batch_opts bopts = { FORMAT_TEXT, NULL, NULL, 65536,
+		{ 0, 0, PROOF_MAX_FORM_NODES, 0, 0, PROOF_MAX_MEM, 0 },
+		{ PROVE_MAX_DEPTH, PROVE_MAX_STEPS, 1, PROVE_MAX_TIME, 0, 0,
+		  0, 0, 0, 0 }, NULL };
+	int check = 0, daemon = 0, solve = 0, decide = 0, dimacs = 0;
+	int encode = 0, dedup = 0, opt, nlemmas = 0;
+	char **lemmas = malloc(argc * sizeof(*lemmas));
+	long n;
+	char errbuf[256];
+
+	apply_init();
+
+	while ((opt = getopt_long(argc, argv, "scdSVh", longopts, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			streaming = 1;
+			break;
+		case 'c':
+			check = 1;
+			break;
+		case 'd':
+			daemon = 1;
+			break;
+		case 'S':
+			solve = 1;
+			break;
+		case 'V':
+			decide = 1;
+			break;
+		case OPT_SAT:
+			dimacs = 1;
+			break;
+		case OPT_EXPORT_CNF:
+			encode = 1;
+			break;
+		case OPT_DEDUP:
+			dedup = 1;
+			break;
+		case OPT_BDD_ORDER:
+			bopts.bdd_order = optarg;
+			break;
+		case OPT_ORACLE:
+			bopts.lim.oracle = 1;
+			break;
+		case OPT_CACHE:
+			bopts.cache_path = optarg;
+			break;
+		case OPT_CACHE_SIZE:
+			bopts.cache_size = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_SPEC:
+			bopts.spec_path = optarg;
+			break;
+		case OPT_FORMAT:
+			if (strcmp(optarg, "text") == 0)
+				bopts.format = FORMAT_TEXT;
+			else if (strcmp(optarg, "json") == 0)
+				bopts.format = FORMAT_JSON;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case OPT_MAX_LINES:
+			if ((n = limit_arg("max-lines", optarg, INT_MAX)) < 0)
+				return 1;
+			bopts.lim.max_lines = n;
+			break;
+		case OPT_MAX_DEPTH:
+			if ((n = limit_arg("max-depth", optarg, INT_MAX)) < 0)
+				return 1;
+			bopts.lim.max_depth = n;
+			break;
+		case OPT_MAX_FORM_SIZE:
+			if ((n = limit_arg("max-form-size", optarg,
+					      INT_MAX)) < 0)
+				return 1;
+			bopts.lim.max_form_nodes = n;
+			break;
+		case OPT_MAX_TIME:
+			if ((n = limit_arg("max-time", optarg, LONG_MAX)) < 0)
+				return 1;
+			bopts.lim.max_time_ms = n;
+			break;
+		case OPT_MAX_MEM:
+			if ((n = limit_arg("max-mem", optarg, LONG_MAX)) < 0)
+				return 1;
+			bopts.lim.max_mem = n;
+			break;
+		case OPT_RULES:
+			if (!apply_load_rules(optarg, errbuf, sizeof(errbuf))) {
+				fprintf(stderr, "%s\n", errbuf);
+				return 1;
+			}
+			break;
+		case OPT_PROVE_DEPTH:
+			if ((n = limit_arg("prove-depth", optarg, INT_MAX)) < 0)
+				return 1;
+			bopts.prove.max_depth = n;
+			break;
+		case OPT_PROVE_STEPS:
+			if ((n = limit_arg("prove-steps", optarg, LONG_MAX)) < 0)
+				return 1;
+			bopts.prove.max_steps = n;
+			break;
+		case OPT_PROVE_TIME:
+			if ((n = limit_arg("prove-time", optarg, LONG_MAX)) < 0)
+				return 1;
+			bopts.prove.max_time_ms = n;
+			break;
+		case OPT_PORTFOLIO:
+			bopts.prove.portfolio = 1;
+			break;
+		case OPT_MINIMAL:
+			bopts.prove.minimal = 1;
+			break;
+		case OPT_INTUITIONISTIC:
+			bopts.prove.intuitionistic = 1;
+			break;
+		case OPT_NO_PRUNE:
+			bopts.prove.no_prune = 1;
+			break;
+		case OPT_RESOLUTION:
+			bopts.prove.resolution = 1;
+			break;
+		case OPT_TABLEAU:
+			bopts.prove.tableau = 1;
+			break;
+		case OPT_JOBS:
+			if ((n = limit_arg("jobs", optarg, INT_MAX)) < 0)
+				return 1;
+			if (n == 0) {
+				fprintf(stderr, "invalid --jobs: %s\n", optarg);
+				return 1;
+			}
+			bopts.prove.jobs = n;
+			break;
+		case OPT_LEMMAS:
+			lemmas[nlemmas++] = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/* proved within the limits, whatever order the options came in */
+	for (int i = 0; i < nlemmas; i++) {
+		if (!lemma_load(lemmas[i], &bopts.lim, errbuf,
+				sizeof(errbuf))) {
+			fprintf(stderr, "%s\n", errbuf);
+			return 1;
+		}
+	}
+	free(lemmas);
+
+	if (check)
+		return !batch_check(&bopts, argv + optind, argc - optind);
+	if (daemon)
+		return !batch_daemon(&bopts);
+	if (solve)
+		return !batch_solve(&bopts, argv + optind, argc - optind);
+	if (decide)
+		return !batch_valid(&bopts, argv + optind, argc - optind);
+	if (dimacs)
+		return !batch_sat(&bopts, argv + optind, argc - optind);
+	if (encode)
+		return !batch_export_cnf(&bopts, argv + optind, argc - optind);
+	if (dedup)
+		return !batch_dedup(&bopts, argv + optind, argc - optind);
+
+	popts = bopts.prove;
+	bdd_order = bopts.bdd_order;
+	oracle = bopts.lim.oracle;
+
+	if (optind < argc) {
+		if (!ndelog_init(argv[optind])) {
 			perror("log_init");
 			return 1;
 		}
@@ -71,23 +831,28 @@ int main(int argc, char **argv)
 
 	char prompt[32];
 	char *line;
-	char formbuf[512];
-	char cmdbuf[512];
-	char errbuf[1024];
-	struct ast *cmd;
 	struct proof p;
-	FILE *outf;
 
-	// disable echoing
-	(void)tcgetattr(STDIN_FILENO, &old);
-	memcpy(&new, &old, sizeof(struct termios));
-	new.c_lflag &= ~ECHO;
-	(void)tcsetattr(STDIN_FILENO, TCSANOW, &new);
-	atexit(term_restore);
+	if (!isatty(STDIN_FILENO))
+		streaming = 1;
+
+	if (streaming) {
+		setvbuf(stdin, NULL, _IOFBF, STREAM_BUFSZ);
+		setvbuf(stdout, NULL, _IOFBF, STREAM_BUFSZ);
+	} else {
+		// disable echoing
+		(void)tcgetattr(STDIN_FILENO, &old);
+		memcpy(&new, &old, sizeof(struct termios));
+		new.c_lflag &= ~ECHO;
+		(void)tcsetattr(STDIN_FILENO, TCSANOW, &new);
+		atexit(term_restore);
+	}
 
 	p = new_proof();
 
 	linenoiseHistorySetMaxLen(100);
+	editing = &p;
+	linenoiseSetCompletionCallback(complete);
 
 	ndelog("starting NDE\n");
 	for (;;) {
@@ -95,101 +860,30 @@ int main(int argc, char **argv)
 		snprintf(prompt, sizeof(prompt), "%4d. %.*s",
 			 p.nlns + 1, 2 * box_depth(p.boxhead), boxlines);
 
-		line = linenoise(prompt);
+		line = read_line(prompt);
 		if (!line)
 			break;
 
 		char first = first_non_wspc(line);
 		if (!first || first == '#') {
-			printf(CLEAR);
-			fflush(stdout);
-			linenoiseFree(line);
+			clear();
+			free_line(line);
 			continue;
 		}
 
-		linenoiseHistoryAdd(line);
+		if (!streaming)
+			linenoiseHistoryAdd(line);
 
-		printf(CLEAR);
-		fflush(stdout);
-
-		cmd = parse(line, strlen(line), errbuf, sizeof(errbuf));
-
-		if (!cmd) {
-			error(errbuf);
-			linenoiseFree(line);
-			continue;
-		}
-
-		switch (cmd->type) {
-		case CMD_OPEN:
-			memset(prompt, ' ', 5);
-			snprintf(prompt, sizeof(prompt), "      %.*s",
-				 2 * box_depth(p.boxhead), boxlines);
-			println(prompt, "", "");
-			push_box(&p);
-			pushcmd(&p, cmd);
-			break;
-		case CMD_CLOSE:
-			if (!pop_box(&p))
-				error("no boxes to close");
-			else {
-				snprintf(prompt, sizeof(prompt), "      %.*s",
-					 2 * box_depth(p.boxhead), boxlines);
-				println(prompt, "", "");
-			}
-			pushcmd(&p, cmd);
-			break;
-		case CMD_PRESUME:
-			pushln(&p, cmd, cmd->lhs);
-			print_form(cmd->lhs, formbuf, sizeof(formbuf));
-			println(prompt, formbuf, "premise");
-			pushcmd(&p, cmd);
-			break;
-		case CMD_ASSUME:
-			if (!at_beginning_of_box(&p)) {
-				error
-				    ("assumption must appear at beginning of box");
-				break;
-			}
-			pushln(&p, cmd, cmd->lhs);
-			print_form(cmd->lhs, formbuf, sizeof(formbuf));
-			println(prompt, formbuf, "assumption");
-			pushcmd(&p, cmd);
-			break;
-		case CMD_APPLY:
-			if (!apply_rule(&p, cmd)) {
-				snprintf(errbuf, sizeof(errbuf),
-					 "\x1b[33m\"%s\"\x1b[0m, unable to apply rule: %s",
-					 line, p.errbuf);
-				error(errbuf);
-				break;
-			}
-			print_apply(cmd, cmdbuf, sizeof(cmdbuf));
-			print_form(p.lns[p.nlns - 1].form, formbuf,
-				   sizeof(formbuf));
-			println(prompt, formbuf, cmdbuf);
-			pushcmd(&p, cmd);
-			break;
-		case CMD_EXPORT:
-			outf = fopen(cmd->text, "w");
-			if (!outf)
-				error("unable to open file for writing");
-			else {
-				export_tex(outf, &p);
-				fclose(outf);
-				snprintf(errbuf, sizeof(errbuf),
-					 "successfully exported to %s",
-					 cmd->text);
-				msg(errbuf);
-			}
-			break;
-		}
-		linenoiseFree(line);
+		clear();
+		run_line(&p, line);
+		free_line(line);
 	}
 
-	if (!isatty(STDIN_FILENO)) {
-		printf(CLEAR OK "the proof is correct.\n");
+	if (!streaming) {
+		printf(CLEAR);
+		return 0;
 	}
-
-	printf(CLEAR);
+	if (!skipping)
+		printf("ok: the proof is correct.\n");
+	return nerrors > 0;
 }
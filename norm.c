@@ -0,0 +1,467 @@
+#include "norm.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cnf.h"
+#include "parse.h"
+#include "term.h"
+
+/*
+ * Clauses, or the terms of a DNF, clause i being the literals from at[i]
+ * up to at[i + 1]. A literal is twice the id of an atom, plus one when
+ * the atom is negated, and the literals of a clause are sorted.
+ */
+struct cset {
+	int n;
+	int cap;
+	int *at;
+	uint64_t *sig;
+	int *lits;
+	int nlits;
+	int litcap;
+};
+
+/* Stands for a set over the limit, so it is not tried again. */
+static struct cset too_big;
+
+struct normalizer {
+	struct terms *t;
+	int max_lits;
+	struct term *bot;
+	struct term *top;
+	struct term **nnf;	/* by 2 id, plus one for the negation */
+	struct cset **cnf;	/* likewise */
+	struct term **atoms;	/* by id */
+	int nids;
+	int *tmp;
+};
+
+static struct cset *cs_new(void)
+{
+	struct cset *s = calloc(1, sizeof(*s));
+
+	s->cap = 8;
+	s->at = calloc(s->cap + 1, sizeof(*s->at));
+	s->sig = malloc(s->cap * sizeof(*s->sig));
+	return s;
+}
+
+static void cs_free(struct cset *s)
+{
+	if (!s || s == &too_big)
+		return;
+	free(s->at);
+	free(s->sig);
+	free(s->lits);
+	free(s);
+}
+
+static uint64_t signature(const int *lits, int n)
+{
+	uint64_t sig = 0;
+
+	for (int i = 0; i < n; i++)
+		sig |= 1ULL << (lits[i] % 64);
+	return sig;
+}
+
+static void cs_push(struct cset *s, const int *lits, int n)
+{
+	if (s->n == s->cap) {
+		s->cap *= 2;
+		s->at = realloc(s->at, (s->cap + 1) * sizeof(*s->at));
+		s->sig = realloc(s->sig, s->cap * sizeof(*s->sig));
+	}
+	if (s->nlits + n > s->litcap) {
+		s->litcap = 2 * (s->nlits + n);
+		s->lits = realloc(s->lits, s->litcap * sizeof(*s->lits));
+	}
+	if (n)
+		memcpy(s->lits + s->nlits, lits, n * sizeof(*lits));
+	s->sig[s->n] = signature(lits, n);
+	s->nlits += n;
+	s->at[++s->n] = s->nlits;
+}
+
+static int len(struct cset *s, int i)
+{
+	return s->at[i + 1] - s->at[i];
+}
+
+/* Whether clause i of a is contained in clause j of b. */
+static int subsumes(struct cset *a, int i, struct cset *b, int j)
+{
+	const int *x = a->lits + a->at[i], *y = b->lits + b->at[j];
+	int nx = len(a, i), ny = len(b, j), k = 0;
+
+	if (nx > ny || (a->sig[i] & ~b->sig[j]))
+		return 0;
+	for (int m = 0; m < nx; m++) {
+		while (k < ny && y[k] < x[m])
+			k++;
+		if (k == ny || y[k] != x[m])
+			return 0;
+	}
+	return 1;
+}
+
+/* Whether a clause among the first n of s subsumes clause i of b. */
+static int subsumed(struct cset *s, int n, struct cset *b, int i)
+{
+	for (int k = 0; k < n; k++) {
+		if (subsumes(s, k, b, i))
+			return 1;
+	}
+	return 0;
+}
+
+/* The union of clauses a and b into tmp, its length or -1 if a
+ * tautology. Complementary literals are adjacent once merged. */
+static int merge(struct normalizer *n, struct cset *a, int i,
+		 struct cset *b, int j)
+{
+	const int *x = a->lits + a->at[i], *y = b->lits + b->at[j];
+	int nx = len(a, i), ny = len(b, j), p = 0, q = 0, m = 0, l;
+
+	while (p < nx || q < ny) {
+		if (q == ny || (p < nx && x[p] <= y[q]))
+			l = x[p++];
+		else
+			l = y[q++];
+		if (m && n->tmp[m - 1] == (l ^ 1))
+			return -1;
+		if (!m || n->tmp[m - 1] != l)
+			n->tmp[m++] = l;
+	}
+	return m;
+}
+
+static struct cset *over(struct normalizer *n, struct cset *s)
+{
+	if (s->nlits <= n->max_lits)
+		return s;
+	cs_free(s);
+	return &too_big;
+}
+
+/* The clauses of both, less those subsumed by the other. */
+static struct cset *both(struct normalizer *n, struct cset *a,
+			 struct cset *b)
+{
+	struct cset *s = cs_new();
+	int kept;
+
+	for (int i = 0; i < a->n; i++) {
+		if (!subsumed(b, b->n, a, i))
+			cs_push(s, a->lits + a->at[i], len(a, i));
+	}
+	kept = s->n;
+	for (int j = 0; j < b->n; j++) {
+		if (!subsumed(s, kept, b, j))
+			cs_push(s, b->lits + b->at[j], len(b, j));
+	}
+	return over(n, s);
+}
+
+struct bylen {
+	int len;
+	int i;
+};
+
+static int cmp_len(const void *a, const void *b)
+{
+	const struct bylen *x = a, *y = b;
+
+	return x->len != y->len ? x->len - y->len : x->i - y->i;
+}
+
+/* The unions of a clause of each, shortest first, less those subsumed. */
+static struct cset *either(struct normalizer *n, struct cset *a,
+			   struct cset *b)
+{
+	struct cset *p, *s;
+	struct bylen *order;
+	int m;
+
+	/* every union but a tautology has a literal */
+	if ((long)a->n * b->n > n->max_lits)
+		return &too_big;
+	p = cs_new();
+	for (int i = 0; i < a->n; i++) {
+		for (int j = 0; j < b->n; j++) {
+			if ((m = merge(n, a, i, b, j)) >= 0)
+				cs_push(p, n->tmp, m);
+		}
+		if (p->nlits > n->max_lits)
+			return over(n, p);
+	}
+
+	order = malloc((p->n + 1) * sizeof(*order));
+	for (int i = 0; i < p->n; i++)
+		order[i] = (struct bylen){ len(p, i), i };
+	qsort(order, p->n, sizeof(*order), cmp_len);
+	s = cs_new();
+	for (int k = 0; k < p->n; k++) {
+		if (!subsumed(s, s->n, p, order[k].i))
+			cs_push(s, p->lits + p->at[order[k].i], order[k].len);
+	}
+	free(order);
+	cs_free(p);
+	return s;
+}
+
+/* The CNF of form, or of its negation unless pos. */
+static struct cset *clauses(struct normalizer *n, struct term *form, int pos)
+{
+	struct cset **m = &n->cnf[2 * form->id + !pos], *a, *b;
+	int lit;
+
+	if (*m)
+		return *m;
+	switch (form->type) {
+	case FORM_NOT:
+		return clauses(n, form->lhs, !pos);
+	case FORM_NAME:
+		n->atoms[form->id] = form;
+		lit = 2 * form->id + !pos;
+		*m = cs_new();
+		cs_push(*m, &lit, 1);
+		return *m;
+	case FORM_CON:
+		/* the empty clause, or none */
+		*m = cs_new();
+		if (pos)
+			cs_push(*m, n->tmp, 0);
+		return *m;
+	}
+
+	a = clauses(n, form->lhs, form->type == FORM_IMPL ? !pos : pos);
+	if (a == &too_big)
+		return *m = &too_big;
+	b = clauses(n, form->rhs, pos);
+	if (b == &too_big)
+		return *m = &too_big;
+	/* A ^ B, -(A / B) and -(A -> B) join the clauses of each side */
+	if ((form->type == FORM_AND) == pos)
+		return *m = both(n, a, b);
+	return *m = either(n, a, b);
+}
+
+/*
+ * The clauses as a formula, a conjunction of disjunctions or, for the
+ * dual, a disjunction of conjunctions of the negated literals.
+ */
+static struct term *to_term(struct normalizer *n, struct cset *s, int dual)
+{
+	int inner = dual ? FORM_AND : FORM_OR;
+	int outer = dual ? FORM_OR : FORM_AND;
+	struct term *f = NULL, *c, *l;
+
+	for (int i = s->n - 1; i >= 0; i--) {
+		c = NULL;
+		for (int k = s->at[i + 1] - 1; k >= s->at[i]; k--) {
+			l = n->atoms[s->lits[k] / 2];
+			if ((s->lits[k] & 1) != dual)
+				l = term_make(n->t, FORM_NOT, l, NULL);
+			c = c ? term_make(n->t, inner, l, c) : l;
+		}
+		if (!c)
+			c = dual ? n->top : n->bot;
+		f = f ? term_make(n->t, outer, c, f) : c;
+	}
+	if (!f)
+		f = dual ? n->bot : n->top;
+	return f;
+}
+
+/* a ^ b or a / b, dropping constants and a repeated operand. */
+static struct term *join(struct normalizer *n, int type, struct term *a,
+			 struct term *b)
+{
+	struct term *unit = type == FORM_AND ? n->top : n->bot;
+	struct term *zero = type == FORM_AND ? n->bot : n->top;
+
+	if (a == zero || b == zero)
+		return zero;
+	if (a == unit || a == b)
+		return b;
+	if (b == unit)
+		return a;
+	return term_make(n->t, type, a, b);
+}
+
+static struct term *nnf(struct normalizer *n, struct term *form, int pos)
+{
+	struct term **m = &n->nnf[2 * form->id + !pos], *a, *b;
+
+	if (*m)
+		return *m;
+	switch (form->type) {
+	case FORM_NOT:
+		return nnf(n, form->lhs, !pos);
+	case FORM_NAME:
+	case FORM_CON:
+		return *m = pos ? form : term_make(n->t, FORM_NOT, form, NULL);
+	}
+	a = nnf(n, form->lhs, form->type == FORM_IMPL ? !pos : pos);
+	b = nnf(n, form->rhs, pos);
+	return *m = join(n, (form->type == FORM_AND) == pos ? FORM_AND
+			 : FORM_OR, a, b);
+}
+
+/* Makes room for the terms there are, those converted being among them. */
+static void grow(struct normalizer *n)
+{
+	int ids = terms_count(n->t);
+
+	if (ids <= n->nids)
+		return;
+	n->nnf = realloc(n->nnf, 2 * ids * sizeof(*n->nnf));
+	n->cnf = realloc(n->cnf, 2 * ids * sizeof(*n->cnf));
+	n->atoms = realloc(n->atoms, ids * sizeof(*n->atoms));
+	memset(n->nnf + 2 * n->nids, 0, 2 * (ids - n->nids) * sizeof(*n->nnf));
+	memset(n->cnf + 2 * n->nids, 0, 2 * (ids - n->nids) * sizeof(*n->cnf));
+	n->nids = ids;
+}
+
+struct normalizer *norm_new(struct terms *t, int max_lits)
+{
+	struct normalizer *n = calloc(1, sizeof(*n));
+
+	n->t = t;
+	n->max_lits = max_lits;
+	n->bot = term_make(t, FORM_CON, NULL, NULL);
+	n->top = term_make(t, FORM_NOT, n->bot, NULL);
+	/* a union of two clauses within the limit */
+	n->tmp = malloc((2 * max_lits + 1) * sizeof(*n->tmp));
+	return n;
+}
+
+void norm_destroy(struct normalizer *n)
+{
+	if (!n)
+		return;
+	for (int i = 0; i < 2 * n->nids; i++)
+		cs_free(n->cnf[i]);
+	free(n->nnf);
+	free(n->cnf);
+	free(n->atoms);
+	free(n->tmp);
+	free(n);
+}
+
+struct term *norm_nnf(struct normalizer *n, struct term *form)
+{
+	grow(n);
+	return nnf(n, form, 1);
+}
+
+struct term *norm_cnf(struct normalizer *n, struct term *form)
+{
+	struct cset *s;
+
+	grow(n);
+	s = clauses(n, form, 1);
+	return s == &too_big ? NULL : to_term(n, s, 0);
+}
+
+/* The DNF of form, the dual of the CNF of its negation. */
+struct term *norm_dnf(struct normalizer *n, struct term *form)
+{
+	struct cset *s;
+
+	grow(n);
+	s = clauses(n, form, 0);
+	return s == &too_big ? NULL : to_term(n, s, 1);
+}
+
+/* A prefix no atom of the encoding starts with. */
+static char *fresh_prefix(struct cnf *c)
+{
+	char *prefix = strdup("t");
+	size_t len = 1;
+
+	for (int i = 0; i < c->natoms; i++) {
+		if (strncmp(c->atoms[i], prefix, len) == 0) {
+			prefix = realloc(prefix, ++len + 1);
+			strcat(prefix, "t");
+			i = -1;
+		}
+	}
+	return prefix;
+}
+
+/* Atom names hold letters only, so k is written in base 26 by them. */
+static struct term *fresh_atom(struct terms *t, const char *prefix, int k)
+{
+	char buf[16], *name;
+	int i = sizeof(buf) - 1;
+	struct term *atom;
+
+	buf[i] = '\0';
+	for (k++; k; k /= 26)
+		buf[--i] = 'a' + --k % 26;
+	name = malloc(strlen(prefix) + sizeof(buf) - i);
+	strcpy(name, prefix);
+	strcat(name, buf + i);
+	atom = term_atom(t, name);
+	free(name);
+	return atom;
+}
+
+/*
+ * An equisatisfiable CNF by the Tseitin encoding of cnf.c, linear in the
+ * size of form: each compound subformula is named by a fresh atom, the
+ * prefix followed by letters, and defined by clauses. The constant false
+ * of the encoding is dropped from clauses, its negation making them true.
+ */
+struct term *norm_tseitin(struct normalizer *n, struct term *form,
+			  char **prefix, int *nfresh)
+{
+	struct ast *a = term_to_ast(form);
+	struct cnf *c = cnf_new();
+	struct term **vars, **cls, *f, *l;
+	int lit, ncls = 0, sat;
+
+	lit = cnf_lit(c, a);
+	cnf_clause(c, &lit, 1);
+	*prefix = fresh_prefix(c);
+	*nfresh = 0;
+	vars = calloc(c->nvars + 1, sizeof(*vars));
+	for (int i = 0; i < c->natoms; i++)
+		vars[c->atom_vars[i]] = term_atom(n->t, c->atoms[i]);
+	for (int v = 1; v <= c->nvars; v++) {
+		if (!vars[v] && v != c->false_var)
+			vars[v] = fresh_atom(n->t, *prefix, (*nfresh)++);
+	}
+
+	cls = malloc(c->nclauses * sizeof(*cls));
+	for (int i = 0, j = 0; i < c->nlits; i = ++j) {
+		while (c->lits[j])
+			j++;
+		f = NULL;
+		sat = 0;
+		for (int k = j - 1; k >= i; k--) {
+			lit = c->lits[k];
+			if (abs(lit) == c->false_var) {
+				sat |= lit < 0;
+				continue;
+			}
+			l = vars[abs(lit)];
+			if (lit < 0)
+				l = term_make(n->t, FORM_NOT, l, NULL);
+			f = f ? term_make(n->t, FORM_OR, l, f) : l;
+		}
+		if (!sat)
+			cls[ncls++] = f ? f : n->bot;
+	}
+	f = ncls ? cls[ncls - 1] : n->top;
+	for (int i = ncls - 2; i >= 0; i--)
+		f = term_make(n->t, FORM_AND, cls[i], f);
+
+	free(cls);
+	free(vars);
+	cnf_destroy(c);
+	ast_destroy(a);
+	return f;
+}
@@ -0,0 +1,27 @@
+#ifndef NORM_H
+#define NORM_H
+
+struct term;
+struct terms;
+
+#define NORM_MAX_LITS (1 << 14)
+
+/*
+ * Normal forms of hash-consed terms. Each subterm is converted once per
+ * polarity and the result kept by term id, so a subformula shared by
+ * several others costs nothing past its first occurrence. Clause sets
+ * are kept free of tautologies and subsumed clauses as they are built;
+ * the CNF and DNF give up, returning NULL, once one of them would have
+ * more than max_lits literals.
+ */
+struct normalizer;
+
+struct normalizer *norm_new(struct terms *t, int max_lits);
+void norm_destroy(struct normalizer *n);
+struct term *norm_nnf(struct normalizer *n, struct term *form);
+struct term *norm_cnf(struct normalizer *n, struct term *form);
+struct term *norm_dnf(struct normalizer *n, struct term *form);
+struct term *norm_tseitin(struct normalizer *n, struct term *form,
+			  char **prefix, int *nfresh);
+
+#endif
@@ -0,0 +1,128 @@
+#include "oracle.h"
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "proof.h"
+#include "prog.h"
+#include "valid.h"
+
+static int is_context(struct ln *l)
+{
+	return l->cmd->type == CMD_PRESUME || l->cmd->type == CMD_ASSUME;
+}
+
+/* Past the atoms truth tables handle, each line on its own. */
+static int check_lines(struct proof *p, int first, int *bad, char **model)
+{
+	struct ast **ctx = malloc((p->nlns + 1) * sizeof(*ctx));
+	char errbuf[128];
+	int n, res = 1;
+
+	for (int i = first; i < p->nlns && res; i++) {
+		if (is_context(&p->lns[i]))
+			continue;
+		n = proof_context(p, i, ctx);
+		/* lines the solver gives up on pass */
+		if (!valid(ctx, n, p->lns[i].form, model, errbuf,
+			   sizeof(errbuf))) {
+			*bad = i;
+			res = 0;
+		}
+	}
+	free(ctx);
+	return res;
+}
+
+static int encloses(struct box *outer, struct box *b)
+{
+	for (; b; b = b->parent) {
+		if (b == outer)
+			return 1;
+	}
+	return !outer;
+}
+
+/* Enters the boxes around b from the innermost entered, each starting
+ * with the valuations of the one it is in. */
+static int enter(struct box **boxes, block *masks, int depth, struct box *b)
+{
+	if (b == boxes[depth])
+		return depth;
+	depth = enter(boxes, masks, depth, b->parent);
+	memcpy(masks[depth + 1], masks[depth], sizeof(block));
+	boxes[++depth] = b;
+	return depth;
+}
+
+/*
+ * The lines are compiled together and run a block of valuations at a
+ * time. masks[d] holds the valuations making the context of the box at
+ * depth d true, shared by the lines of the box.
+ */
+int oracle_check(struct proof *p, int first, int *bad, char **model)
+{
+	struct ast **forms;
+	struct box **boxes;
+	struct prog *prog;
+	block *regs, *masks;
+	lane m[PROG_LANES], *val;
+	char vals[VALID_TABLE_ATOMS];
+	int maxdepth = 0, depth, res = 1, v;
+
+	*model = NULL;
+	if (first >= p->nlns)
+		return 1;
+	forms = malloc(p->nlns * sizeof(*forms));
+	for (int i = 0; i < p->nlns; i++) {
+		forms[i] = p->lns[i].form;
+		if (box_depth(p->lns[i].box) > maxdepth)
+			maxdepth = box_depth(p->lns[i].box);
+	}
+	prog = prog_compile(forms, p->nlns);
+	free(forms);
+	if (prog->natoms > VALID_TABLE_ATOMS) {
+		prog_destroy(prog);
+		return check_lines(p, first, bad, model);
+	}
+
+	regs = prog_regs(prog);
+	masks = aligned_alloc(sizeof(lane), (maxdepth + 1) * sizeof(block));
+	boxes = malloc((maxdepth + 1) * sizeof(*boxes));
+	for (uint64_t blk = 0; blk < prog_blocks(prog) && res; blk++) {
+		prog_set_atoms(prog, regs, blk);
+		memset(masks[0], 0xff, sizeof(block));
+		boxes[0] = NULL;
+		depth = 0;
+
+		for (int i = 0; i < p->nlns && res; i++) {
+			prog_run(prog, i ? prog->ends[i - 1] : 0,
+				 prog->ends[i], regs);
+			val = regs[prog->outs[i]];
+			while (!encloses(boxes[depth], p->lns[i].box))
+				depth--;
+			depth = enter(boxes, masks, depth, p->lns[i].box);
+
+			if (is_context(&p->lns[i])) {
+				for (int k = 0; k < PROG_LANES; k++)
+					masks[depth][k] &= val[k];
+				continue;
+			}
+			if (i < first)
+				continue;
+			for (int k = 0; k < PROG_LANES; k++)
+				m[k] = masks[depth][k] & ~val[k];
+			if ((v = prog_first(m)) < 0)
+				continue;
+			prog_valuation(prog, blk, v, vals);
+			*model = valid_describe(prog->atoms, vals, prog->natoms);
+			*bad = i;
+			res = 0;
+		}
+	}
+
+	free(boxes);
+	free(masks);
+	free(regs);
+	prog_destroy(prog);
+	return res;
+}
@@ -0,0 +1,14 @@
+#ifndef ORACLE_H
+#define ORACLE_H
+
+struct proof;
+
+/*
+ * Checks the rules by their semantics: whether each line from first on
+ * follows from the premises and assumptions in scope of it. Returns 1 if
+ * all do, or 0 with the first line that does not in *bad and a valuation
+ * making its context true and it false in *model, to be freed.
+ */
+int oracle_check(struct proof *p, int first, int *bad, char **model);
+
+#endif
@@ -29,6 +29,11 @@ struct pdata {
 	size_t errbufsz;
 	char word[MAX_WORD];
 	int peek;
+	int depth;
+	int ntoks;
+	int metavars;
+	struct parse_limits *lim;
+	struct parse_limits deflim;
 };
 
 static char currc(struct pdata *p)
@@ -51,6 +56,20 @@ static void skip_wspc(struct pdata *p)
 	}
 }
 
+/* Skips opt if it comes next, followed by whitespace. */
+static int skip_option(struct pdata *p, const char *opt)
+{
+	size_t len = strlen(opt);
+
+	if (p->length - p->cursor <= len
+	    || strncmp(&p->text[p->cursor], opt, len) != 0
+	    || !wspc(p->text[p->cursor + len]))
+		return 0;
+	p->cursor += len;
+	skip_wspc(p);
+	return 1;
+}
+
 static const char *getword(struct pdata *p)
 {
 	char c;
@@ -71,6 +90,14 @@ static const char *getword(struct pdata *p)
 	return p->word;
 }
 
+static int at_turnstile(struct pdata *p)
+{
+	size_t len = strlen(TURNSTILE_STR);
+
+	return p->length - p->cursor >= len
+	    && strncmp(&p->text[p->cursor], TURNSTILE_STR, len) == 0;
+}
+
 static int getnum(struct pdata *p)
 {
 	char c;
@@ -102,9 +129,16 @@ static int gettok(struct pdata *p)
 	}
 
 	skip_wspc(p);
-	if (!currc(p) || currc(p) == ',')
+	if (!currc(p) || currc(p) == ',' || at_turnstile(p))
 		return TK_EOF;
 
+	if (++p->ntoks > p->lim->max_nodes) {
+		p->lim->exceeded = 1;
+		snprintf(p->errbuf, p->errbufsz,
+			 "limit exceeded: formula too large");
+		return TK_ERR;
+	}
+
 	if (currc(p) == '(') {
 		p->cursor++;
 		return TK_LPAR;
@@ -115,8 +149,14 @@ static int gettok(struct pdata *p)
 		return TK_RPAR;
 	}
 
-	if (isalpha(currc(p))) {
+	if (isalpha(currc(p)) || (p->metavars && currc(p) == '?')) {
 		size_t wc = 0;
+		if (currc(p) == '?') {
+			p->word[wc++] = '?';
+			p->cursor++;
+			if (!isalpha(currc(p)))
+				return TK_ERR;
+		}
 		while (currc(p) && isalpha(currc(p))) {
 			if (wc == MAX_WORD) {
 				snprintf(p->errbuf, p->errbufsz,
@@ -158,19 +198,65 @@ static int peektok(struct pdata *p)
 	return p->peek;
 }
 
+static void synerr(struct pdata *p)
+{
+	if (!p->lim->exceeded)
+		snprintf(p->errbuf, p->errbufsz, "syntax error in formula");
+}
+
 static struct ast *p_cmd(struct pdata *p);
 static struct ast *p_rule(struct pdata *p);
 static struct ast *p_input(struct pdata *p);
+static int p_sequent(struct pdata *p, struct ast **prems, struct ast **goal);
+static int p_pair(struct pdata *p, struct ast **a, struct ast **b);
 static struct ast *p_form(struct pdata *p);
 static struct ast *p_impl(struct pdata *p);
 static struct ast *p_andor(struct pdata *p);
 static struct ast *p_unit(struct pdata *p);
 
+/* Recursive descent with a bound on the recursion depth. */
+static struct ast *nested(struct pdata *p, struct ast *(*fn)(struct pdata *))
+{
+	struct ast *res;
+
+	if (p->depth == p->lim->max_depth) {
+		p->lim->exceeded = 1;
+		snprintf(p->errbuf, p->errbufsz,
+			 "limit exceeded: formula nested too deeply");
+		return NULL;
+	}
+
+	p->depth++;
+	res = fn(p);
+	p->depth--;
+	return res;
+}
+
+static void init_limits(struct pdata *p, struct parse_limits *lim)
+{
+	/* per parse, commands may be parsed by several threads */
+	if (!lim) {
+		p->deflim.max_nodes = PARSE_MAX_NODES;
+		p->deflim.max_depth = PARSE_MAX_DEPTH;
+		lim = &p->deflim;
+	}
+	lim->exceeded = 0;
+	p->lim = lim;
+}
+
 struct ast *parse(const char *text, size_t length, char *errbuf,
 		  size_t errbufsz)
+{
+	return parse_limited(text, length, NULL, errbuf, errbufsz);
+}
+
+struct ast *parse_limited(const char *text, size_t length,
+			  struct parse_limits *lim, char *errbuf,
+			  size_t errbufsz)
 {
 	struct ast *root;
 	struct pdata p = { 0 };
+	init_limits(&p, lim);
 	p.text = text;
 	p.length = length;
 	p.errbuf = errbuf;
@@ -190,11 +276,52 @@ struct ast *parse(const char *text, size_t length, char *errbuf,
 	return root;
 }
 
+static struct ast *parse_form_with(const char *text, size_t length,
+				   int metavars, char *errbuf,
+				   size_t errbufsz)
+{
+	struct ast *root;
+	struct pdata p = { 0 };
+	init_limits(&p, NULL);
+	p.metavars = metavars;
+	p.text = text;
+	p.length = length;
+	p.errbuf = errbuf;
+	p.errbufsz = errbufsz;
+
+	root = p_form(&p);
+	if (!root)
+		return NULL;
+
+	skip_wspc(&p);
+	if ((p.peek && p.peek != TK_EOF) || currc(&p)) {
+		ast_destroy(root);
+		root = NULL;
+		snprintf(errbuf, errbufsz, "trailing tokens");
+	}
+
+	return root;
+}
+
+struct ast *parse_form(const char *text, size_t length, char *errbuf,
+		       size_t errbufsz)
+{
+	return parse_form_with(text, length, 0, errbuf, errbufsz);
+}
+
+/* Parses a formula in which names may be "?A" metavariables. */
+struct ast *parse_pattern(const char *text, size_t length, char *errbuf,
+			  size_t errbufsz)
+{
+	return parse_form_with(text, length, 1, errbuf, errbufsz);
+}
+
 static struct ast *p_cmd(struct pdata *p)
 {
 	struct ast *cmd = NULL, *lhs = NULL, *rhs = NULL;
 	char *text = NULL;
 	int type = -1;
+	size_t start;
 
 	const char *word = getword(p);
 	if (!word)
@@ -226,6 +353,11 @@ static struct ast *p_cmd(struct pdata *p)
 		goto done;
 	}
 
+	if (strcmp(word, "new") == 0) {
+		type = CMD_NEW;
+		goto done;
+	}
+
 	if (strcmp(word, "export") == 0) {
 		type = CMD_EXPORT;
 		text = (char *)getword(p);
@@ -235,134 +367,148 @@ static struct ast *p_cmd(struct pdata *p)
 		goto done;
 	}
 
-	if (strcmp(word, "apply") == 0) {
-		type = CMD_APPLY;
-		lhs = p_rule(p);
-		if (!lhs)
+	/* the line defaults to the last */
+	if (strcmp(word, "export-cnf") == 0) {
+		type = CMD_EXPORT_CNF;
+		text = (char *)getword(p);
+		if (!text) {
+			snprintf(p->errbuf, p->errbufsz, "missing file name");
 			return NULL;
-
+		}
+		text = strdup(text);
 		skip_wspc(p);
 		if (!currc(p))
 			goto done;
-
-		rhs = p_input(p);
-		if (!rhs) {
-			ast_destroy(lhs);
+		if (!isdigit(currc(p))) {
+			snprintf(p->errbuf, p->errbufsz, "expected a line number");
+			free(text);
 			return NULL;
 		}
+		rhs = calloc(1, sizeof(*rhs));
+		rhs->type = INPUT_LINE;
+		rhs->start = getnum(p) - 1;
 		goto done;
 	}
 
-	snprintf(p->errbuf, p->errbufsz, "unknown command %s", word);
-	return NULL;
-
- done:
-	cmd = calloc(1, sizeof(*cmd));
-	cmd->type = type;
-	cmd->text = text;
-	cmd->lhs = lhs;
-	cmd->rhs = rhs;
-	return cmd;
-}
-
-static struct ast *p_rule(struct pdata *p)
-{
-	struct ast *rule = NULL;
-	int type = -1;
-	const char *word;
-
-	word = getword(p);
-	if (strcmp(word, NOT_INTR_STR) == 0) {
-		type = RULE_NOT_INTR;
-		goto done;
-	}
-
-	if (strcmp(word, NOT_ELIM_STR) == 0) {
-		type = RULE_NOT_ELIM;
-		goto done;
-	}
-
-	if (strcmp(word, AND_INTR_STR) == 0) {
-		type = RULE_AND_INTR;
-		goto done;
-	}
-
-	if (strcmp(word, AND_ELIM_1_STR) == 0) {
-		type = RULE_AND_ELIM_1;
+	if (strcmp(word, "prove") == 0) {
+		type = CMD_PROVE;
+		skip_wspc(p);
+		start = p->cursor;
+		while (skip_option(p, PORTFOLIO_STR)
+		       || skip_option(p, MINIMAL_STR)
+		       || skip_option(p, INTUITIONISTIC_STR)
+		       || skip_option(p, NO_PRUNE_STR)
+		       || skip_option(p, RESOLUTION_STR)
+		       || skip_option(p, TABLEAU_STR))
+			;
+		/* the options as given */
+		if (p->cursor > start)
+			text = strndup(&p->text[start], p->cursor - start);
+		lhs = p_form(p);
+		if (!lhs)
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, AND_ELIM_2_STR) == 0) {
-		type = RULE_AND_ELIM_2;
+	if (strcmp(word, "valid") == 0) {
+		type = CMD_VALID;
+		if (!p_sequent(p, &lhs, &rhs))
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, OR_INTR_1_STR) == 0) {
-		type = RULE_OR_INTR_1;
+	if (strcmp(word, "equiv") == 0) {
+		type = CMD_EQUIV;
+		if (!p_pair(p, &lhs, &rhs))
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, OR_INTR_2_STR) == 0) {
-		type = RULE_OR_INTR_2;
+	if (strcmp(word, "nnf") == 0 || strcmp(word, "cnf") == 0
+	    || strcmp(word, "dnf") == 0) {
+		type = *word == 'n' ? CMD_NNF : *word == 'c' ? CMD_CNF
+		    : CMD_DNF;
+		lhs = p_form(p);
+		if (!lhs)
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, OR_ELIM_STR) == 0) {
-		type = RULE_OR_ELIM;
+	if (strcmp(word, "simplify") == 0) {
+		type = CMD_SIMPLIFY;
+		lhs = p_form(p);
+		if (!lhs)
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, IMPL_INTR_STR) == 0) {
-		type = RULE_IMPL_INTR;
+	if (strcmp(word, "find") == 0) {
+		type = CMD_FIND;
+		p->metavars = 1;
+		lhs = p_form(p);
+		if (!lhs)
+			return NULL;
 		goto done;
 	}
 
-	if (strcmp(word, IMPL_ELIM_STR) == 0) {
-		type = RULE_IMPL_ELIM;
-		goto done;
-	}
+	if (strcmp(word, "apply") == 0) {
+		type = CMD_APPLY;
+		lhs = p_rule(p);
+		if (!lhs)
+			return NULL;
 
-	if (strcmp(word, CON_ELIM_STR) == 0) {
-		type = RULE_CON_ELIM;
-		goto done;
-	}
+		skip_wspc(p);
+		if (!currc(p))
+			goto done;
 
-	if (strcmp(word, NOT_NOT_INTR_STR) == 0) {
-		type = RULE_NOT_NOT_INTR;
-		goto done;
-	}
+		/* inputs to be inferred, the rule node holds the goal */
+		if (p->length - p->cursor >= strlen(GOAL_STR)
+		    && strncmp(&p->text[p->cursor], GOAL_STR,
+			       strlen(GOAL_STR)) == 0) {
+			p->cursor += strlen(GOAL_STR);
+			lhs->lhs = p_form(p);
+			if (!lhs->lhs) {
+				ast_destroy(lhs);
+				return NULL;
+			}
+			goto done;
+		}
 
-	if (strcmp(word, NOT_NOT_ELIM_STR) == 0) {
-		type = RULE_NOT_NOT_ELIM;
+		rhs = p_input(p);
+		if (!rhs) {
+			ast_destroy(lhs);
+			return NULL;
+		}
 		goto done;
 	}
 
-	if (strcmp(word, MT_STR) == 0) {
-		type = RULE_MT;
-		goto done;
-	}
+	snprintf(p->errbuf, p->errbufsz, "unknown command %s", word);
+	return NULL;
 
-	if (strcmp(word, PBC_STR) == 0) {
-		type = RULE_PBC;
-		goto done;
-	}
+ done:
+	cmd = calloc(1, sizeof(*cmd));
+	cmd->type = type;
+	cmd->text = text;
+	cmd->lhs = lhs;
+	cmd->rhs = rhs;
+	return cmd;
+}
 
-	if (strcmp(word, LEM_STR) == 0) {
-		type = RULE_LEM;
-		goto done;
-	}
+static struct ast *p_rule(struct pdata *p)
+{
+	struct ast *rule = NULL;
+	const char *word;
 
-	if (strcmp(word, COPY_STR) == 0) {
-		type = RULE_COPY;
-		goto done;
+	word = getword(p);
+	if (!word) {
+		snprintf(p->errbuf, p->errbufsz, "missing rule");
+		return NULL;
 	}
 
-	snprintf(p->errbuf, p->errbufsz, "unknown rule %s", word);
-	return NULL;
-
- done:
 	rule = calloc(1, sizeof(*rule));
-	rule->type = type;
+	rule->type = rule_type(word);
+	if (rule->type == RULE_NAMED)
+		rule->text = strdup(word);
 	return rule;
 }
 
@@ -402,9 +548,11 @@ static struct ast *p_input(struct pdata *p)
 	skip_wspc(p);
 	if (currc(p) == ',') {
 		p->cursor++;
-		rhs = p_input(p);
-		if (!rhs)
+		rhs = nested(p, p_input);
+		if (!rhs) {
+			ast_destroy(lhs);
 			return NULL;
+		}
 	}
 
 	inp = calloc(1, sizeof(*inp));
@@ -416,6 +564,79 @@ static struct ast *p_input(struct pdata *p)
 	return inp;
 }
 
+/*
+ * "A, B |- C", "|- C" or just "C". The premises are a chain of formula
+ * inputs, as in apply.
+ */
+static int p_sequent(struct pdata *p, struct ast **prems, struct ast **goal)
+{
+	struct ast **tail = prems, *form;
+
+	*prems = NULL;
+	for (;;) {
+		skip_wspc(p);
+		if (at_turnstile(p)) {
+			p->cursor += strlen(TURNSTILE_STR);
+			if ((*goal = p_form(p)))
+				return 1;
+			break;
+		}
+		if (!(form = p_form(p)))
+			break;
+		/* a formula ends before a comma or turnstile, unread */
+		if (p->peek != TK_EOF) {
+			ast_destroy(form);
+			synerr(p);
+			break;
+		}
+		p->peek = 0;
+		skip_wspc(p);
+		if (!*prems && !currc(p)) {
+			*goal = form;
+			return 1;
+		}
+		*tail = calloc(1, sizeof(**tail));
+		(*tail)->type = INPUT_FORM;
+		(*tail)->lhs = form;
+		tail = &(*tail)->rhs;
+		if (currc(p) == ',') {
+			p->cursor++;
+		} else if (!at_turnstile(p)) {
+			snprintf(p->errbuf, p->errbufsz,
+				 "expected , or " TURNSTILE_STR);
+			break;
+		}
+	}
+	ast_destroy(*prems);
+	*prems = NULL;
+	return 0;
+}
+
+/* Two formulas separated by a comma. */
+static int p_pair(struct pdata *p, struct ast **a, struct ast **b)
+{
+	if (!(*a = p_form(p)))
+		return 0;
+	/* the first ends before the comma, unread */
+	if (p->peek != TK_EOF) {
+		synerr(p);
+		goto fail;
+	}
+	p->peek = 0;
+	skip_wspc(p);
+	if (currc(p) != ',') {
+		snprintf(p->errbuf, p->errbufsz, "expected ,");
+		goto fail;
+	}
+	p->cursor++;
+	if ((*b = p_form(p)))
+		return 1;
+ fail:
+	ast_destroy(*a);
+	*a = NULL;
+	return 0;
+}
+
 static struct ast *p_form(struct pdata *p)
 {
 	return p_impl(p);
@@ -433,7 +654,7 @@ static struct ast *p_impl(struct pdata *p)
 	tok = peektok(p);
 
 	if (tok == TK_ERR) {
-		snprintf(p->errbuf, p->errbufsz, "syntax error in formula");
+		synerr(p);
 		ast_destroy(lhs);
 		return NULL;
 	}
@@ -443,7 +664,7 @@ static struct ast *p_impl(struct pdata *p)
 
 	if (tok == TK_IMPL) {
 		(void)gettok(p);
-		rhs = p_impl(p);
+		rhs = nested(p, p_impl);
 		if (!rhs) {
 			ast_destroy(lhs);
 			return NULL;
@@ -470,7 +691,7 @@ static struct ast *p_andor(struct pdata *p)
 	tok = peektok(p);
 
 	if (tok == TK_ERR) {
-		snprintf(p->errbuf, p->errbufsz, "syntax error in formula");
+		synerr(p);
 		ast_destroy(lhs);
 		return NULL;
 	}
@@ -480,7 +701,7 @@ static struct ast *p_andor(struct pdata *p)
 
 	if (tok == TK_AND || tok == TK_OR) {
 		(void)gettok(p);
-		rhs = p_andor(p);
+		rhs = nested(p, p_andor);
 		if (!rhs) {
 			ast_destroy(lhs);
 			return NULL;
@@ -503,7 +724,7 @@ static struct ast *p_unit(struct pdata *p)
 	tok = peektok(p);
 
 	if (tok == TK_ERR || tok == TK_EOF) {
-		snprintf(p->errbuf, p->errbufsz, "syntax error in formula");
+		synerr(p);
 		return NULL;
 	}
 
@@ -524,13 +745,12 @@ static struct ast *p_unit(struct pdata *p)
 
 	if (tok == TK_LPAR) {
 		(void)gettok(p);
-		child = p_form(p);
+		child = nested(p, p_form);
 		if (!child)
 			return NULL;
 		tok = gettok(p);
 		if (tok != TK_RPAR) {
-			snprintf(p->errbuf, p->errbufsz,
-				 "syntax error in formula");
+			synerr(p);
 			ast_destroy(child);
 			return NULL;
 		}
@@ -539,7 +759,7 @@ static struct ast *p_unit(struct pdata *p)
 
 	if (tok == TK_NOT) {
 		(void)gettok(p);
-		child = p_unit(p);
+		child = nested(p, p_unit);
 		if (!child)
 			return NULL;
 		unit = calloc(1, sizeof(*unit));
@@ -548,7 +768,7 @@ static struct ast *p_unit(struct pdata *p)
 		return unit;
 	}
 
-	snprintf(p->errbuf, p->errbufsz, "syntax error in formula");
+	synerr(p);
 	return NULL;
 }
 
@@ -590,6 +810,9 @@ struct ast *ast_copy(struct ast *ast)
 
 int ast_equal(struct ast *ast1, struct ast *ast2)
 {
+	/* conclusions of rules share subformulas with their inputs */
+	if (ast1 == ast2)
+		return 1;
 	if (ast1->type != ast2->type)
 		return 0;
 	if (ast1->text && ast2->text && strcmp(ast1->text, ast2->text) != 0)
@@ -601,6 +824,22 @@ int ast_equal(struct ast *ast1, struct ast *ast2)
 	return 1;
 }
 
+uint64_t ast_hash(struct ast *ast)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	const char *c;
+
+	h = (h ^ ast->type) * 0x100000001b3ULL;
+	if (ast->text)
+		for (c = ast->text; *c; c++)
+			h = (h ^ (unsigned char)*c) * 0x100000001b3ULL;
+	if (ast->lhs)
+		h = (h ^ ast_hash(ast->lhs)) * 0x100000001b3ULL;
+	if (ast->rhs)
+		h = (h ^ ast_hash(ast->rhs)) * 0x100000001b3ULL;
+	return h;
+}
+
 void ast_destroy(struct ast *ast)
 {
 	if (!ast)
@@ -644,7 +883,7 @@ size_t print_form(struct ast *form, char *buf, size_t s)
 	}
 }
 
-static const char *rulestr(int r)
+const char *rulestr(int r)
 {
 	switch (r) {
 	case RULE_NOT_INTR:
@@ -686,7 +925,25 @@ static const char *rulestr(int r)
 	}
 }
 
-static size_t print_inp(struct ast *inp, char *buf, size_t s)
+/* Rules not built into the parser are looked up by name when applied. */
+int rule_type(const char *name)
+{
+	for (int r = RULE_NOT_INTR; r < RULE_NAMED; r++) {
+		if (strcmp(rulestr(r), name) == 0)
+			return r;
+	}
+	return RULE_NAMED;
+}
+
+const char *ast_rule_name(struct ast *cmd)
+{
+	assert(cmd->type == CMD_APPLY);
+	if (cmd->lhs->type == RULE_NAMED)
+		return cmd->lhs->text;
+	return rulestr(cmd->lhs->type);
+}
+
+size_t print_inputs(struct ast *inp, char *buf, size_t s)
 {
 	char ibuf[s];
 	char fbuf[s];
@@ -694,7 +951,7 @@ static size_t print_inp(struct ast *inp, char *buf, size_t s)
 	assert(is_input(inp->type));
 
 	if (inp->rhs)
-		print_inp(inp->rhs, ibuf, s);
+		print_inputs(inp->rhs, ibuf, s);
 
 	switch (inp->type) {
 	case INPUT_LINE:
@@ -732,9 +989,9 @@ size_t print_apply(struct ast *cmd, char *buf, size_t s)
 	assert(cmd->type == CMD_APPLY);
 
 	if (cmd->rhs) {
-		print_inp(cmd->rhs, ibuf, s);
-		return snprintf(buf, s, "%s %s", rulestr(cmd->lhs->type), ibuf);
+		print_inputs(cmd->rhs, ibuf, s);
+		return snprintf(buf, s, "%s %s", ast_rule_name(cmd), ibuf);
 	} else {
-		return snprintf(buf, s, "%s", rulestr(cmd->lhs->type));
+		return snprintf(buf, s, "%s", ast_rule_name(cmd));
 	}
 }
@@ -2,6 +2,7 @@
 #define PARSE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 enum {
 	FORM_NOT,
@@ -16,6 +17,16 @@ enum {
 	CMD_CLOSE,
 	CMD_APPLY,
 	CMD_EXPORT,
+	CMD_EXPORT_CNF,
+	CMD_FIND,
+	CMD_PROVE,
+	CMD_VALID,
+	CMD_EQUIV,
+	CMD_NNF,
+	CMD_CNF,
+	CMD_DNF,
+	CMD_SIMPLIFY,
+	CMD_NEW,
 	INPUT_LINE,
 	INPUT_BOX,
 	INPUT_FORM,
@@ -36,6 +47,7 @@ enum {
 	RULE_PBC,
 	RULE_LEM,
 	RULE_COPY,
+	RULE_NAMED,
 };
 
 static inline int is_form(int type)
@@ -62,6 +74,16 @@ static inline int is_cmd(int type)
 	case CMD_CLOSE:
 	case CMD_APPLY:
 	case CMD_EXPORT:
+	case CMD_EXPORT_CNF:
+	case CMD_FIND:
+	case CMD_PROVE:
+	case CMD_VALID:
+	case CMD_EQUIV:
+	case CMD_NNF:
+	case CMD_CNF:
+	case CMD_DNF:
+	case CMD_SIMPLIFY:
+	case CMD_NEW:
 		return 1;
 	default:
 		return 0;
@@ -105,6 +127,17 @@ static inline int is_rule(int type)
 	}
 }
 
+#define PARSE_MAX_NODES (1 << 16)
+#define PARSE_MAX_DEPTH 1000
+
+/* Bounds on the size of a parsed command, counted in tokens and levels
+ * of nesting. exceeded is set when parsing failed due to a limit. */
+struct parse_limits {
+	int max_nodes;
+	int max_depth;
+	int exceeded;
+};
+
 struct ast {
 	int type;
 	char *text;
@@ -116,13 +149,25 @@ struct ast {
 
 struct ast *parse(const char *text, size_t length, char *errbuf,
 		  size_t errbuf_length);
+struct ast *parse_limited(const char *text, size_t length,
+			  struct parse_limits *lim, char *errbuf,
+			  size_t errbuf_length);
+struct ast *parse_form(const char *text, size_t length, char *errbuf,
+		       size_t errbuf_length);
+struct ast *parse_pattern(const char *text, size_t length, char *errbuf,
+			  size_t errbuf_length);
 struct ast *ast_form(struct ast *cmd);
 int ast_rule(struct ast *cmd);
 struct ast *ast_rule_input(struct ast *cmd, size_t n);
 struct ast *ast_copy(struct ast *ast);
 int ast_equal(struct ast *ast1, struct ast *ast2);
+uint64_t ast_hash(struct ast *ast);
 void ast_destroy(struct ast *ast);
 size_t print_form(struct ast *form, char *buf, size_t s);
 size_t print_apply(struct ast *cmd, char *buf, size_t s);
+size_t print_inputs(struct ast *inp, char *buf, size_t s);
+const char *rulestr(int rule);
+int rule_type(const char *name);
+const char *ast_rule_name(struct ast *cmd);
 
 #endif
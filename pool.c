@@ -0,0 +1,240 @@
+#include "pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct deque {
+	pthread_mutex_t lock;
+	struct job **jobs;
+	int head;
+	int tail;
+	int cap;
+};
+
+struct worker {
+	struct pool *pool;
+	int id;
+};
+
+struct pool {
+	int n;
+	struct deque *deques;
+	struct worker *workers;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t joined;	/* a job is done or queued, for pool_join */
+	atomic_int queued;
+	atomic_int idle;
+	atomic_int joining;
+	atomic_int quit;
+};
+
+static struct job *pop_tail(struct deque *dq, struct job *want)
+{
+	struct job *job = NULL;
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail > dq->head
+	    && (!want || dq->jobs[dq->tail - 1] == want))
+		job = dq->jobs[--dq->tail];
+	pthread_mutex_unlock(&dq->lock);
+	return job;
+}
+
+static struct job *steal(struct deque *dq)
+{
+	struct job *job = NULL;
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail > dq->head)
+		job = dq->jobs[dq->head++];
+	pthread_mutex_unlock(&dq->lock);
+	return job;
+}
+
+static struct job *take(struct pool *pool, int id)
+{
+	struct job *job;
+
+	if (!atomic_load(&pool->queued))
+		return NULL;
+	job = pop_tail(&pool->deques[id], NULL);
+	for (int k = 1; !job && k < pool->n; k++)
+		job = steal(&pool->deques[(id + k) % pool->n]);
+	if (job)
+		atomic_fetch_sub(&pool->queued, 1);
+	return job;
+}
+
+static void wake_joiners(struct pool *pool)
+{
+	if (!atomic_load(&pool->joining))
+		return;
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->joined);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void exec(struct pool *pool, struct job *job, int id)
+{
+	job->run(job, id);
+	atomic_store(&job->done, 1);
+	wake_joiners(pool);
+}
+
+static void *work(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *pool = w->pool;
+	struct job *job;
+
+	while (!atomic_load(&pool->quit)) {
+		if ((job = take(pool, w->id))) {
+			exec(pool, job, w->id);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		atomic_fetch_add(&pool->idle, 1);
+		while (!atomic_load(&pool->queued)
+		       && !atomic_load(&pool->quit))
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		atomic_fetch_sub(&pool->idle, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+struct pool *pool_new(int nworkers)
+{
+	struct pool *pool;
+
+	pool = calloc(1, sizeof(*pool));
+	pool->n = nworkers < 1 ? 1 : nworkers;
+	pool->deques = calloc(pool->n, sizeof(*pool->deques));
+	pool->workers = calloc(pool->n, sizeof(*pool->workers));
+	pool->threads = calloc(pool->n, sizeof(*pool->threads));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	pthread_cond_init(&pool->joined, NULL);
+
+	for (int i = 0; i < pool->n; i++) {
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+		pool->workers[i].pool = pool;
+		pool->workers[i].id = i;
+	}
+	for (int i = 1; i < pool->n; i++)
+		pthread_create(&pool->threads[i], NULL, work,
+			       &pool->workers[i]);
+	return pool;
+}
+
+void pool_destroy(struct pool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	atomic_store(&pool->quit, 1);
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 1; i < pool->n; i++)
+		pthread_join(pool->threads[i], NULL);
+	for (int i = 0; i < pool->n; i++) {
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].jobs);
+	}
+	pthread_cond_destroy(&pool->wake);
+	pthread_cond_destroy(&pool->joined);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->deques);
+	free(pool->workers);
+	free(pool->threads);
+	free(pool);
+}
+
+int pool_size(struct pool *pool)
+{
+	return pool->n;
+}
+
+/* Number of workers waiting for a job. */
+int pool_idle(struct pool *pool)
+{
+	return atomic_load(&pool->idle);
+}
+
+void pool_push(struct pool *pool, int worker, struct job *job)
+{
+	struct deque *dq = &pool->deques[worker];
+
+	atomic_store(&job->done, 0);
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail == dq->cap) {
+		if (dq->head) {
+			memmove(dq->jobs, dq->jobs + dq->head,
+				(dq->tail - dq->head) * sizeof(*dq->jobs));
+			dq->tail -= dq->head;
+			dq->head = 0;
+		} else {
+			dq->cap = dq->cap ? 2 * dq->cap : 64;
+			dq->jobs = realloc(dq->jobs,
+					   dq->cap * sizeof(*dq->jobs));
+		}
+	}
+	dq->jobs[dq->tail++] = job;
+	pthread_mutex_unlock(&dq->lock);
+
+	atomic_fetch_add(&pool->queued, 1);
+	if (atomic_load(&pool->idle)) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_signal(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	wake_joiners(pool);
+}
+
+/*
+ * Takes back the job last pushed by this worker unless it was stolen,
+ * for the worker to run it itself. Returns whether it did.
+ */
+int pool_cancel(struct pool *pool, int worker, struct job *job)
+{
+	if (!pop_tail(&pool->deques[worker], job))
+		return 0;
+	atomic_fetch_sub(&pool->queued, 1);
+	return 1;
+}
+
+/*
+ * Waits for a job pushed by this worker. Jobs are joined in the reverse
+ * order they were pushed in: a job still at the tail of the deque is run
+ * here, otherwise it was stolen and other jobs are run while waiting.
+ * With none to run the worker sleeps rather than spin, which would take
+ * the processor from the thief on a machine with fewer cores than jobs.
+ */
+void pool_join(struct pool *pool, int worker, struct job *job)
+{
+	struct job *other;
+
+	if (pop_tail(&pool->deques[worker], job)) {
+		atomic_fetch_sub(&pool->queued, 1);
+		exec(pool, job, worker);
+		return;
+	}
+
+	while (!atomic_load(&job->done)) {
+		if ((other = take(pool, worker))) {
+			exec(pool, other, worker);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		atomic_fetch_add(&pool->joining, 1);
+		while (!atomic_load(&job->done) && !atomic_load(&pool->queued))
+			pthread_cond_wait(&pool->joined, &pool->lock);
+		atomic_fetch_sub(&pool->joining, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+
+/*
+ * A work-stealing thread pool. Worker 0 is the thread that created the
+ * pool, the others are started by it. Each worker has a deque of jobs: it
+ * pushes and pops its own jobs at the tail, idle workers steal from the
+ * head of the others.
+ */
+struct job {
+	void (*run)(struct job *job, int worker);
+	atomic_int done;
+};
+
+struct pool;
+
+struct pool *pool_new(int nworkers);
+void pool_destroy(struct pool *pool);
+int pool_size(struct pool *pool);
+int pool_idle(struct pool *pool);
+void pool_push(struct pool *pool, int worker, struct job *job);
+int pool_cancel(struct pool *pool, int worker, struct job *job);
+void pool_join(struct pool *pool, int worker, struct job *job);
+
+#endif
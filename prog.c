@@ -0,0 +1,384 @@
+#include "prog.h"
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+
+#if defined(__x86_64__)
+#define LANE_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_CLONES
+#endif
+
+struct cdata {
+	struct prog *p;
+	int cap;
+	int *table;		/* open addressing, instruction plus one */
+	int tabcap;
+};
+
+static size_t slot(int op, int a, int b, int tabcap)
+{
+	uint64_t h = ((uint64_t)op * 31 + a) * 0x100000001b3ULL ^ b;
+
+	h *= 0x9e3779b97f4a7c15ULL;
+	return (h >> 32) & (tabcap - 1);
+}
+
+static void rehash(struct cdata *c)
+{
+	struct insn *in;
+	size_t s;
+
+	free(c->table);
+	c->tabcap = c->tabcap ? 2 * c->tabcap : 1024;
+	c->table = calloc(c->tabcap, sizeof(*c->table));
+	for (int i = 0; i < c->p->n; i++) {
+		in = &c->p->code[i];
+		s = slot(in->op, in->a, in->b, c->tabcap);
+		while (c->table[s])
+			s = (s + 1) & (c->tabcap - 1);
+		c->table[s] = i + 1;
+	}
+}
+
+/* The instruction computing op on the values of instructions a and b,
+ * added unless there is one already. */
+static int value(struct cdata *c, int op, int a, int b)
+{
+	struct prog *p = c->p;
+	struct insn *in;
+	size_t s;
+	int t;
+
+	if ((op == OP_AND || op == OP_OR) && a > b) {
+		t = a;
+		a = b;
+		b = t;
+	}
+	if (2 * (p->n + 1) > c->tabcap)
+		rehash(c);
+	s = slot(op, a, b, c->tabcap);
+	for (; c->table[s]; s = (s + 1) & (c->tabcap - 1)) {
+		in = &p->code[c->table[s] - 1];
+		if (in->op == op && in->a == a && in->b == b)
+			return c->table[s] - 1;
+	}
+
+	if (p->n == c->cap) {
+		c->cap = c->cap ? 2 * c->cap : 64;
+		p->code = realloc(p->code, c->cap * sizeof(*p->code));
+	}
+	p->code[p->n] = (struct insn){ op, 0, a, b };
+	c->table[s] = p->n + 1;
+	return p->n++;
+}
+
+static int atom(struct prog *p, const char *name)
+{
+	for (int i = 0; i < p->natoms; i++) {
+		if (strcmp(p->atoms[i], name) == 0)
+			return i;
+	}
+	p->atoms = realloc(p->atoms, (p->natoms + 1) * sizeof(*p->atoms));
+	p->atoms[p->natoms] = name;
+	return p->natoms++;
+}
+
+static int compile(struct cdata *c, struct ast *form)
+{
+	int a;
+
+	switch (form->type) {
+	case FORM_NAME:
+		return value(c, OP_ATOM, atom(c->p, form->text), 0);
+	case FORM_CON:
+		return value(c, OP_FALSE, 0, 0);
+	case FORM_NOT:
+		a = compile(c, form->lhs);
+		if (c->p->code[a].op == OP_NOT)
+			return c->p->code[a].a;
+		return value(c, OP_NOT, a, 0);
+	default:
+		/* atoms are numbered left to right */
+		a = compile(c, form->lhs);
+		return value(c, form->type == FORM_AND ? OP_AND
+			     : form->type == FORM_OR ? OP_OR : OP_IMPL, a,
+			     compile(c, form->rhs));
+	}
+}
+
+static int operands(const struct insn *in)
+{
+	switch (in->op) {
+	case OP_ATOM:
+	case OP_FALSE:
+		return 0;
+	case OP_NOT:
+		return 1;
+	default:
+		return 2;
+	}
+}
+
+/* Keeps the instructions marked, numbering them anew in renum. */
+static void compact(struct prog *p, const char *keep, int *renum)
+{
+	int n = 0, k = 0;
+
+	for (int j = 0; j < p->n; j++) {
+		for (; k < p->nforms && p->ends[k] == j; k++)
+			p->ends[k] = n;
+		if (!keep[j])
+			continue;
+		if (renum)
+			renum[j] = n;
+		p->code[n++] = p->code[j];
+	}
+	for (; k < p->nforms; k++)
+		p->ends[k] = n;
+	p->n = n;
+}
+
+/* Drops the instructions no formula depends on, left by --A. */
+static void drop_dead(struct prog *p)
+{
+	char *live = calloc(p->n, 1);
+	int *renum = malloc(p->n * sizeof(*renum));
+	struct insn *in;
+
+	for (int i = 0; i < p->nforms; i++)
+		live[p->outs[i]] = 1;
+	for (int j = p->n - 1; j >= 0; j--) {
+		in = &p->code[j];
+		if (live[j] && operands(in) >= 1)
+			live[in->a] = 1;
+		if (live[j] && operands(in) == 2)
+			live[in->b] = 1;
+	}
+
+	compact(p, live, renum);
+	for (int j = 0; j < p->n; j++) {
+		in = &p->code[j];
+		if (operands(in) >= 1)
+			in->a = renum[in->a];
+		if (operands(in) == 2)
+			in->b = renum[in->b];
+	}
+	for (int i = 0; i < p->nforms; i++)
+		p->outs[i] = renum[p->outs[i]];
+	free(renum);
+	free(live);
+}
+
+/*
+ * Assigns registers in one pass over the code: a value's register is
+ * free again once its last reader has run, and may be the destination
+ * of that reader. Atoms are read from their own registers, so their
+ * instructions go.
+ */
+static void alloc_regs(struct prog *p)
+{
+	int *last = malloc((p->n + 1) * sizeof(*last));
+	int *dies = malloc((p->n + 1) * sizeof(*dies));
+	int *next = malloc((p->n + 1) * sizeof(*next));
+	int *reg = malloc((p->n + 1) * sizeof(*reg));
+	int *free_regs = malloc((p->n + 1) * sizeof(*free_regs));
+	char *keep = malloc(p->n + 1);
+	struct insn *in;
+	int nfree = 0;
+
+	for (int j = 0; j < p->n; j++) {
+		last[j] = p->n;
+		dies[j] = -1;
+		in = &p->code[j];
+		if (operands(in) >= 1)
+			last[in->a] = j;
+		if (operands(in) == 2)
+			last[in->b] = j;
+	}
+	dies[p->n] = -1;
+	/* a formula is read after its segment has run */
+	for (int i = 0; i < p->nforms; i++) {
+		if (last[p->outs[i]] < p->ends[i])
+			last[p->outs[i]] = p->ends[i];
+	}
+	for (int j = 0; j < p->n; j++) {
+		if (p->code[j].op == OP_ATOM)
+			continue;
+		next[j] = dies[last[j]];
+		dies[last[j]] = j;
+	}
+
+	p->nregs = p->natoms;
+	for (int j = 0; j < p->n; j++) {
+		for (int v = dies[j]; v >= 0; v = next[v])
+			free_regs[nfree++] = reg[v];
+		in = &p->code[j];
+		keep[j] = in->op != OP_ATOM;
+		if (!keep[j])
+			reg[j] = in->a;
+		else
+			reg[j] = nfree ? free_regs[--nfree] : p->nregs++;
+		if (operands(in) >= 1)
+			in->a = reg[in->a];
+		if (operands(in) == 2)
+			in->b = reg[in->b];
+		in->dst = reg[j];
+	}
+	for (int i = 0; i < p->nforms; i++)
+		p->outs[i] = reg[p->outs[i]];
+	compact(p, keep, NULL);
+
+	free(keep);
+	free(free_regs);
+	free(reg);
+	free(next);
+	free(dies);
+	free(last);
+}
+
+struct prog *prog_compile(struct ast **forms, int nforms)
+{
+	struct cdata c = { 0 };
+	struct prog *p;
+
+	p = calloc(1, sizeof(*p));
+	p->outs = malloc((nforms + 1) * sizeof(*p->outs));
+	p->ends = malloc((nforms + 1) * sizeof(*p->ends));
+	p->nforms = nforms;
+	c.p = p;
+	for (int i = 0; i < nforms; i++) {
+		p->outs[i] = compile(&c, forms[i]);
+		p->ends[i] = p->n;
+	}
+	free(c.table);
+
+	drop_dead(p);
+	alloc_regs(p);
+	return p;
+}
+
+void prog_destroy(struct prog *p)
+{
+	if (!p)
+		return;
+	free(p->code);
+	free(p->atoms);
+	free(p->outs);
+	free(p->ends);
+	free(p);
+}
+
+/* Registers for running p, to be freed. */
+block *prog_regs(struct prog *p)
+{
+	/* lanes are loaded whole, which may need them aligned */
+	return aligned_alloc(sizeof(lane), (p->nregs + 1) * sizeof(block));
+}
+
+/* Runs instructions from up to to, on the block of valuations in the
+ * atom registers. */
+LANE_CLONES
+void prog_run(const struct prog *p, int from, int to, block *regs)
+{
+	const struct insn *in;
+	lane *d, *a, *b;
+
+	for (int j = from; j < to; j++) {
+		in = &p->code[j];
+		d = regs[in->dst];
+		a = regs[in->a];
+		b = regs[in->b];
+		switch (in->op) {
+		case OP_FALSE:
+			memset(d, 0, sizeof(block));
+			break;
+		case OP_NOT:
+			for (int i = 0; i < PROG_LANES; i++)
+				d[i] = ~a[i];
+			break;
+		case OP_AND:
+			for (int i = 0; i < PROG_LANES; i++)
+				d[i] = a[i] & b[i];
+			break;
+		case OP_OR:
+			for (int i = 0; i < PROG_LANES; i++)
+				d[i] = a[i] | b[i];
+			break;
+		case OP_IMPL:
+			for (int i = 0; i < PROG_LANES; i++)
+				d[i] = ~a[i] | b[i];
+			break;
+		}
+	}
+}
+
+/* The blocks covering all valuations of the atoms. */
+uint64_t prog_blocks(const struct prog *p)
+{
+	return p->natoms > PROG_BLOCK_BITS
+	    ? (uint64_t)1 << (p->natoms - PROG_BLOCK_BITS) : 1;
+}
+
+/*
+ * Sets the atom registers to block blk of the valuations. Valuation i of
+ * a block makes atom k true when bit k of i is set, the atoms past
+ * PROG_BLOCK_BITS are constant within a block and set by the bits of blk.
+ */
+void prog_set_atoms(const struct prog *p, block *regs, uint64_t blk)
+{
+	static const uint64_t low[6] = {
+		0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL,
+		0xf0f0f0f0f0f0f0f0ULL, 0xff00ff00ff00ff00ULL,
+		0xffff0000ffff0000ULL, 0xffffffff00000000ULL,
+	};
+	uint64_t bits;
+	int word;
+
+	for (int k = 0; k < p->natoms; k++) {
+		for (int i = 0; i < PROG_LANES; i++) {
+			for (int j = 0; j < PROG_LANE_WORDS; j++) {
+				word = i * PROG_LANE_WORDS + j;
+				if (k < 6)
+					bits = low[k];
+				else if (k < PROG_BLOCK_BITS)
+					bits = -(uint64_t)(word >> (k - 6) & 1);
+				else
+					bits = -(blk >> (k - PROG_BLOCK_BITS)
+						 & 1);
+				regs[k][i][j] = bits;
+			}
+		}
+	}
+}
+
+int prog_any(const lane *m)
+{
+	lane acc = m[0];
+
+	for (int i = 1; i < PROG_LANES; i++)
+		acc |= m[i];
+	return (acc[0] | acc[1] | acc[2] | acc[3]) != 0;
+}
+
+/* The first valuation set in a block, or -1 if none is. */
+int prog_first(const lane *m)
+{
+	uint64_t bits;
+
+	for (int i = 0; i < PROG_LANES * PROG_LANE_WORDS; i++) {
+		bits = m[i / PROG_LANE_WORDS][i % PROG_LANE_WORDS];
+		if (bits)
+			return i << 6 | __builtin_ctzll(bits);
+	}
+	return -1;
+}
+
+/* The truth values of the atoms in valuation i of block blk. */
+void prog_valuation(const struct prog *p, uint64_t blk, int i, char *vals)
+{
+	for (int k = 0; k < p->natoms; k++) {
+		vals[k] = k < PROG_BLOCK_BITS ? i >> k & 1
+		    : blk >> (k - PROG_BLOCK_BITS) & 1;
+	}
+}
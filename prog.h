@@ -0,0 +1,63 @@
+#ifndef PROG_H
+#define PROG_H
+
+#include <stdint.h>
+
+struct ast;
+
+/* Four words of valuations, one bit each. */
+typedef uint64_t lane __attribute__((vector_size(32)));
+
+/* Lanes evaluated by each instruction. */
+#define PROG_LANES 16
+#define PROG_LANE_WORDS 4
+/* log2 of the valuations in a block */
+#define PROG_BLOCK_BITS 12
+
+typedef lane block[PROG_LANES];
+
+enum {
+	OP_ATOM,		/* only while compiling */
+	OP_FALSE,
+	OP_NOT,
+	OP_AND,
+	OP_OR,
+	OP_IMPL,
+};
+
+struct insn {
+	int op;
+	int dst;
+	int a;
+	int b;
+};
+
+/*
+ * Formulas compiled to straight-line code over registers of a block each.
+ * Equal subformulas are computed once, up to the order of the operands of
+ * ^ and /. Registers 0 to natoms - 1 hold the atoms and are set by the
+ * caller. Formula i is computed by the instructions before ends[i], into
+ * register outs[i], which holds it until instruction ends[i] runs.
+ */
+struct prog {
+	struct insn *code;
+	int n;
+	int nregs;
+	const char **atoms;	/* names, pointing into the formulas */
+	int natoms;
+	int *outs;
+	int *ends;
+	int nforms;
+};
+
+struct prog *prog_compile(struct ast **forms, int nforms);
+void prog_destroy(struct prog *p);
+block *prog_regs(struct prog *p);
+void prog_run(const struct prog *p, int from, int to, block *regs);
+uint64_t prog_blocks(const struct prog *p);
+void prog_set_atoms(const struct prog *p, block *regs, uint64_t blk);
+int prog_any(const lane *m);
+int prog_first(const lane *m);
+void prog_valuation(const struct prog *p, uint64_t blk, int i, char *vals);
+
+#endif
@@ -2,7 +2,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdarg.h>
+#include <time.h>
 #include "log.h"
+#include "parse.h"
 
 struct proof new_proof(void)
 {
@@ -11,12 +14,132 @@ struct proof new_proof(void)
 	p.lns = malloc(p.lncap * sizeof(*p.lns));
 	p.cmdcap = 32;
 	p.allcmds = malloc(p.cmdcap * sizeof(*p.allcmds));
+	p.lim.max_form_depth = 4 * PARSE_MAX_DEPTH;
+	p.lim.max_form_nodes = PROOF_MAX_FORM_NODES;
+	p.lim.max_mem = PROOF_MAX_MEM;
 	return p;
 }
 
-void pushln(struct proof *p, struct ast *cmd, struct ast *form)
+static long now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void proof_set_limits(struct proof *p, const struct limits *lim)
+{
+	p->lim = *lim;
+	if (!p->lim.max_form_depth)
+		p->lim.max_form_depth = 4 * PARSE_MAX_DEPTH;
+	p->deadline = lim->max_time_ms ? now_ms() + lim->max_time_ms : 0;
+}
+
+static int exceeded(struct proof *p, const char *fmt, ...)
+{
+	va_list vl;
+	int n;
+
+	p->err = ERR_LIMIT;
+	n = snprintf(p->errbuf, sizeof(p->errbuf), "limit exceeded: ");
+	va_start(vl, fmt);
+	vsnprintf(p->errbuf + n, sizeof(p->errbuf) - n, fmt, vl);
+	va_end(vl);
+	return 0;
+}
+
+int check_deadline(struct proof *p)
+{
+	if (p->deadline && now_ms() > p->deadline)
+		return exceeded(p, "out of time");
+	return 1;
+}
+
+static int measure(struct ast *form, int *nodes)
+{
+	int l = 0, r = 0;
+
+	(*nodes)++;
+	if (form->lhs)
+		l = measure(form->lhs, nodes);
+	if (form->rhs)
+		r = measure(form->rhs, nodes);
+	return 1 + (l > r ? l : r);
+}
+
+void destroy_proof(struct proof *p)
+{
+	struct box *b, *next;
+
+	/*
+	 * conclusions of rules are single allocations sharing the rest
+	 * with their inputs, see schema_apply
+	 */
+	for (int i = 0; i < p->nlns; i++) {
+		if (p->lns[i].form != p->lns[i].cmd->lhs)
+			free(p->lns[i].form);
+	}
+	for (int i = 0; i < p->ncmds; i++)
+		ast_destroy(p->allcmds[i]);
+	for (b = p->boxes; b; b = next) {
+		next = b->next;
+		free(b);
+	}
+	free(p->lns);
+	free(p->allcmds);
+	index_destroy(&p->idx);
+}
+
+static size_t line_mem(int nodes)
+{
+	return nodes * sizeof(struct ast) + sizeof(struct ln);
+}
+
+/*
+ * Whether a line with a formula of that size would be within the limits,
+ * failing with ERR_LIMIT if not. Lets callers check before building it.
+ */
+int proof_fits(struct proof *p, int nodes, int depth)
+{
+	if (!check_deadline(p))
+		return 0;
+	if (p->lim.max_form_depth && depth > p->lim.max_form_depth)
+		return exceeded(p, "formula nested too deeply");
+	if (p->lim.max_form_nodes && nodes > p->lim.max_form_nodes)
+		return exceeded(p, "formula too large");
+	if (p->lim.max_mem && p->mem + line_mem(nodes) > p->lim.max_mem)
+		return exceeded(p, "out of memory");
+	if (p->lim.max_lines && p->nlns == p->lim.max_lines)
+		return exceeded(p, "too many lines");
+	return 1;
+}
+
+/*
+ * Adds a line for a premise or assumption, form being that of the command
+ * and staying with it. Fails with ERR_LIMIT if the proof is over budget.
+ */
+int pushln(struct proof *p, struct ast *cmd, struct ast *form)
+{
+	int nodes = 0, depth;
+
+	depth = measure(form, &nodes);
+	if (!proof_fits(p, nodes, depth))
+		return 0;
+	pushln_fitted(p, cmd, form, nodes);
+	return 1;
+}
+
+/*
+ * Adds a line whose formula proof_fits has let through. The proof owns a
+ * formula other than the command's, see destroy_proof.
+ */
+void pushln_fitted(struct proof *p, struct ast *cmd, struct ast *form,
+		   int nodes)
 {
 	struct ln ln;
+
+	p->mem += line_mem(nodes);
+
 	ln.cmd = cmd;
 	ln.form = form;
 	ln.box = p->boxhead;
@@ -25,6 +148,7 @@ void pushln(struct proof *p, struct ast *cmd, struct ast *form)
 		p->lncap *= 2;
 		p->lns = realloc(p->lns, p->lncap * sizeof(*p->lns));
 	}
+	index_add(&p->idx, p->nlns, form);
 	p->lns[p->nlns++] = ln;
 }
 
@@ -91,12 +215,25 @@ int box_depth(struct box *b)
 	return c;
 }
 
-void push_box(struct proof *p)
+int push_box(struct proof *p)
 {
-	struct box *b = calloc(1, sizeof(*b));
+	struct box *b;
+
+	if (!check_deadline(p))
+		return 0;
+	if (p->lim.max_depth && box_depth(p->boxhead) == p->lim.max_depth)
+		return exceeded(p, "boxes nested too deeply");
+	if (p->lim.max_mem && p->mem + sizeof(*b) > p->lim.max_mem)
+		return exceeded(p, "out of memory");
+	p->mem += sizeof(*b);
+
+	b = calloc(1, sizeof(*b));
 	b->start = p->nlns;
 	b->parent = p->boxhead;
+	b->next = p->boxes;
+	p->boxes = b;
 	p->boxhead = b;
+	return 1;
 }
 
 int pop_box(struct proof *p)
@@ -106,9 +243,31 @@ int pop_box(struct proof *p)
 		return 0;
 	p->boxhead->end = p->nlns - 1;
 	p->boxhead = b->parent;
+	index_truncate(&p->idx, b->start);
 	return 1;
 }
 
+/*
+ * The premises before line n and the assumptions of the boxes around it,
+ * which the line has to follow from. Returns their number.
+ */
+int proof_context(struct proof *p, int n, struct ast **forms)
+{
+	struct box *b;
+	int nforms = 0, type;
+
+	for (int i = 0; i < n; i++) {
+		type = p->lns[i].cmd->type;
+		if (type != CMD_PRESUME && type != CMD_ASSUME)
+			continue;
+		for (b = p->lns[n].box; b && b != p->lns[i].box; b = b->parent)
+			;
+		if (b || !p->lns[i].box)
+			forms[nforms++] = p->lns[i].form;
+	}
+	return nforms;
+}
+
 int at_beginning_of_box(struct proof *p)
 {
 	if (p->boxhead)
@@ -126,3 +285,33 @@ struct box *get_box_with_range(struct proof *p, int start, int end)
 	}
 	return NULL;
 }
+
+const char *errstr(int err)
+{
+	switch (err) {
+	case ERR_OK:
+		return "ok";
+	case ERR_IO:
+		return "io";
+	case ERR_PARSE:
+		return "parse";
+	case ERR_NO_BOX:
+		return "no_box";
+	case ERR_ASSUME:
+		return "assume";
+	case ERR_INPUTS:
+		return "inputs";
+	case ERR_SCOPE:
+		return "scope";
+	case ERR_PREMISE:
+		return "premise";
+	case ERR_GOAL:
+		return "goal";
+	case ERR_LIMIT:
+		return "limit";
+	case ERR_ORACLE:
+		return "oracle";
+	default:
+		return NULL;
+	}
+}
@@ -2,11 +2,41 @@
 #define PROOF_H
 
 #include <stddef.h>
+#include "index.h"
+
+enum {
+	ERR_OK,
+	ERR_IO,
+	ERR_PARSE,
+	ERR_NO_BOX,
+	ERR_ASSUME,
+	ERR_INPUTS,
+	ERR_SCOPE,
+	ERR_PREMISE,
+	ERR_GOAL,
+	ERR_LIMIT,
+	ERR_ORACLE,
+};
+
+#define PROOF_MAX_FORM_NODES (1 << 20)
+#define PROOF_MAX_MEM ((size_t)1 << 28)
+
+/* Per-proof resource budgets, zero meaning unlimited. */
+struct limits {
+	int max_lines;
+	int max_depth;
+	int max_form_nodes;
+	int max_form_depth;
+	long max_time_ms;
+	size_t max_mem;
+	int oracle;		/* cross-check accepted lines, see oracle.h */
+};
 
 struct box {
 	int start;
 	int end;
 	struct box *parent;
+	struct box *next;
 };
 
 struct ln {
@@ -23,18 +53,32 @@ struct proof {
 	int ncmds;
 	int cmdcap;
 	struct box *boxhead;
+	struct box *boxes;
+	struct index idx;
+	struct limits lim;
+	long deadline;
+	size_t mem;
+	int err;
 	char errbuf[512];
 };
 
 struct proof new_proof(void);
-void pushln(struct proof *p, struct ast *cmd, struct ast *form);
+void destroy_proof(struct proof *p);
+void proof_set_limits(struct proof *p, const struct limits *lim);
+int pushln(struct proof *p, struct ast *cmd, struct ast *form);
+void pushln_fitted(struct proof *p, struct ast *cmd, struct ast *form,
+		   int nodes);
+int proof_fits(struct proof *p, int nodes, int depth);
 void pushcmd(struct proof *p, struct ast *cmd);
 int box_depth(struct box *b);
-void push_box(struct proof *p);
+int push_box(struct proof *p);
+int check_deadline(struct proof *p);
 int pop_box(struct proof *p);
 int can_ref_ln(struct proof *p, int n);
 int can_ref_box(struct proof *p, int start, int end);
 struct box *get_box_with_range(struct proof *p, int start, int end);
 int at_beginning_of_box(struct proof *p);
+int proof_context(struct proof *p, int n, struct ast **forms);
+const char *errstr(int err);
 
 #endif
@@ -0,0 +1,1609 @@
+#include "prove.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "g4.h"
+#include "log.h"
+#include "parse.h"
+#include "index.h"
+#include "pool.h"
+#include "prover.h"
+#include "refute.h"
+#include "sem.h"
+#include "tableau.h"
+#include "term.h"
+
+/*
+ * Goal-directed proof search. Introduction rules are tried by the shape
+ * of the goal, elimination rules on the formulas in context, and PBC last.
+ * Conjunctions, double negations and modus ponens are applied eagerly
+ * whenever a formula enters the context. The search is depth-first with
+ * iterative deepening, and subgoals that failed or were proved in a
+ * context are memoized.
+ *
+ * With more than one job, the alternatives for a goal are forked onto a
+ * work-stealing pool while some worker is idle. The first alternative to
+ * succeed cancels its siblings. Workers share the formulas and the memo,
+ * each has its own context and allocates derivations from its own arena.
+ *
+ * Before a goal is expanded it is evaluated under the models of the
+ * context, and dropped if one of them makes it false. The truth tables
+ * are kept per formula, and the models of each prefix of the context
+ * alongside it.
+ *
+ * A strategy fixes the order the alternatives are tried in. A portfolio
+ * races every strategy in a thread of its own, up to a shared deadline.
+ * Intuitionistic goals are decided by G4ip instead, in g4.c, and tableau.c
+ * and refute.c prove goals by tableaux and by resolution.
+ *
+ * The result is a derivation tree, which is turned into the commands a
+ * user would type. Line numbers are only assigned then, reusing any line
+ * that is still in scope.
+ */
+
+#define MEMO_SIZE (1 << 16)
+#define DERIV_CHUNK 256
+
+/*
+ * Alternatives are only forked with at least this much depth left, in
+ * the first FORK_LEVELS below the root, and once the search has taken
+ * FORK_STEPS steps with as many left: goals of fewer steps stay on one
+ * thread, and forks are few enough to be worth the context each stolen
+ * one builds.
+ */
+#define FORK_DEPTH 3
+#define FORK_LEVELS 10
+#define FORK_STEPS (1L << 16)
+
+struct memo {
+	uint64_t ctx;
+	struct term *goal;
+	int depth;
+	struct deriv *proof;
+};
+
+/* Groups of alternatives, in the order a strategy tries them. */
+enum {
+	SEG_INTRO,
+	SEG_NOT_ELIM,
+	SEG_IMPL_ELIM,
+	SEG_CLASSICAL,
+	NSEGS,
+};
+
+struct strategy {
+	const char *name;
+	int order[NSEGS];
+	int deep;		/* start at the depth bound, no deepening */
+};
+
+static const struct strategy strategies[] = {
+	{ "backward", { SEG_INTRO, SEG_NOT_ELIM, SEG_IMPL_ELIM,
+			SEG_CLASSICAL }, 0 },
+	{ "forward", { SEG_IMPL_ELIM, SEG_NOT_ELIM, SEG_INTRO,
+		       SEG_CLASSICAL }, 0 },
+	{ "classical", { SEG_CLASSICAL, SEG_NOT_ELIM, SEG_IMPL_ELIM,
+			 SEG_INTRO }, 0 },
+	{ "deep", { SEG_INTRO, SEG_IMPL_ELIM, SEG_NOT_ELIM,
+		    SEG_CLASSICAL }, 1 },
+};
+
+#define NSTRATEGIES ((int)(sizeof(strategies) / sizeof(*strategies)))
+
+/* Portfolio races won by each strategy. */
+static long wins[NSTRATEGIES];
+
+long now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct deriv *mk(struct prover *pv, int rule, struct term *form)
+{
+	struct arena *a = &pv->sh->arenas[pv->worker];
+	struct deriv *d;
+
+	if (a->n % DERIV_CHUNK == 0) {
+		a->chunks = realloc(a->chunks,
+				    (a->nchunks + 1) * sizeof(*a->chunks));
+		a->chunks[a->nchunks++] =
+		    malloc(DERIV_CHUNK * sizeof(**a->chunks));
+	}
+	d = &a->chunks[a->n / DERIV_CHUNK][a->n % DERIV_CHUNK];
+	a->n++;
+	d->rule = rule;
+	d->form = form;
+	d->cost = rule != HYP;
+	d->nin = 0;
+	return d;
+}
+
+struct deriv *elim1(struct prover *pv, int rule, struct term *form,
+		    struct deriv *in)
+{
+	struct deriv *d = mk(pv, rule, form);
+	line_in(d, in);
+	return d;
+}
+
+struct deriv *elim2(struct prover *pv, int rule, struct term *form,
+		    struct deriv *in1, struct deriv *in2)
+{
+	struct deriv *d = mk(pv, rule, form);
+	line_in(d, in1);
+	line_in(d, in2);
+	return d;
+}
+
+/* -A from -(A / B), or -B with or_intro RULE_OR_INTR_2. */
+struct deriv *not_disjunct(struct prover *pv, struct term *t,
+			   int or_intro, struct deriv *d)
+{
+	struct term *a = or_intro == RULE_OR_INTR_1 ? t->lhs->lhs : t->lhs->rhs;
+	struct deriv *h = mk(pv, HYP, a), *in, *r;
+
+	in = mk(pv, or_intro, t->lhs);
+	if (or_intro == RULE_OR_INTR_1) {
+		line_in(in, h);
+		form_in(in, t->lhs->rhs);
+	} else {
+		form_in(in, t->lhs->lhs);
+		line_in(in, h);
+	}
+	r = mk(pv, RULE_NOT_INTR, neg(pv, a));
+	box_in(r, a, elim2(pv, RULE_NOT_ELIM, pv->sh->bot, in, d));
+	return r;
+}
+
+/* A => B from a derivation of B in a box opened with A. */
+struct deriv *impl(struct prover *pv, struct term *t, struct deriv *b)
+{
+	struct deriv *r = mk(pv, RULE_IMPL_INTR, t);
+	box_in(r, t->lhs, b);
+	return r;
+}
+
+/* A and -B from -(A => B), with PBC and -i. */
+struct deriv *not_impl(struct prover *pv, struct term *t, int left,
+		       struct deriv *d)
+{
+	struct term *a = t->lhs->lhs, *b = t->lhs->rhs, *hyp;
+	struct deriv *body, *r;
+
+	if (left) {
+		/* -A, A |- B by _|_e, so A => B contradicts d */
+		hyp = neg(pv, a);
+		body = mk(pv, RULE_CON_ELIM, b);
+		line_in(body, elim2(pv, RULE_NOT_ELIM, pv->sh->bot,
+				    mk(pv, HYP, a), mk(pv, HYP, hyp)));
+		form_in(body, b);
+		r = mk(pv, RULE_PBC, a);
+	} else {
+		hyp = b;
+		body = mk(pv, HYP, b);
+		r = mk(pv, RULE_NOT_INTR, neg(pv, b));
+	}
+	box_in(r, hyp, elim2(pv, RULE_NOT_ELIM, pv->sh->bot,
+			     impl(pv, t->lhs, body), d));
+	return r;
+}
+
+static void grow_where(struct prover *pv, int id)
+{
+	int old = pv->wherecap;
+
+	if (id < old)
+		return;
+	pv->wherecap = terms_count(pv->sh->terms) + 64;
+	pv->where = realloc(pv->where, pv->wherecap * sizeof(*pv->where));
+	memset(pv->where + old, 0, (pv->wherecap - old) * sizeof(*pv->where));
+}
+
+/* The truth tables of this worker, made on first use. */
+static struct sem *worker_sem(struct shared *sh, int worker)
+{
+	if (!sh->prune)
+		return NULL;
+	if (!sh->sems[worker])
+		sh->sems[worker] = sem_new(sh->atoms, sh->natoms);
+	return sh->sems[worker];
+}
+
+/* The valuations that are models of the first n formulas in context. */
+static uint64_t *models(struct prover *pv, int n)
+{
+	int words = sem_words(pv->sem), old = pv->modelscap;
+
+	if (n >= old) {
+		pv->modelscap = old ? 2 * old : 64;
+		if (pv->modelscap <= n)
+			pv->modelscap = n + 1;
+		pv->models = realloc(pv->models, pv->modelscap * words
+				     * sizeof(*pv->models));
+		if (!old)
+			memset(pv->models, 0xff, words * sizeof(*pv->models));
+	}
+	return pv->models + n * words;
+}
+
+static void enter(struct prover *pv, struct term *t, struct deriv *d)
+{
+	const uint64_t *v;
+	uint64_t *m;
+
+	grow_where(pv, t->id);
+	if (pv->sem) {
+		v = sem_eval(pv->sem, t);
+		m = models(pv, pv->nctx + 1);
+		for (int w = 0; w < sem_words(pv->sem); w++)
+			m[w] = m[w - sem_words(pv->sem)] & (v ? v[w] : ~0ULL);
+	}
+	if (pv->nctx == pv->ctxcap) {
+		pv->ctxcap = pv->ctxcap ? 2 * pv->ctxcap : 64;
+		pv->ctx = realloc(pv->ctx, pv->ctxcap * sizeof(*pv->ctx));
+	}
+	pv->ctx[pv->nctx].t = t;
+	pv->ctx[pv->nctx].hidden = 0;
+	pv->ctx[pv->nctx++].d = d;
+	pv->where[t->id] = pv->nctx;
+	pv->ctxkey ^= t->hash;
+}
+
+/* Adds t to the context, with what follows from it at once. Returns the
+ * number of formulas added. */
+static int push(struct prover *pv, struct term *t, struct deriv *d)
+{
+	struct deriv *e;
+	struct term *u;
+	int n = 1;
+
+	if (lookup(pv, t))
+		return 0;
+	enter(pv, t, d);
+
+	switch (t->type) {
+	case FORM_AND:
+		n += push(pv, t->lhs, elim1(pv, RULE_AND_ELIM_1, t->lhs, d));
+		n += push(pv, t->rhs, elim1(pv, RULE_AND_ELIM_2, t->rhs, d));
+		break;
+	case FORM_NOT:
+		u = t->lhs;
+		if (u->type == FORM_NOT && !pv->sh->intuitionistic)
+			n += push(pv, u->lhs,
+				  elim1(pv, RULE_NOT_NOT_ELIM, u->lhs, d));
+		if (u->type == FORM_OR) {
+			n += push(pv, neg(pv, u->lhs),
+				  not_disjunct(pv, t, RULE_OR_INTR_1, d));
+			n += push(pv, neg(pv, u->rhs),
+				  not_disjunct(pv, t, RULE_OR_INTR_2, d));
+		}
+		if (u->type == FORM_IMPL) {
+			if (!pv->sh->intuitionistic)
+				n += push(pv, u->lhs, not_impl(pv, t, 1, d));
+			n += push(pv, neg(pv, u->rhs), not_impl(pv, t, 0, d));
+		}
+		break;
+	case FORM_IMPL:
+		if ((e = lookup(pv, t->lhs)))
+			n += push(pv, t->rhs,
+				  elim2(pv, RULE_IMPL_ELIM, t->rhs, e, d));
+		break;
+	}
+
+	for (int i = 0; i < pv->nctx; i++) {
+		u = pv->ctx[i].t;
+		if (u->type == FORM_IMPL && u->lhs == t && !lookup(pv, u->rhs))
+			n += push(pv, u->rhs,
+				  elim2(pv, RULE_IMPL_ELIM, u->rhs, d,
+					pv->ctx[i].d));
+	}
+	return n;
+}
+
+void pop(struct prover *pv, int n)
+{
+	struct term *t;
+
+	while (n--) {
+		t = pv->ctx[--pv->nctx].t;
+		pv->where[t->id] = 0;
+		pv->ctxkey ^= t->hash;
+	}
+}
+
+int assume(struct prover *pv, struct term *t, struct deriv *d)
+{
+	if (lookup(pv, t))
+		return 0;
+	enter(pv, t, d);
+	return 1;
+}
+
+/* Whether this search should give up: out of steps, or a sibling of an
+ * enclosing forked alternative has succeeded. */
+int stopped(struct prover *pv)
+{
+	if (atomic_load_explicit(&pv->sh->aborted, memory_order_relaxed))
+		return 1;
+	if (pv->sh->cancel && atomic_load(pv->sh->cancel))
+		return 1;
+	for (struct group *g = pv->group; g; g = g->parent) {
+		if (atomic_load_explicit(&g->solved, memory_order_relaxed))
+			return 1;
+	}
+	return 0;
+}
+
+static size_t memo_slot(struct prover *pv, struct term *goal)
+{
+	uint64_t h = (pv->ctxkey ^ goal->hash) * 0x100000001b3ULL;
+	return (h ^ h >> 32) & (MEMO_SIZE - 1);
+}
+
+static pthread_mutex_t *stripe(struct prover *pv, size_t slot)
+{
+	return &pv->sh->stripes[slot % MEMO_STRIPES];
+}
+
+/* A memoized result for goal in this context: NULL, a proof, or fail if
+ * the goal failed with at least depth left. */
+struct deriv *recall(struct prover *pv, struct term *goal, int depth,
+		     int *failed)
+{
+	size_t slot = memo_slot(pv, goal);
+	struct memo *m = &pv->sh->memo[slot];
+	struct deriv *d = NULL;
+
+	*failed = 0;
+	pthread_mutex_lock(stripe(pv, slot));
+	if (m->goal == goal && m->ctx == pv->ctxkey) {
+		d = m->proof;
+		*failed = !d && m->depth >= depth;
+	}
+	pthread_mutex_unlock(stripe(pv, slot));
+	return d;
+}
+
+void memoize(struct prover *pv, struct term *goal, int depth,
+	     struct deriv *proof)
+{
+	size_t slot = memo_slot(pv, goal);
+	struct memo *m = &pv->sh->memo[slot];
+
+	pthread_mutex_lock(stripe(pv, slot));
+	m->goal = goal;
+	m->ctx = pv->ctxkey;
+	m->depth = depth;
+	m->proof = proof;
+	pthread_mutex_unlock(stripe(pv, slot));
+}
+
+struct scope {
+	struct term *hyp;
+	struct scope *up;
+};
+
+/*
+ * A derivation memoized in another context with the same formulas, with
+ * its references to that context replaced by the ones of this context.
+ * Assumptions of boxes inside the derivation are kept.
+ */
+static struct deriv *rebase(struct prover *pv, struct deriv *d,
+			    struct scope *sc)
+{
+	struct scope inner;
+	struct deriv *r, *in;
+
+	if (d->rule == HYP) {
+		for (; sc; sc = sc->up) {
+			if (sc->hyp == d->form)
+				return d;
+		}
+		return lookup(pv, d->form);
+	}
+
+	r = mk(pv, d->rule, d->form);
+	for (int i = 0; i < d->nin; i++) {
+		switch (d->in[i].type) {
+		case INPUT_LINE:
+			if (!(in = rebase(pv, d->in[i].d, sc)))
+				return NULL;
+			line_in(r, in);
+			break;
+		case INPUT_BOX:
+			inner.hyp = d->in[i].hyp;
+			inner.up = sc;
+			if (!(in = rebase(pv, d->in[i].d, &inner)))
+				return NULL;
+			box_in(r, inner.hyp, in);
+			break;
+		case INPUT_FORM:
+			form_in(r, d->in[i].form);
+			break;
+		}
+	}
+	return r;
+}
+
+static struct deriv *search(struct prover *pv, struct term *goal, int depth);
+
+/* Proves goal in a box opened with hyp. */
+static struct deriv *hypothetical(struct prover *pv, struct term *hyp,
+				  struct term *goal, int depth)
+{
+	struct deriv *d;
+	int n;
+
+	n = push(pv, hyp, mk(pv, HYP, hyp));
+	d = search(pv, goal, depth);
+	pop(pv, n);
+	return d;
+}
+
+static struct deriv *intro_box(struct prover *pv, int rule, struct term *form,
+			       struct term *hyp, struct term *goal, int depth)
+{
+	struct deriv *body, *d;
+
+	body = hypothetical(pv, hyp, goal, depth);
+	if (!body)
+		return NULL;
+	d = mk(pv, rule, form);
+	box_in(d, hyp, body);
+	return d;
+}
+
+static struct deriv *or_elim(struct prover *pv, int i, struct term *goal,
+			     int depth)
+{
+	struct term *t = pv->ctx[i].t;
+	struct deriv *in = pv->ctx[i].d, *b1, *b2, *d;
+
+	if (!(b1 = hypothetical(pv, t->lhs, goal, depth))
+	    || !(b2 = hypothetical(pv, t->rhs, goal, depth)))
+		return NULL;
+	d = mk(pv, RULE_OR_ELIM, goal);
+	line_in(d, in);
+	box_in(d, t->lhs, b1);
+	box_in(d, t->rhs, b2);
+	return d;
+}
+
+/* The ways to prove a goal that may fail where another succeeds. */
+enum {
+	ALT_OR_INTR_1,
+	ALT_OR_INTR_2,
+	ALT_NOT_ELIM,
+	ALT_IMPL_ELIM,
+	ALT_CON_ELIM,
+	ALT_PBC,
+};
+
+struct alt {
+	int kind;
+	int i;
+};
+
+static int segment(struct prover *pv, int seg, struct term *g,
+		   struct alt *alts)
+{
+	struct term *t;
+	int n = 0;
+
+	switch (seg) {
+	case SEG_INTRO:
+		if (g->type == FORM_OR) {
+			alts[n++].kind = ALT_OR_INTR_1;
+			alts[n++].kind = ALT_OR_INTR_2;
+		}
+		break;
+	case SEG_NOT_ELIM:
+		for (int i = 0; i < pv->nctx && g == pv->sh->bot; i++) {
+			t = pv->ctx[i].t;
+			if (t->type == FORM_NOT) {
+				alts[n].kind = ALT_NOT_ELIM;
+				alts[n++].i = i;
+			}
+		}
+		break;
+	case SEG_IMPL_ELIM:
+		for (int i = 0; i < pv->nctx; i++) {
+			t = pv->ctx[i].t;
+			if (t->type == FORM_IMPL && !lookup(pv, t->rhs)) {
+				alts[n].kind = ALT_IMPL_ELIM;
+				alts[n++].i = i;
+			}
+		}
+		break;
+	case SEG_CLASSICAL:
+		if (g != pv->sh->bot) {
+			alts[n++].kind = ALT_CON_ELIM;
+			alts[n++].kind = ALT_PBC;
+		}
+		break;
+	}
+	return n;
+}
+
+static int alternatives(struct prover *pv, struct term *g, struct alt *alts)
+{
+	int n = 0;
+
+	for (int i = 0; i < NSEGS; i++)
+		n += segment(pv, pv->sh->strat->order[i], g, alts + n);
+	return n;
+}
+
+static struct deriv *try_alt(struct prover *pv, struct term *g, int depth,
+			     struct alt *alt)
+{
+	struct hyp h = { 0 };
+	struct deriv *a, *d;
+	int n;
+
+	/* a copy, the context may move while searching */
+	if (alt->kind == ALT_NOT_ELIM || alt->kind == ALT_IMPL_ELIM)
+		h = pv->ctx[alt->i];
+
+	switch (alt->kind) {
+	case ALT_OR_INTR_1:
+		if (!(a = search(pv, g->lhs, depth)))
+			return NULL;
+		d = elim1(pv, RULE_OR_INTR_1, g, a);
+		form_in(d, g->rhs);
+		return d;
+	case ALT_OR_INTR_2:
+		if (!(a = search(pv, g->rhs, depth)))
+			return NULL;
+		d = mk(pv, RULE_OR_INTR_2, g);
+		form_in(d, g->lhs);
+		line_in(d, a);
+		return d;
+	case ALT_NOT_ELIM:
+		if (!(a = search(pv, h.t->lhs, depth)))
+			return NULL;
+		return elim2(pv, RULE_NOT_ELIM, g, a, h.d);
+	case ALT_IMPL_ELIM:
+		if (!(a = search(pv, h.t->lhs, depth)))
+			return NULL;
+		n = push(pv, h.t->rhs,
+			 elim2(pv, RULE_IMPL_ELIM, h.t->rhs, a, h.d));
+		d = search(pv, g, depth);
+		pop(pv, n);
+		return d;
+	case ALT_CON_ELIM:
+		if (!(a = search(pv, pv->sh->bot, depth)))
+			return NULL;
+		d = elim1(pv, RULE_CON_ELIM, g, a);
+		form_in(d, g);
+		return d;
+	case ALT_PBC:
+		return intro_box(pv, RULE_PBC, g, neg(pv, g), pv->sh->bot,
+				 depth);
+	}
+	return NULL;
+}
+
+/* Alternatives forked onto the pool, sharing a copy of the context. */
+struct fork {
+	struct group group;
+	struct shared *sh;
+	struct hyp *ctx;
+	int nctx;
+	struct term *goal;
+	int depth;
+};
+
+struct branch {
+	struct job job;
+	struct fork *fork;
+	struct alt alt;
+	struct deriv *result;
+};
+
+static void run_branch(struct job *job, int worker)
+{
+	struct branch *b = (struct branch *)((char *)job
+					     - offsetof(struct branch, job));
+	struct fork *f = b->fork;
+	struct prover pv = { 0 };
+
+	b->result = NULL;
+	if (atomic_load(&f->group.solved))
+		return;
+
+	pv.sh = f->sh;
+	pv.worker = worker;
+	pv.group = &f->group;
+	pv.sem = worker_sem(f->sh, worker);
+	for (int i = 0; i < f->nctx; i++)
+		enter(&pv, f->ctx[i].t, f->ctx[i].d);
+
+	b->result = try_alt(&pv, f->goal, f->depth, &b->alt);
+	if (b->result)
+		atomic_store(&f->group.solved, 1);
+
+	free(pv.ctx);
+	free(pv.where);
+	free(pv.models);
+}
+
+/*
+ * Tries alts[1..] as jobs that idle workers may steal, and alts[0] here.
+ * Jobs left unstolen are taken back and tried here too, in order and in
+ * this context, rather than paying for a new one.
+ */
+static struct deriv *fork_alts(struct prover *pv, struct term *g, int depth,
+			       struct alt *alts, int nalts)
+{
+	struct fork f;
+	struct branch *b;
+	struct group *outer = pv->group;
+	struct deriv *d;
+	int stolen;
+
+	f.group.solved = 0;
+	f.group.parent = outer;
+	f.sh = pv->sh;
+	f.ctx = malloc(pv->nctx * sizeof(*f.ctx));
+	memcpy(f.ctx, pv->ctx, pv->nctx * sizeof(*f.ctx));
+	f.nctx = pv->nctx;
+	f.goal = g;
+	f.depth = depth;
+
+	b = calloc(nalts, sizeof(*b));
+	for (int i = 1; i < nalts; i++) {
+		b[i].job.run = run_branch;
+		b[i].fork = &f;
+		b[i].alt = alts[i];
+		pool_push(pv->sh->pool, pv->worker, &b[i].job);
+	}
+
+	pv->group = &f.group;
+	d = try_alt(pv, g, depth, &alts[0]);
+	if (d)
+		atomic_store(&f.group.solved, 1);
+
+	/* thieves take from the head, so the unstolen jobs are the last */
+	stolen = nalts;
+	while (stolen > 1
+	       && pool_cancel(pv->sh->pool, pv->worker, &b[stolen - 1].job))
+		stolen--;
+	for (int i = stolen; i < nalts && !d && !stopped(pv); i++) {
+		if ((d = try_alt(pv, g, depth, &alts[i])))
+			atomic_store(&f.group.solved, 1);
+	}
+	for (int i = stolen - 1; i >= 1; i--) {
+		pool_join(pv->sh->pool, pv->worker, &b[i].job);
+		if (!d && b[i].result)
+			d = b[i].result;
+	}
+	pv->group = outer;
+
+	free(b);
+	free(f.ctx);
+	return d;
+}
+
+/*
+ * Whether to fork the alternatives of a goal. Only worker 0 runs before
+ * the first fork, so it starts the pool.
+ */
+static int may_fork(struct prover *pv, int depth)
+{
+	struct shared *sh = pv->sh;
+	long steps = atomic_load_explicit(&sh->steps, memory_order_relaxed);
+
+	if (sh->jobs < 2 || depth < FORK_DEPTH
+	    || sh->limit - depth > FORK_LEVELS || steps < FORK_STEPS
+	    || sh->max_steps - steps < FORK_STEPS)
+		return 0;
+	if (!sh->pool)
+		sh->pool = pool_new(sh->jobs);
+	return pool_idle(sh->pool);
+}
+
+static struct deriv *expand(struct prover *pv, struct term *g, int depth)
+{
+	struct alt buf[32], *alts;
+	struct deriv *a, *b, *d = NULL;
+	struct term *t;
+	int n;
+
+	/* introductions that lose nothing */
+	switch (g->type) {
+	case FORM_AND:
+		if (!(a = search(pv, g->lhs, depth))
+		    || !(b = search(pv, g->rhs, depth)))
+			return NULL;
+		return elim2(pv, RULE_AND_INTR, g, a, b);
+	case FORM_IMPL:
+		return intro_box(pv, RULE_IMPL_INTR, g, g->lhs, g->rhs, depth);
+	case FORM_NOT:
+		return intro_box(pv, RULE_NOT_INTR, g, g->lhs, pv->sh->bot,
+				 depth);
+	}
+
+	/* so does splitting a disjunction */
+	for (int i = 0; i < pv->nctx; i++) {
+		t = pv->ctx[i].t;
+		if (t->type == FORM_OR && !lookup(pv, t->lhs)
+		    && !lookup(pv, t->rhs))
+			return or_elim(pv, i, g, depth);
+	}
+
+	alts = 2 * pv->nctx + 4 <= 32 ? buf
+	    : malloc((2 * pv->nctx + 4) * sizeof(*alts));
+	n = alternatives(pv, g, alts);
+
+	if (n > 1 && may_fork(pv, depth)) {
+		d = fork_alts(pv, g, depth, alts, n);
+	} else {
+		for (int i = 0; i < n && !d && !stopped(pv); i++)
+			d = try_alt(pv, g, depth, &alts[i]);
+	}
+
+	if (alts != buf)
+		free(alts);
+	return d;
+}
+
+/* Counts a search step, giving up when out of steps or time. */
+int tick(struct prover *pv)
+{
+	if (atomic_fetch_add_explicit(&pv->sh->steps, 1, memory_order_relaxed)
+	    >= pv->sh->max_steps) {
+		atomic_store(&pv->sh->aborted, 1);
+		return 0;
+	}
+	if (pv->sh->deadline && !(pv->sh->steps % 1024)
+	    && now_ms() > pv->sh->deadline) {
+		atomic_store(&pv->sh->timedout, 1);
+		atomic_store(&pv->sh->aborted, 1);
+		return 0;
+	}
+	return 1;
+}
+
+/* Whether some model of the context makes goal false, so that it
+ * cannot be proved there. */
+static int refuted(struct prover *pv, struct term *goal)
+{
+	if (!pv->sem || !sem_refutes(pv->sem, models(pv, pv->nctx), goal))
+		return 0;
+	atomic_fetch_add_explicit(&pv->sh->pruned, 1, memory_order_relaxed);
+	return 1;
+}
+
+static struct deriv *search(struct prover *pv, struct term *goal, int depth)
+{
+	struct deriv *d;
+	int failed;
+
+	if ((d = lookup(pv, goal)))
+		return d;
+	if (!depth || stopped(pv) || !tick(pv) || refuted(pv, goal))
+		return NULL;
+
+	d = recall(pv, goal, depth, &failed);
+	if (failed)
+		return NULL;
+	if (d && (d = rebase(pv, d, NULL)))
+		return d;
+
+	d = expand(pv, goal, depth - 1);
+	if (d)
+		memoize(pv, goal, depth, d);
+	else if (!stopped(pv))
+		memoize(pv, goal, depth, NULL);
+	return d;
+}
+
+/*
+ * Searching for a proof with the fewest lines. The bound is on the lines
+ * a derivation takes instead of its depth, and it is raised one line at a
+ * time, so the first proof found is a shortest one. Within a bound every
+ * alternative is tried, each bounded by the cheapest proof so far. The
+ * memo holds the cheapest proof of a goal or the bound it failed under.
+ * Derived rules MT, --i and LEM are used where they save lines.
+ */
+
+struct best {
+	struct deriv *d;
+	int bound;
+};
+
+static void consider(struct best *b, struct deriv *d)
+{
+	if (d && d->cost <= b->bound) {
+		b->d = d;
+		b->bound = d->cost - 1;
+	}
+}
+
+/* A lower bound on the lines a proof of t takes. */
+static int least(struct prover *pv, struct term *t)
+{
+	struct deriv *d = lookup(pv, t);
+	return d && !d->cost ? 0 : 1;
+}
+
+static struct deriv *shortest(struct prover *pv, struct term *goal,
+			      int bound);
+
+/* The body of a box opened with hyp and ending with goal, if the box
+ * takes at most bound lines. */
+static struct deriv *short_box(struct prover *pv, struct term *hyp,
+			       struct term *goal, int bound)
+{
+	struct deriv *d;
+	int n;
+
+	if (bound < 2)
+		return NULL;
+	n = push(pv, hyp, mk(pv, HYP, hyp));
+	d = shortest(pv, goal, bound - 1);
+	pop(pv, n);
+	return d && box_cost(d) <= bound ? d : NULL;
+}
+
+struct deriv *boxed(struct prover *pv, int rule, struct term *form,
+		    struct term *hyp, struct deriv *body)
+{
+	struct deriv *d;
+
+	if (!body)
+		return NULL;
+	d = mk(pv, rule, form);
+	box_in(d, hyp, body);
+	return d;
+}
+
+static void short_intro(struct prover *pv, struct term *g, struct best *b)
+{
+	struct deriv *a, *c, *d;
+	struct term *t;
+
+	switch (g->type) {
+	case FORM_AND:
+		a = shortest(pv, g->lhs, b->bound - 1 - least(pv, g->rhs));
+		if (a && (c = shortest(pv, g->rhs, b->bound - 1 - a->cost)))
+			consider(b, elim2(pv, RULE_AND_INTR, g, a, c));
+		break;
+	case FORM_IMPL:
+		consider(b, boxed(pv, RULE_IMPL_INTR, g, g->lhs,
+				  short_box(pv, g->lhs, g->rhs, b->bound - 1)));
+		break;
+	case FORM_NOT:
+		consider(b, boxed(pv, RULE_NOT_INTR, g, g->lhs,
+				  short_box(pv, g->lhs, pv->sh->bot,
+					    b->bound - 1)));
+		if (g->lhs->type == FORM_NOT
+		    && (a = shortest(pv, g->lhs->lhs, b->bound - 1)))
+			consider(b, elim1(pv, RULE_NOT_NOT_INTR, g, a));
+		for (int i = 0; i < pv->nctx; i++) {
+			t = pv->ctx[i].t;
+			d = pv->ctx[i].d;
+			if (t->type != FORM_IMPL || t->lhs != g->lhs)
+				continue;
+			a = shortest(pv, neg(pv, t->rhs),
+				     b->bound - 1 - d->cost);
+			if (a)
+				consider(b, elim2(pv, RULE_MT, g, d, a));
+		}
+		break;
+	case FORM_OR:
+		if (g->rhs == neg(pv, g->lhs) && !pv->sh->intuitionistic) {
+			d = mk(pv, RULE_LEM, g);
+			form_in(d, g->lhs);
+			consider(b, d);
+		}
+		if ((a = shortest(pv, g->lhs, b->bound - 1))) {
+			d = elim1(pv, RULE_OR_INTR_1, g, a);
+			form_in(d, g->rhs);
+			consider(b, d);
+		}
+		if ((a = shortest(pv, g->rhs, b->bound - 1))) {
+			d = mk(pv, RULE_OR_INTR_2, g);
+			form_in(d, g->lhs);
+			line_in(d, a);
+			consider(b, d);
+		}
+		break;
+	}
+}
+
+static void short_elim(struct prover *pv, struct term *g, struct best *b)
+{
+	struct deriv *a, *c, *d, *e;
+	struct hyp h;
+	int n;
+
+	for (int i = 0; i < pv->nctx && !stopped(pv); i++) {
+		h = pv->ctx[i];
+		d = h.d;
+		switch (h.t->type) {
+		case FORM_NOT:
+			if (g != pv->sh->bot)
+				break;
+			a = shortest(pv, h.t->lhs, b->bound - 1 - d->cost);
+			if (a)
+				consider(b, elim2(pv, RULE_NOT_ELIM, g, a, d));
+			break;
+		case FORM_IMPL:
+			if (lookup(pv, h.t->rhs))
+				break;
+			a = shortest(pv, h.t->lhs, b->bound - 1 - d->cost);
+			if (!a)
+				break;
+			n = push(pv, h.t->rhs, elim2(pv, RULE_IMPL_ELIM,
+						     h.t->rhs, a, d));
+			consider(b, shortest(pv, g, b->bound));
+			pop(pv, n);
+			break;
+		case FORM_OR:
+			if (lookup(pv, h.t->lhs) || lookup(pv, h.t->rhs))
+				break;
+			a = short_box(pv, h.t->lhs, g, b->bound - 3 - d->cost);
+			if (!a)
+				break;
+			c = short_box(pv, h.t->rhs, g, b->bound - 1 - d->cost
+				      - box_cost(a));
+			if (!c)
+				break;
+			e = mk(pv, RULE_OR_ELIM, g);
+			line_in(e, d);
+			box_in(e, h.t->lhs, a);
+			box_in(e, h.t->rhs, c);
+			consider(b, e);
+			break;
+		}
+	}
+}
+
+static struct deriv *short_expand(struct prover *pv, struct term *g,
+				  int bound)
+{
+	struct best b = { NULL, bound };
+	struct deriv *a, *d;
+
+	short_intro(pv, g, &b);
+	short_elim(pv, g, &b);
+
+	if (g != pv->sh->bot) {
+		if ((a = shortest(pv, pv->sh->bot, b.bound - 1))) {
+			d = elim1(pv, RULE_CON_ELIM, g, a);
+			form_in(d, g);
+			consider(&b, d);
+		}
+		if (!pv->sh->intuitionistic)
+			consider(&b, boxed(pv, RULE_PBC, g, neg(pv, g),
+					   short_box(pv, neg(pv, g),
+						     pv->sh->bot,
+						     b.bound - 1)));
+	}
+	return b.d;
+}
+
+static struct deriv *shortest(struct prover *pv, struct term *goal,
+			      int bound)
+{
+	struct deriv *d;
+	int failed;
+
+	if ((d = lookup(pv, goal)))
+		return d->cost <= bound ? d : NULL;
+	if (bound < 1 || stopped(pv) || !tick(pv) || refuted(pv, goal))
+		return NULL;
+
+	d = recall(pv, goal, bound, &failed);
+	if (failed)
+		return NULL;
+	if (d && (d = rebase(pv, d, NULL)) && d->cost <= bound)
+		return d;
+
+	d = short_expand(pv, goal, bound);
+	if (d)
+		memoize(pv, goal, bound, d);
+	else if (!stopped(pv))
+		memoize(pv, goal, bound, NULL);
+	return d;
+}
+
+/* Turning a derivation into commands. */
+
+struct vis {
+	struct term *t;
+	int line;
+};
+
+struct emitter {
+	struct cmdlist *out;
+	struct vis *vis;
+	int nvis;
+	int viscap;
+	int nlines;
+};
+
+static void addcmd(struct cmdlist *l, char *cmd)
+{
+	if (l->n == l->cap) {
+		l->cap = l->cap ? 2 * l->cap : 32;
+		l->cmds = realloc(l->cmds, l->cap * sizeof(*l->cmds));
+	}
+	l->cmds[l->n++] = cmd;
+}
+
+static void addvis(struct emitter *e, struct term *t, int line)
+{
+	if (e->nvis == e->viscap) {
+		e->viscap = e->viscap ? 2 * e->viscap : 64;
+		e->vis = realloc(e->vis, e->viscap * sizeof(*e->vis));
+	}
+	e->vis[e->nvis].t = t;
+	e->vis[e->nvis++].line = line;
+}
+
+static int visible(struct emitter *e, struct term *t)
+{
+	for (int i = e->nvis - 1; i >= 0; i--) {
+		if (e->vis[i].t == t)
+			return e->vis[i].line;
+	}
+	return -1;
+}
+
+/* Emits a command that adds a line. */
+static int emitln(struct emitter *e, struct term *t, char *cmd)
+{
+	addcmd(e->out, cmd);
+	addvis(e, t, e->nlines);
+	return e->nlines++;
+}
+
+static char *fmt_term(const char *fmt, struct term *t)
+{
+	char *str, *cmd;
+	FILE *f;
+	size_t len;
+
+	str = term_str(t);
+	f = open_memstream(&cmd, &len);
+	fprintf(f, fmt, str);
+	fclose(f);
+	free(str);
+	return cmd;
+}
+
+static char *copy_cmd(int line)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "apply copy %d", line + 1);
+	return strdup(buf);
+}
+
+static int emit(struct emitter *e, struct deriv *d);
+
+static int emit_box(struct emitter *e, struct din *in, int *start, int *end)
+{
+	int mark = e->nvis, last;
+
+	addcmd(e->out, strdup("open"));
+	*start = emitln(e, in->hyp, fmt_term("assume %s", in->hyp));
+
+	last = emit(e, in->d);
+	if (last < 0)
+		return 0;
+	/* a box has to end with its conclusion, on a line of its own */
+	if (last != e->nlines - 1 || last == *start)
+		last = emitln(e, in->d->form, copy_cmd(last));
+	*end = last;
+
+	addcmd(e->out, strdup("close"));
+	e->nvis = mark;
+	return 1;
+}
+
+static int emit(struct emitter *e, struct deriv *d)
+{
+	int start[3], end[3];
+	char *cmd, *str;
+	size_t len;
+	FILE *f;
+	int line;
+
+	if ((line = visible(e, d->form)) >= 0)
+		return line;
+	if (d->rule == HYP)
+		return -1;
+	if (d->rule == SEQ) {
+		for (int i = 0; i < d->nin; i++) {
+			if ((line = emit(e, d->in[i].d)) < 0)
+				return -1;
+		}
+		return line;
+	}
+
+	for (int i = 0; i < d->nin; i++) {
+		switch (d->in[i].type) {
+		case INPUT_LINE:
+			if ((start[i] = emit(e, d->in[i].d)) < 0)
+				return -1;
+			break;
+		case INPUT_BOX:
+			if (!emit_box(e, &d->in[i], &start[i], &end[i]))
+				return -1;
+			break;
+		}
+	}
+
+	f = open_memstream(&cmd, &len);
+	fprintf(f, "apply %s", rulestr(d->rule));
+	for (int i = 0; i < d->nin; i++) {
+		fputs(i ? ", " : " ", f);
+		switch (d->in[i].type) {
+		case INPUT_LINE:
+			fprintf(f, "%d", start[i] + 1);
+			break;
+		case INPUT_BOX:
+			fprintf(f, "%d-%d", start[i] + 1, end[i] + 1);
+			break;
+		case INPUT_FORM:
+			str = term_str(d->in[i].form);
+			fputs(str, f);
+			free(str);
+			break;
+		}
+	}
+	fclose(f);
+
+	return emitln(e, d->form, cmd);
+}
+
+void cmdlist_free(struct cmdlist *l)
+{
+	for (int i = 0; i < l->n; i++)
+		free(l->cmds[i]);
+	free(l->cmds);
+	memset(l, 0, sizeof(*l));
+}
+
+/* Emits a proof of g by rule, its box assuming hyp and holding the
+ * steps in order, the last deriving _|_. Returns the lines added or -1. */
+int emit_refutation(struct emitter *base, int rule, struct term *g,
+		    struct term *hyp, struct deriv **steps, int n,
+		    struct cmdlist *out)
+{
+	struct emitter e = *base;
+	int start, last = -1;
+	char buf[64];
+
+	e.out = out;
+	e.vis = malloc(e.viscap * sizeof(*e.vis));
+	if (e.nvis)
+		memcpy(e.vis, base->vis, e.nvis * sizeof(*e.vis));
+
+	addcmd(out, strdup("open"));
+	start = emitln(&e, hyp, fmt_term("assume %s", hyp));
+	for (int i = 0; i < n && (i == 0 || last >= 0); i++)
+		last = emit(&e, steps[i]);
+	if (last >= 0) {
+		if (last != e.nlines - 1 || last == start)
+			last = emitln(&e, steps[n - 1]->form, copy_cmd(last));
+		addcmd(out, strdup("close"));
+		snprintf(buf, sizeof(buf), "apply %s %d-%d", rulestr(rule),
+			 start + 1, last + 1);
+		emitln(&e, g, strdup(buf));
+	}
+	free(e.vis);
+	if (last < 0) {
+		cmdlist_free(out);
+		return -1;
+	}
+	return e.nlines - base->nlines;
+}
+
+static void destroy_shared(struct shared *sh)
+{
+	for (int w = 0; w < MAX_WORKERS; w++) {
+		for (int i = 0; i < sh->arenas[w].nchunks; i++)
+			free(sh->arenas[w].chunks[i]);
+		free(sh->arenas[w].chunks);
+	}
+	for (int i = 0; i < MEMO_STRIPES; i++)
+		pthread_mutex_destroy(&sh->stripes[i]);
+	for (int w = 0; w < MAX_WORKERS; w++)
+		sem_destroy(sh->sems[w]);
+	free(sh->atoms);
+	if (sh->pool)
+		pool_destroy(sh->pool);
+	free(sh->memo);
+	terms_destroy(sh->terms);
+	free(sh);
+}
+
+/* One search for a proof of goal, run in a thread of its own by a
+ * portfolio. */
+struct attempt {
+	pthread_t thread;
+	const struct strategy *strat;
+	struct proof *p;
+	struct ast *goal;
+	const struct prove_opts *opts;
+	long deadline;
+	atomic_int *cancel;
+	atomic_int *winner;
+	struct cmdlist out;
+	char errbuf[256];
+	int ok;
+};
+
+/* Emits a proof of g, returning the number of lines it adds or -1. */
+static int emit_proof(struct emitter *base, struct term *g, struct deriv *d,
+		      struct cmdlist *out)
+{
+	struct emitter e = *base;
+	int line;
+
+	e.out = out;
+	e.vis = malloc(e.viscap * sizeof(*e.vis));
+	if (e.nvis)
+		memcpy(e.vis, base->vis, e.nvis * sizeof(*e.vis));
+
+	line = emit(&e, d);
+	if (line >= 0 && line < base->nlines)
+		line = emitln(&e, g, copy_cmd(line));
+	free(e.vis);
+	if (line < 0) {
+		cmdlist_free(out);
+		return -1;
+	}
+	return e.nlines - base->nlines;
+}
+
+/* A proof of g with fewer lines than d, or NULL. */
+static struct deriv *shorten(struct prover *pv, struct term *g,
+			     struct deriv *d)
+{
+	struct shared *sh = pv->sh;
+	struct deriv *s = NULL;
+
+	/* the memo holds bounds on depth so far */
+	memset(sh->memo, 0, MEMO_SIZE * sizeof(*sh->memo));
+	sh->steps = 0;
+	for (int bound = least(pv, g); bound < d->cost && !s && !sh->aborted;
+	     bound++)
+		s = shortest(pv, g, bound);
+
+	/* out of steps or time, d is still a proof */
+	sh->aborted = 0;
+	sh->timedout = 0;
+	return s;
+}
+
+/* Collects the atoms of t not seen yet. */
+static void add_atoms(struct shared *sh, struct term *t, char *seen)
+{
+	if (!t || seen[t->id])
+		return;
+	seen[t->id] = 1;
+	if (t->type == FORM_NAME) {
+		sh->atoms = realloc(sh->atoms, (sh->natoms + 1)
+				    * sizeof(*sh->atoms));
+		sh->atoms[sh->natoms++] = t;
+	}
+	add_atoms(sh, t->lhs, seen);
+	add_atoms(sh, t->rhs, seen);
+}
+
+static int search_proof(struct attempt *a)
+{
+	struct shared *sh;
+	struct prover pv = { 0 };
+	struct emitter e = { 0 };
+	struct cmdlist cl = { 0 };
+	struct deriv *d = NULL, *s = NULL;
+	struct term *g, **forms;
+	struct proof *p = a->p;
+	int *lines, n, depth, len;
+	char *seen, *model = NULL;
+	long steps;
+
+	sh = calloc(1, sizeof(*sh));
+	sh->terms = terms_new();
+	sh->bot = term_make(sh->terms, FORM_CON, NULL, NULL);
+	sh->memo = calloc(MEMO_SIZE, sizeof(*sh->memo));
+	sh->strat = a->strat;
+	sh->max_steps = a->opts->max_steps;
+	sh->deadline = a->deadline;
+	sh->cancel = a->cancel;
+	sh->intuitionistic = a->opts->intuitionistic;
+	sh->prune = !a->opts->no_prune;
+	for (int i = 0; i < MEMO_STRIPES; i++)
+		pthread_mutex_init(&sh->stripes[i], NULL);
+	sh->jobs = a->opts->jobs < MAX_WORKERS ? a->opts->jobs : MAX_WORKERS;
+	pv.sh = sh;
+	e.out = &a->out;
+	e.nlines = p->nlns;
+
+	lines = malloc((p->idx.nents + 1) * sizeof(*lines));
+	n = index_lines(p, -1, lines, p->idx.nents);
+	forms = malloc((n + 1) * sizeof(*forms));
+	for (int i = 0; i < n; i++)
+		forms[i] = term_from_ast(sh->terms, p->lns[lines[i]].form);
+	g = term_from_ast(sh->terms, a->goal);
+	seen = calloc(terms_count(sh->terms), 1);
+	for (int i = 0; i < n; i++)
+		add_atoms(sh, forms[i], seen);
+	add_atoms(sh, g, seen);
+	free(seen);
+
+	pv.sem = worker_sem(sh, 0);
+	for (int i = n - 1; i >= 0; i--) {
+		if (sh->intuitionistic)
+			assume(&pv, forms[i], mk(&pv, HYP, forms[i]));
+		else
+			push(&pv, forms[i], mk(&pv, HYP, forms[i]));
+		addvis(&e, forms[i], lines[i]);
+	}
+	free(lines);
+
+	/* a countermodel of the goal itself ends the search at once */
+	if (pv.sem)
+		model = sem_model(pv.sem, models(&pv, pv.nctx), g);
+	if (a->opts->resolution && !sh->intuitionistic && !model) {
+		len = refute(&pv, &e, forms, n, g, a->opts, &a->out,
+			     a->errbuf, sizeof(a->errbuf));
+		free(forms);
+		free(pv.ctx);
+		free(pv.where);
+		free(pv.models);
+		destroy_shared(sh);
+		free(e.vis);
+		return len >= 0;
+	}
+	if (a->opts->tableau && !sh->intuitionistic && !model)
+		d = tableau(&pv, forms, n, g, &model);
+	free(forms);
+	/* G4ip hides formulas, which the models do not follow */
+	if (sh->intuitionistic)
+		pv.sem = NULL;
+
+	depth = a->strat->deep ? a->opts->max_depth : 1;
+	if (sh->intuitionistic && !model)
+		d = g4(&pv, g);
+	for (; depth <= a->opts->max_depth && !d && !sh->aborted
+	     && !sh->intuitionistic && !model; depth++) {
+		sh->limit = depth;
+		d = search(&pv, g, depth);
+	}
+	steps = sh->steps;
+	if (d && a->opts->minimal && !a->opts->tableau) {
+		s = shorten(&pv, g, d);
+		steps += sh->steps;
+	}
+	ndelog("prove: %s, %ld steps, %ld pruned\n",
+	       a->opts->tableau ? "tableau" : a->strat->name, steps,
+	       (long)sh->pruned);
+	free(pv.ctx);
+	free(pv.where);
+	free(pv.models);
+
+	if (!d) {
+		if (model)
+			snprintf(a->errbuf, sizeof(a->errbuf),
+				 "not a consequence of the lines in scope, "
+				 "false when %s", model);
+		else if (sh->timedout)
+			snprintf(a->errbuf, sizeof(a->errbuf),
+				 "no proof found within %ld ms",
+				 a->opts->max_time_ms);
+		else if (sh->aborted)
+			snprintf(a->errbuf, sizeof(a->errbuf),
+				 "no proof found within %ld steps",
+				 a->opts->max_steps);
+		else if (sh->intuitionistic)
+			snprintf(a->errbuf, sizeof(a->errbuf),
+				 "not provable intuitionistically from the "
+				 "lines in scope");
+		else
+			snprintf(a->errbuf, sizeof(a->errbuf),
+				 "no proof found within depth %d",
+				 a->opts->max_depth);
+		destroy_shared(sh);
+		free(e.vis);
+		free(model);
+		return 0;
+	}
+
+	/* the line count of d may be less than its cost, lines are shared */
+	len = emit_proof(&e, g, d, &a->out);
+	if (s && (n = emit_proof(&e, g, s, &cl)) >= 0) {
+		if (len < 0 || n < len) {
+			cmdlist_free(&a->out);
+			a->out = cl;
+			len = n;
+		} else {
+			cmdlist_free(&cl);
+		}
+	}
+	if (len < 0)
+		snprintf(a->errbuf, sizeof(a->errbuf),
+			 "internal error in proof search");
+
+	destroy_shared(sh);
+	free(e.vis);
+	return len >= 0;
+}
+
+/*
+ * Whether the commands apply after the lines of p. They are run on a
+ * copy with the same line numbers, where the lines out of scope at the
+ * end of p are each closed in a box of their own.
+ */
+static int replays(struct proof *p, struct cmdlist *cl, char *errbuf,
+		   size_t errbufsz)
+{
+	struct verdict v;
+	struct proof q;
+	struct ast *cmd;
+	int ok = 1;
+
+	q = new_proof();
+	for (int i = 0; i < p->nlns && ok; i++) {
+		cmd = calloc(1, sizeof(*cmd));
+		cmd->type = CMD_PRESUME;
+		cmd->lhs = ast_copy(p->lns[i].form);
+		if (can_ref_ln(p, i)) {
+			ok = pushln(&q, cmd, cmd->lhs);
+		} else {
+			ok = push_box(&q) && pushln(&q, cmd, cmd->lhs);
+			pop_box(&q);
+		}
+		pushcmd(&q, cmd);
+	}
+
+	if (ok && !check_cmds(&q, cl->cmds, cl->n, &v)) {
+		snprintf(errbuf, errbufsz, "%d: %s", v.line, v.msg);
+		ok = 0;
+	}
+	destroy_proof(&q);
+	return ok;
+}
+
+static void *run_attempt(void *arg)
+{
+	struct attempt *a = arg;
+	int none = -1;
+
+	a->ok = search_proof(a) && replays(a->p, &a->out, a->errbuf,
+					   sizeof(a->errbuf));
+	if (a->ok && atomic_compare_exchange_strong(a->winner, &none,
+						     a->strat - strategies))
+		atomic_store(a->cancel, 1);
+	return NULL;
+}
+
+/* Races every strategy, the first proof that replays is kept. */
+static int portfolio(struct attempt *base, struct cmdlist *out,
+		     char *errbuf, size_t errbufsz)
+{
+	struct attempt a[NSTRATEGIES];
+	atomic_int cancel = 0, winner = -1;
+	long start = now_ms();
+	int w;
+
+	for (int i = 0; i < NSTRATEGIES; i++) {
+		a[i] = *base;
+		a[i].strat = &strategies[i];
+		a[i].cancel = &cancel;
+		a[i].winner = &winner;
+		pthread_create(&a[i].thread, NULL, run_attempt, &a[i]);
+	}
+	for (int i = 0; i < NSTRATEGIES; i++)
+		pthread_join(a[i].thread, NULL);
+
+	w = atomic_load(&winner);
+	for (int i = 0; i < NSTRATEGIES; i++) {
+		if (i == w)
+			*out = a[i].out;
+		else
+			cmdlist_free(&a[i].out);
+	}
+
+	if (w < 0) {
+		/* the reason the default strategy gave up */
+		snprintf(errbuf, errbufsz, "%s", a[0].errbuf);
+		ndelog("portfolio: no proof in %ld ms\n", now_ms() - start);
+		return 0;
+	}
+
+	wins[w]++;
+	ndelog("portfolio: %s won in %ld ms, wins:", strategies[w].name,
+	       now_ms() - start);
+	for (int i = 0; i < NSTRATEGIES; i++)
+		ndelog(" %s %ld", strategies[i].name, wins[i]);
+	ndelog("\n");
+	return 1;
+}
+
+/*
+ * Finds commands that extend p with a line holding goal, using the lines
+ * in scope at the end of p. The commands are not applied.
+ */
+int prove(struct proof *p, struct ast *goal, const struct prove_opts *opts,
+	  struct cmdlist *out, char *errbuf, size_t errbufsz)
+{
+	struct prove_opts defaults = { PROVE_MAX_DEPTH, PROVE_MAX_STEPS, 1,
+		PROVE_MAX_TIME, 0, 0, 0, 0, 0, 0 };
+	struct attempt a = { 0 };
+
+	if (!opts)
+		opts = &defaults;
+
+	a.strat = &strategies[0];
+	a.p = p;
+	a.goal = goal;
+	a.opts = opts;
+	a.deadline = opts->max_time_ms ? now_ms() + opts->max_time_ms : 0;
+
+	if (opts->portfolio && !opts->resolution && !opts->tableau)
+		return portfolio(&a, out, errbuf, errbufsz);
+
+	if (!search_proof(&a)) {
+		snprintf(errbuf, errbufsz, "%s", a.errbuf);
+		return 0;
+	}
+	*out = a.out;
+	return 1;
+}
+
+/* Returns a script proving the goal of spec from its premises, or NULL. */
+char *prove_spec(struct spec *spec, const struct prove_opts *opts,
+		 char *errbuf, size_t errbufsz)
+{
+	struct cmdlist cl = { 0 };
+	struct terms *terms;
+	struct proof p;
+	struct ast *cmd;
+	char *text = NULL, *str;
+	size_t len;
+	FILE *f;
+
+	p = new_proof();
+	f = open_memstream(&text, &len);
+	terms = terms_new();
+	for (int i = 0; i < spec->nprems; i++) {
+		cmd = calloc(1, sizeof(*cmd));
+		cmd->type = CMD_PRESUME;
+		cmd->lhs = ast_copy(spec->prems[i]);
+		pushln(&p, cmd, cmd->lhs);
+		pushcmd(&p, cmd);
+		str = term_str(term_from_ast(terms, cmd->lhs));
+		fprintf(f, "presume %s\n", str);
+		free(str);
+	}
+	terms_destroy(terms);
+
+	if (prove(&p, spec->goal, opts, &cl, errbuf, errbufsz)) {
+		for (int i = 0; i < cl.n; i++)
+			fprintf(f, "%s\n", cl.cmds[i]);
+	}
+	fclose(f);
+	destroy_proof(&p);
+
+	if (!cl.n) {
+		free(text);
+		return NULL;
+	}
+	cmdlist_free(&cl);
+	return text;
+}
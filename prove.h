@@ -0,0 +1,38 @@
+#ifndef PROVE_H
+#define PROVE_H
+
+#include <stddef.h>
+#include "proof.h"
+#include "spec.h"
+
+#define PROVE_MAX_DEPTH 16
+#define PROVE_MAX_STEPS (1L << 20)
+#define PROVE_MAX_TIME 10000
+
+struct prove_opts {
+	int max_depth;
+	long max_steps;
+	int jobs;
+	long max_time_ms;	/* zero meaning unlimited */
+	int portfolio;
+	int minimal;
+	int intuitionistic;
+	int no_prune;		/* expand goals with a countermodel */
+	int resolution;		/* refute the negated goal in CNF */
+	int tableau;		/* close a signed tableau */
+};
+
+/* Commands that extend a proof, one line of input each. */
+struct cmdlist {
+	char **cmds;
+	int n;
+	int cap;
+};
+
+int prove(struct proof *p, struct ast *goal, const struct prove_opts *opts,
+	  struct cmdlist *out, char *errbuf, size_t errbufsz);
+char *prove_spec(struct spec *spec, const struct prove_opts *opts,
+		 char *errbuf, size_t errbufsz);
+void cmdlist_free(struct cmdlist *l);
+
+#endif
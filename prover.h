@@ -0,0 +1,173 @@
+#ifndef PROVER_H
+#define PROVER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "parse.h"
+#include "term.h"
+
+/*
+ * The state of proof search, shared by the search and emitter in prove.c
+ * and the provers in g4.c, tableau.c and refute.c. Each of them builds a
+ * derivation in the arena of its worker, with formulas as terms of the
+ * search, and prove.c turns it into commands.
+ */
+
+struct cmdlist;
+struct emitter;
+struct memo;
+struct pool;
+struct sem;
+struct strategy;
+
+#define MEMO_STRIPES 64
+#define MAX_WORKERS 64
+
+/* A line of the proof, or an assumption of an enclosing box. */
+#define HYP (-1)
+/* Lines emitted in order, the last being the result. */
+#define SEQ (-2)
+
+struct din {
+	int type;
+	struct term *hyp;
+	struct term *form;
+	struct deriv *d;
+};
+
+struct deriv {
+	int rule;
+	struct term *form;
+	int cost;		/* lines, counting shared ones each time */
+	int nin;
+	struct din in[3];
+};
+
+struct hyp {
+	struct term *t;
+	struct deriv *d;
+	int hidden;
+};
+
+struct arena {
+	struct deriv **chunks;
+	int nchunks;
+	int n;
+};
+
+/* Search state shared by all workers. */
+struct shared {
+	struct terms *terms;
+	struct term *bot;
+	struct memo *memo;
+	pthread_mutex_t stripes[MEMO_STRIPES];
+	struct pool *pool;	/* started by the first fork */
+	int jobs;
+	struct arena arenas[MAX_WORKERS];
+	const struct strategy *strat;
+	atomic_long steps;
+	long max_steps;
+	int limit;		/* depth of the round of deepening */
+	long deadline;
+	atomic_int *cancel;
+	atomic_int aborted;
+	atomic_int timedout;
+	int intuitionistic;	/* no PBC, LEM or --e */
+	int prune;
+	atomic_long pruned;
+	struct term **atoms;
+	int natoms;
+	struct sem *sems[MAX_WORKERS];
+};
+
+/* Alternatives forked together; set once one of them has succeeded. */
+struct group {
+	atomic_int solved;
+	struct group *parent;
+};
+
+/* The context of one worker while it searches. */
+struct prover {
+	struct shared *sh;
+	int worker;
+	struct group *group;
+	struct hyp *ctx;
+	int nctx;
+	int ctxcap;
+	int *where;
+	int wherecap;
+	uint64_t ctxkey;
+	struct sem *sem;	/* NULL when not pruning */
+	uint64_t *models;	/* of ctx[0..i), for every i */
+	int modelscap;
+};
+
+static inline struct term *neg(struct prover *pv, struct term *t)
+{
+	return term_make(pv->sh->terms, FORM_NOT, t, NULL);
+}
+
+static inline void line_in(struct deriv *d, struct deriv *in)
+{
+	d->in[d->nin].type = INPUT_LINE;
+	d->in[d->nin++].d = in;
+	d->cost += in->cost;
+}
+
+/* The assumption, the body and a copy if the body ends on no line of its
+ * own. */
+static inline int box_cost(struct deriv *last)
+{
+	return 1 + last->cost + !last->cost;
+}
+
+static inline void box_in(struct deriv *d, struct term *hyp,
+			  struct deriv *last)
+{
+	d->cost += box_cost(last);
+	d->in[d->nin].type = INPUT_BOX;
+	d->in[d->nin].hyp = hyp;
+	d->in[d->nin++].d = last;
+}
+
+static inline void form_in(struct deriv *d, struct term *form)
+{
+	d->in[d->nin].type = INPUT_FORM;
+	d->in[d->nin++].form = form;
+}
+
+/* The derivation of t in context, or NULL. */
+static inline struct deriv *lookup(struct prover *pv, struct term *t)
+{
+	if (t->id < pv->wherecap && pv->where[t->id])
+		return pv->ctx[pv->where[t->id] - 1].d;
+	return NULL;
+}
+
+long now_ms(void);
+struct deriv *mk(struct prover *pv, int rule, struct term *form);
+struct deriv *elim1(struct prover *pv, int rule, struct term *form,
+		    struct deriv *in);
+struct deriv *elim2(struct prover *pv, int rule, struct term *form,
+		    struct deriv *in1, struct deriv *in2);
+struct deriv *boxed(struct prover *pv, int rule, struct term *form,
+		    struct term *hyp, struct deriv *body);
+struct deriv *impl(struct prover *pv, struct term *t, struct deriv *b);
+struct deriv *not_disjunct(struct prover *pv, struct term *t, int or_intro,
+			   struct deriv *d);
+struct deriv *not_impl(struct prover *pv, struct term *t, int left,
+		       struct deriv *d);
+int assume(struct prover *pv, struct term *t, struct deriv *d);
+void pop(struct prover *pv, int n);
+int stopped(struct prover *pv);
+int tick(struct prover *pv);
+struct deriv *recall(struct prover *pv, struct term *goal, int depth,
+		     int *failed);
+void memoize(struct prover *pv, struct term *goal, int depth,
+	     struct deriv *proof);
+int emit_refutation(struct emitter *base, int rule, struct term *g,
+		    struct term *hyp, struct deriv **steps, int n,
+		    struct cmdlist *out);
+
+#endif
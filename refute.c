@@ -0,0 +1,409 @@
+#include "refute.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "parse.h"
+#include "prove.h"
+#include "prover.h"
+#include "resolve.h"
+#include "term.h"
+
+#define RES_MAX_LITS (1 << 20)
+/* Clauses added between looks at the deadline. */
+#define RES_CHUNK 4096
+
+struct refuter {
+	struct prover *pv;
+	int *vars;		/* of the atoms, by term id */
+	signed char *vals;	/* by variable, -1 if unknown */
+	struct deriv **facts;	/* the atom, or its negation if false */
+	int *lits;		/* clauses, each ended by 0 */
+	int nlits;
+	int litcap;
+};
+
+static void put_lit(struct refuter *rf, int l)
+{
+	if (rf->nlits == rf->litcap) {
+		rf->litcap = rf->litcap ? 2 * rf->litcap : 256;
+		rf->lits = realloc(rf->lits, rf->litcap * sizeof(*rf->lits));
+	}
+	rf->lits[rf->nlits++] = l;
+}
+
+/* Appends the clauses of t, or of its negation if !sign. Returns 0 when
+ * there are too many. */
+static int clausify(struct refuter *rf, struct term *t, int sign)
+{
+	int from = rf->nlits, mid, end, split, ok = 1;
+	int lsign = sign, rsign = sign;
+
+	switch (t->type) {
+	case FORM_NAME:
+		put_lit(rf, sign ? rf->vars[t->id] : -rf->vars[t->id]);
+		put_lit(rf, 0);
+		return 1;
+	case FORM_CON:
+		if (sign)
+			put_lit(rf, 0);
+		return 1;
+	case FORM_NOT:
+		return clausify(rf, t->lhs, !sign);
+	case FORM_AND:
+		split = sign;
+		break;
+	case FORM_OR:
+		split = !sign;
+		break;
+	default:
+		lsign = !sign;
+		split = !sign;
+		break;
+	}
+	if (split)
+		return clausify(rf, t->lhs, lsign)
+		    && clausify(rf, t->rhs, rsign);
+
+	/* every clause of one side joined with every clause of the other */
+	if (!clausify(rf, t->lhs, lsign))
+		return 0;
+	mid = rf->nlits;
+	if (!clausify(rf, t->rhs, rsign))
+		return 0;
+	end = rf->nlits;
+	for (int i = from, j; i < mid && ok; i = j + 1) {
+		for (j = i; rf->lits[j]; j++)
+			;
+		for (int k = mid, m; k < end && ok; k = m + 1) {
+			for (m = k; rf->lits[m]; m++)
+				;
+			if (rf->nlits + (j - i) + (m - k) >= RES_MAX_LITS) {
+				ok = 0;
+				break;
+			}
+			for (int x = i; x < j; x++)
+				put_lit(rf, rf->lits[x]);
+			for (int x = k; x <= m; x++)
+				put_lit(rf, rf->lits[x]);
+		}
+	}
+	memmove(rf->lits + from, rf->lits + end,
+		(rf->nlits - end) * sizeof(*rf->lits));
+	rf->nlits -= end - from;
+	return ok;
+}
+
+static struct term *lit_term(struct prover *pv, int l)
+{
+	struct term *a = pv->sh->atoms[abs(l) - 1];
+
+	return l > 0 ? a : neg(pv, a);
+}
+
+/* The disjunction of the literals, nested to the right, or _|_. */
+static struct term *clause_term(struct prover *pv, const int *lits, int n)
+{
+	struct term *t;
+
+	if (!n)
+		return pv->sh->bot;
+	t = lit_term(pv, lits[n - 1]);
+	for (int i = n - 2; i >= 0; i--)
+		t = term_make(pv->sh->terms, FORM_OR, lit_term(pv, lits[i]), t);
+	return t;
+}
+
+/* The value of t under the atoms known, 1, 0 or -1 if it depends on
+ * others. */
+static int kval(struct refuter *rf, struct term *t)
+{
+	int a, b;
+
+	switch (t->type) {
+	case FORM_NAME:
+		return rf->vals[rf->vars[t->id]];
+	case FORM_CON:
+		return 0;
+	case FORM_NOT:
+		a = kval(rf, t->lhs);
+		return a < 0 ? a : !a;
+	}
+	a = kval(rf, t->lhs);
+	b = kval(rf, t->rhs);
+	if (t->type == FORM_IMPL)
+		a = a < 0 ? a : !a;
+	if (t->type == FORM_AND)
+		return !a || !b ? 0 : a < 0 || b < 0 ? -1 : 1;
+	return a == 1 || b == 1 ? 1 : a < 0 || b < 0 ? -1 : 0;
+}
+
+static struct deriv *falsify(struct refuter *rf, struct term *t,
+			     struct deriv *d);
+
+/* A derivation of t, which the atoms known make true. */
+static struct deriv *verify(struct refuter *rf, struct term *t)
+{
+	struct prover *pv = rf->pv;
+	struct deriv *d, *b;
+
+	switch (t->type) {
+	case FORM_NAME:
+		return rf->facts[rf->vars[t->id]];
+	case FORM_NOT:
+		if (t->lhs->type == FORM_NAME)
+			return rf->facts[rf->vars[t->lhs->id]];
+		d = mk(pv, RULE_NOT_INTR, t);
+		box_in(d, t->lhs, falsify(rf, t->lhs, mk(pv, HYP, t->lhs)));
+		return d;
+	case FORM_AND:
+		return elim2(pv, RULE_AND_INTR, t, verify(rf, t->lhs),
+			     verify(rf, t->rhs));
+	case FORM_OR:
+		if (kval(rf, t->lhs) == 1) {
+			d = elim1(pv, RULE_OR_INTR_1, t, verify(rf, t->lhs));
+			form_in(d, t->rhs);
+		} else {
+			d = mk(pv, RULE_OR_INTR_2, t);
+			form_in(d, t->lhs);
+			line_in(d, verify(rf, t->rhs));
+		}
+		return d;
+	}
+	if (kval(rf, t->rhs) == 1) {
+		b = verify(rf, t->rhs);
+	} else {
+		b = elim1(pv, RULE_CON_ELIM, t->rhs,
+			  falsify(rf, t->lhs, mk(pv, HYP, t->lhs)));
+		form_in(b, t->rhs);
+	}
+	return impl(pv, t, b);
+}
+
+/* _|_ from a derivation d of t, which the atoms known make false. */
+static struct deriv *falsify(struct refuter *rf, struct term *t,
+			     struct deriv *d)
+{
+	struct prover *pv = rf->pv;
+	struct term *bot = pv->sh->bot;
+	struct deriv *r;
+
+	switch (t->type) {
+	case FORM_NAME:
+		return elim2(pv, RULE_NOT_ELIM, bot, d,
+			     rf->facts[rf->vars[t->id]]);
+	case FORM_CON:
+		return d;
+	case FORM_NOT:
+		return elim2(pv, RULE_NOT_ELIM, bot, verify(rf, t->lhs), d);
+	case FORM_AND:
+		if (!kval(rf, t->lhs))
+			return falsify(rf, t->lhs,
+				       elim1(pv, RULE_AND_ELIM_1, t->lhs, d));
+		return falsify(rf, t->rhs,
+			       elim1(pv, RULE_AND_ELIM_2, t->rhs, d));
+	case FORM_OR:
+		r = mk(pv, RULE_OR_ELIM, bot);
+		line_in(r, d);
+		box_in(r, t->lhs, falsify(rf, t->lhs, mk(pv, HYP, t->lhs)));
+		box_in(r, t->rhs, falsify(rf, t->rhs, mk(pv, HYP, t->rhs)));
+		return r;
+	}
+	return falsify(rf, t->rhs, elim2(pv, RULE_IMPL_ELIM, t->rhs,
+					 verify(rf, t->lhs), d));
+}
+
+/* Makes the literals of clause t false, from a derivation d of -t. */
+static void deny(struct refuter *rf, struct term *t, const int *lits, int n,
+		 struct deriv *d)
+{
+	struct prover *pv = rf->pv;
+	struct deriv *l;
+	int v;
+
+	for (int i = 0; i < n; i++, t = t->rhs) {
+		l = d;
+		if (i < n - 1) {
+			l = not_disjunct(pv, neg(pv, t), RULE_OR_INTR_1, d);
+			d = not_disjunct(pv, neg(pv, t), RULE_OR_INTR_2, d);
+		}
+		v = abs(lits[i]);
+		rf->vals[v] = lits[i] < 0;
+		rf->facts[v] = lits[i] > 0 ? l
+		    : elim1(pv, RULE_NOT_NOT_ELIM, pv->sh->atoms[v - 1], l);
+	}
+}
+
+/* _|_ from the parents of c, found as lines before it. */
+static struct deriv *resolvent(struct refuter *rf, const struct res_clause *c,
+			       struct term **lines)
+{
+	struct prover *pv = rf->pv;
+	int v = abs(c->pivot), pos = c->left, negc = c->right;
+	struct term *a = pv->sh->atoms[v - 1];
+	struct deriv *d, *r;
+
+	if (c->pivot < 0) {
+		pos = c->right;
+		negc = c->left;
+	}
+	/* the pivot true refutes the parent holding its negation */
+	rf->vals[v] = 1;
+	rf->facts[v] = mk(pv, HYP, a);
+	r = mk(pv, RULE_NOT_INTR, neg(pv, a));
+	box_in(r, a, falsify(rf, lines[negc], mk(pv, HYP, lines[negc])));
+
+	rf->vals[v] = 0;
+	rf->facts[v] = r;
+	d = falsify(rf, lines[pos], mk(pv, HYP, lines[pos]));
+	rf->vals[v] = -1;
+	return d;
+}
+
+/*
+ * A derivation of clause i of the resolver, given lines holding the
+ * clauses before it. A clause of the CNF is derived from formula
+ * origin[i] of forms, itself derived by fromd.
+ */
+static struct deriv *derive_clause(struct refuter *rf, struct resolver *res,
+				   int i, struct term **lines, int *origin,
+				   struct term **forms, struct deriv **fromd)
+{
+	const struct res_clause *c = res_clause(res, i);
+	struct prover *pv = rf->pv;
+	struct term *t = lines[i], *h;
+	struct deriv *body, *r;
+	int rule = RULE_PBC;
+
+	if (c->left < 0 && forms[origin[i]] == t)
+		return fromd[origin[i]];
+	if (c->n == 1 && c->lits[0] < 0) {
+		/* -a by -i, from a */
+		h = t->lhs;
+		rule = RULE_NOT_INTR;
+		rf->vals[-c->lits[0]] = 1;
+		rf->facts[-c->lits[0]] = mk(pv, HYP, h);
+	} else {
+		h = neg(pv, t);
+		deny(rf, t, c->lits, c->n, mk(pv, HYP, h));
+	}
+	if (c->left < 0)
+		body = falsify(rf, forms[origin[i]], fromd[origin[i]]);
+	else
+		body = resolvent(rf, c, lines);
+	for (int k = 0; k < c->n; k++)
+		rf->vals[abs(c->lits[k])] = -1;
+
+	if (!c->n)
+		return body;
+	r = mk(pv, rule, t);
+	box_in(r, h, body);
+	return r;
+}
+
+/*
+ * Proves g from the n lines in scope, forms, by resolution. Returns the
+ * number of lines the commands in out add, or -1.
+ */
+int refute(struct prover *pv, struct emitter *e, struct term **forms,
+	   int n, struct term *g, const struct prove_opts *opts,
+	   struct cmdlist *out, char *errbuf, size_t errbufsz)
+{
+	struct shared *sh = pv->sh;
+	struct refuter rf = { 0 };
+	struct resolver *res = res_new();
+	const struct res_clause *c;
+	struct term **from, **lines = NULL;
+	struct deriv **fromd, **steps = NULL;
+	int *ends, *origin = NULL, *proof = NULL, nclauses = 0, nsteps;
+	int len = -1, k, status;
+	long limit = 0;
+
+	rf.pv = pv;
+	rf.vars = calloc(terms_count(sh->terms), sizeof(*rf.vars));
+	for (int i = 0; i < sh->natoms; i++)
+		rf.vars[sh->atoms[i]->id] = i + 1;
+	rf.vals = malloc(sh->natoms + 1);
+	memset(rf.vals, -1, sh->natoms + 1);
+	rf.facts = calloc(sh->natoms + 1, sizeof(*rf.facts));
+
+	/* the lines in scope, then the negated goal, -A just as A */
+	from = malloc((n + 1) * sizeof(*from));
+	fromd = malloc((n + 1) * sizeof(*fromd));
+	ends = malloc((n + 1) * sizeof(*ends));
+	memcpy(from, forms, n * sizeof(*forms));
+	from[n] = g->type == FORM_NOT ? g->lhs : neg(pv, g);
+	for (int i = 0; i <= n; i++) {
+		fromd[i] = mk(pv, HYP, from[i]);
+		if (!clausify(&rf, from[i], 1)) {
+			snprintf(errbuf, errbufsz, "too many clauses in the CNF "
+				 "of the lines in scope");
+			goto out;
+		}
+		ends[i] = rf.nlits;
+	}
+	for (int i = 0; i < rf.nlits; i++)
+		nclauses += !rf.lits[i];
+	origin = malloc(nclauses * sizeof(*origin));
+	for (int i = 0, j = 0, m; i <= n; i++) {
+		for (; j < ends[i]; j = m + 1) {
+			for (m = j; rf.lits[m]; m++)
+				;
+			if ((k = res_add(res, rf.lits + j, m - j)) >= 0)
+				origin[k] = i;
+		}
+	}
+
+	do {
+		limit += RES_CHUNK;
+		if (limit > opts->max_steps)
+			limit = opts->max_steps;
+		status = res_solve(res, limit);
+	} while (status == RES_UNKNOWN && limit < opts->max_steps
+		 && (!sh->deadline || now_ms() <= sh->deadline));
+	ndelog("resolve: %d clauses\n", res_count(res));
+	if (status == RES_SATURATED) {
+		snprintf(errbuf, errbufsz, "not a consequence of the lines in "
+			 "scope, saturated with %d clauses", res_count(res));
+		goto out;
+	}
+	if (status == RES_UNKNOWN) {
+		if (limit < opts->max_steps)
+			snprintf(errbuf, errbufsz, "no refutation found within "
+				 "%ld ms", opts->max_time_ms);
+		else
+			snprintf(errbuf, errbufsz, "no refutation found within "
+				 "%ld clauses", opts->max_steps);
+		goto out;
+	}
+
+	proof = malloc(res_count(res) * sizeof(*proof));
+	lines = calloc(res_count(res), sizeof(*lines));
+	nsteps = res_proof(res, proof);
+	steps = malloc(nsteps * sizeof(*steps));
+	for (int i = 0; i < nsteps; i++) {
+		c = res_clause(res, proof[i]);
+		lines[proof[i]] = clause_term(pv, c->lits, c->n);
+		steps[i] = derive_clause(&rf, res, proof[i], lines, origin,
+					 from, fromd);
+	}
+	len = emit_refutation(e, g->type == FORM_NOT ? RULE_NOT_INTR : RULE_PBC,
+			      g, from[n], steps, nsteps, out);
+	if (len < 0)
+		snprintf(errbuf, errbufsz, "internal error in proof search");
+
+ out:
+	free(steps);
+	free(lines);
+	free(proof);
+	free(origin);
+	free(ends);
+	free(fromd);
+	free(from);
+	free(rf.lits);
+	free(rf.facts);
+	free(rf.vals);
+	free(rf.vars);
+	res_destroy(res);
+	return len;
+}
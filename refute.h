@@ -0,0 +1,31 @@
+#ifndef REFUTE_H
+#define REFUTE_H
+
+#include <stddef.h>
+
+struct cmdlist;
+struct emitter;
+struct prove_opts;
+struct prover;
+struct term;
+
+/*
+ * Refutations by resolution. The lines in scope and the negated goal are
+ * put in CNF by distributing / over ^, and the clauses saturated. The
+ * clauses of the refutation become lines of a box assuming the negated
+ * goal, which PBC closes once the empty clause gives _|_; a goal -A is
+ * proved by -i from A instead.
+ *
+ * A clause is written as the disjunction of its literals and proved by
+ * PBC from its negation, which makes its literals false, or by -i if it
+ * is a negated atom. A resolvent refutes the parent with the pivot
+ * negated in a box assuming the pivot, and then the other parent. A
+ * clause of the CNF refutes the formula it came from. Either way the formula refuted is false under the literals
+ * already false alone, whatever the other atoms are, and is taken apart
+ * by its shape.
+ */
+int refute(struct prover *pv, struct emitter *e, struct term **forms,
+	   int n, struct term *g, const struct prove_opts *opts,
+	   struct cmdlist *out, char *errbuf, size_t errbufsz);
+
+#endif
@@ -0,0 +1,347 @@
+#include "resolve.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Processed clauses containing a literal, subsumed ones left in. */
+struct occ {
+	int *c;
+	int n;
+	int cap;
+};
+
+struct resolver {
+	struct res_clause **cls;
+	int ncls;
+	int cap;
+	int nvars;
+	struct occ *occ;	/* by 2(v - 1), plus one for not v */
+	struct occ *first;	/* by the first literal only */
+	int *heap;		/* of clauses not processed yet */
+	int nheap;
+	int heapcap;
+	int *tmp;
+	int empty;		/* the empty clause once derived, or -1 */
+};
+
+static int key(int l)
+{
+	return 2 * (abs(l) - 1) + (l < 0);
+}
+
+static int cmp_lit(const void *a, const void *b)
+{
+	return key(*(const int *)a) - key(*(const int *)b);
+}
+
+/* Whether clause a comes before b, the shorter and then the older. */
+static int before(struct resolver *r, int a, int b)
+{
+	if (r->cls[a]->n != r->cls[b]->n)
+		return r->cls[a]->n < r->cls[b]->n;
+	return a < b;
+}
+
+static void heap_push(struct resolver *r, int c)
+{
+	int i, t;
+
+	if (r->nheap == r->heapcap) {
+		r->heapcap = r->heapcap ? 2 * r->heapcap : 256;
+		r->heap = realloc(r->heap, r->heapcap * sizeof(*r->heap));
+	}
+	i = r->nheap++;
+	r->heap[i] = c;
+	for (; i && before(r, r->heap[i], r->heap[(i - 1) / 2]);
+	     i = (i - 1) / 2) {
+		t = r->heap[i];
+		r->heap[i] = r->heap[(i - 1) / 2];
+		r->heap[(i - 1) / 2] = t;
+	}
+}
+
+static int heap_pop(struct resolver *r)
+{
+	int c = r->heap[0], i = 0, j, t;
+
+	r->heap[0] = r->heap[--r->nheap];
+	for (; (j = 2 * i + 1) < r->nheap; i = j) {
+		if (j + 1 < r->nheap && before(r, r->heap[j + 1], r->heap[j]))
+			j++;
+		if (!before(r, r->heap[j], r->heap[i]))
+			break;
+		t = r->heap[i];
+		r->heap[i] = r->heap[j];
+		r->heap[j] = t;
+	}
+	return c;
+}
+
+static void grow(struct resolver *r, int nvars)
+{
+	if (nvars <= r->nvars)
+		return;
+	r->occ = realloc(r->occ, 2 * nvars * sizeof(*r->occ));
+	r->first = realloc(r->first, 2 * nvars * sizeof(*r->first));
+	memset(r->occ + 2 * r->nvars, 0,
+	       2 * (nvars - r->nvars) * sizeof(*r->occ));
+	memset(r->first + 2 * r->nvars, 0,
+	       2 * (nvars - r->nvars) * sizeof(*r->first));
+	r->tmp = realloc(r->tmp, nvars * sizeof(*r->tmp));
+	r->nvars = nvars;
+}
+
+static uint64_t signature(const int *lits, int n)
+{
+	uint64_t sig = 0;
+
+	for (int i = 0; i < n; i++)
+		sig |= 1ULL << (key(lits[i]) % 64);
+	return sig;
+}
+
+/* Whether the literals of a are among those of b, both sorted. */
+static int subsumes(const struct res_clause *a, const int *lits, int n,
+		    uint64_t sig)
+{
+	int j = 0;
+
+	if (a->n > n || (a->sig & ~sig))
+		return 0;
+	for (int i = 0; i < a->n; i++) {
+		while (j < n && key(lits[j]) < key(a->lits[i]))
+			j++;
+		if (j == n || lits[j] != a->lits[i])
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Whether a processed clause subsumes the literals. Its first literal is
+ * among them, so only the clauses indexed by first literal are tried.
+ */
+static int forward(struct resolver *r, const int *lits, int n,
+		   uint64_t sig)
+{
+	struct occ *o;
+	struct res_clause *c;
+
+	for (int i = 0; i < n; i++) {
+		o = &r->first[key(lits[i])];
+		for (int k = 0; k < o->n; k++) {
+			c = r->cls[o->c[k]];
+			if (!c->dead && subsumes(c, lits, n, sig))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/* Marks the processed clauses clause c subsumes, found under the
+ * literal of c that the fewest are indexed by. */
+static void backward(struct resolver *r, int c)
+{
+	struct res_clause *a = r->cls[c], *b;
+	struct occ *o = &r->occ[key(a->lits[0])];
+
+	for (int i = 1; i < a->n; i++) {
+		if (r->occ[key(a->lits[i])].n < o->n)
+			o = &r->occ[key(a->lits[i])];
+	}
+	for (int k = 0; k < o->n; k++) {
+		b = r->cls[o->c[k]];
+		if (!b->dead && subsumes(a, b->lits, b->n, b->sig))
+			b->dead = 1;
+	}
+}
+
+static void index_clause(struct occ *o, int c)
+{
+	if (o->n == o->cap) {
+		o->cap = o->cap ? 2 * o->cap : 8;
+		o->c = realloc(o->c, o->cap * sizeof(*o->c));
+	}
+	o->c[o->n++] = c;
+}
+
+static void activate(struct resolver *r, int c)
+{
+	struct res_clause *a = r->cls[c];
+
+	index_clause(&r->first[key(a->lits[0])], c);
+	for (int i = 0; i < a->n; i++)
+		index_clause(&r->occ[key(a->lits[i])], c);
+}
+
+static int new_clause(struct resolver *r, const int *lits, int n, int left,
+		      int right, int pivot)
+{
+	struct res_clause *c;
+
+	if (r->ncls == r->cap) {
+		r->cap = r->cap ? 2 * r->cap : 256;
+		r->cls = realloc(r->cls, r->cap * sizeof(*r->cls));
+	}
+	c = malloc(sizeof(*c) + n * sizeof(*c->lits));
+	c->n = n;
+	c->left = left;
+	c->right = right;
+	c->pivot = pivot;
+	c->dead = 0;
+	c->sig = signature(lits, n);
+	memcpy(c->lits, lits, n * sizeof(*lits));
+	r->cls[r->ncls] = c;
+	if (!n && r->empty < 0)
+		r->empty = r->ncls;
+	heap_push(r, r->ncls);
+	return r->ncls++;
+}
+
+struct resolver *res_new(void)
+{
+	struct resolver *r = calloc(1, sizeof(*r));
+
+	r->empty = -1;
+	return r;
+}
+
+void res_destroy(struct resolver *r)
+{
+	if (!r)
+		return;
+	for (int i = 0; i < r->ncls; i++)
+		free(r->cls[i]);
+	for (int i = 0; i < 2 * r->nvars; i++) {
+		free(r->occ[i].c);
+		free(r->first[i].c);
+	}
+	free(r->cls);
+	free(r->occ);
+	free(r->first);
+	free(r->heap);
+	free(r->tmp);
+	free(r);
+}
+
+/* Adds a given clause, returning its number or -1 for a tautology. */
+int res_add(struct resolver *r, const int *lits, int n)
+{
+	int *c = malloc((n + 1) * sizeof(*c)), m = 0, res = -1;
+
+	memcpy(c, lits, n * sizeof(*lits));
+	for (int i = 0; i < n; i++)
+		grow(r, abs(lits[i]));
+	/* complementary literals are adjacent once sorted */
+	qsort(c, n, sizeof(*c), cmp_lit);
+	for (int i = 0; i < n; i++) {
+		if (m && c[m - 1] == -c[i])
+			goto out;
+		if (!m || c[m - 1] != c[i])
+			c[m++] = c[i];
+	}
+	res = new_clause(r, c, m, -1, -1, 0);
+ out:
+	free(c);
+	return res;
+}
+
+/* The resolvent of a and b on the variable of l, which a holds and b
+ * holds negated, into r->tmp. Returns its length or -1 if a tautology. */
+static int resolve(struct resolver *r, struct res_clause *a,
+		   struct res_clause *b, int l)
+{
+	int i = 0, j = 0, n = 0, x;
+
+	while (i < a->n || j < b->n) {
+		if (j == b->n || (i < a->n && key(a->lits[i])
+				  <= key(b->lits[j])))
+			x = a->lits[i++];
+		else
+			x = b->lits[j++];
+		if (abs(x) == abs(l))
+			continue;
+		if (n && r->tmp[n - 1] == -x)
+			return -1;
+		if (!n || r->tmp[n - 1] != x)
+			r->tmp[n++] = x;
+	}
+	return n;
+}
+
+/*
+ * Saturates the clauses until the empty one is derived, none is left to
+ * process or there are max_clauses of them. The clauses of the given one
+ * are all added before stopping, so a later call carries on.
+ */
+int res_solve(struct resolver *r, long max_clauses)
+{
+	struct res_clause *c, *d;
+	struct occ *o;
+	int given, n, l;
+
+	while (r->empty < 0 && r->nheap) {
+		if (r->ncls >= max_clauses)
+			return RES_UNKNOWN;
+		given = heap_pop(r);
+		c = r->cls[given];
+		if (c->dead || forward(r, c->lits, c->n, c->sig)) {
+			c->dead = 1;
+			continue;
+		}
+		backward(r, given);
+		activate(r, given);
+
+		for (int i = 0; i < c->n && r->empty < 0; i++) {
+			l = c->lits[i];
+			o = &r->occ[key(-l)];
+			for (int k = 0; k < o->n && r->empty < 0; k++) {
+				d = r->cls[o->c[k]];
+				if (d->dead)
+					continue;
+				n = resolve(r, c, d, l);
+				if (n < 0 || forward(r, r->tmp, n,
+						     signature(r->tmp, n)))
+					continue;
+				new_clause(r, r->tmp, n, given, o->c[k], l);
+			}
+		}
+	}
+	return r->empty >= 0 ? RES_REFUTED : RES_SATURATED;
+}
+
+const struct res_clause *res_clause(struct resolver *r, int i)
+{
+	return r->cls[i];
+}
+
+int res_count(struct resolver *r)
+{
+	return r->ncls;
+}
+
+/*
+ * The clauses the empty one was derived from, in the order they were
+ * derived, ending with it. Parents come before their resolvents.
+ */
+int res_proof(struct resolver *r, int *steps)
+{
+	char *used;
+	int n = 0;
+
+	if (r->empty < 0)
+		return 0;
+	used = calloc(r->empty + 1, 1);
+	used[r->empty] = 1;
+	for (int i = r->empty; i >= 0; i--) {
+		if (used[i] && r->cls[i]->left >= 0) {
+			used[r->cls[i]->left] = 1;
+			used[r->cls[i]->right] = 1;
+		}
+	}
+	for (int i = 0; i <= r->empty; i++) {
+		if (used[i])
+			steps[n++] = i;
+	}
+	free(used);
+	return n;
+}
@@ -0,0 +1,44 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <stdint.h>
+
+enum {
+	RES_REFUTED,
+	RES_SATURATED,
+	RES_UNKNOWN,
+};
+
+/*
+ * A clause with its literals sorted by variable, each variable at most
+ * once. A resolvent records its parents, left holding the pivot literal
+ * and right its negation; a given clause has -1 for both.
+ */
+struct res_clause {
+	int n;
+	int left;
+	int right;
+	int pivot;
+	int dead;		/* subsumed */
+	uint64_t sig;
+	int lits[];
+};
+
+/*
+ * Saturation by binary resolution: the given clause loop, picking the
+ * shortest and then oldest clause not yet processed. Processed clauses
+ * are indexed by literal, for finding the clauses a given one resolves
+ * with and those it subsumes or is subsumed by. Variables are numbered
+ * from 1 and literals are DIMACS style, -v meaning not v.
+ */
+struct resolver;
+
+struct resolver *res_new(void);
+void res_destroy(struct resolver *r);
+int res_add(struct resolver *r, const int *lits, int n);
+int res_solve(struct resolver *r, long max_clauses);
+const struct res_clause *res_clause(struct resolver *r, int i);
+int res_count(struct resolver *r);
+int res_proof(struct resolver *r, int *steps);
+
+#endif
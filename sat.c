@@ -0,0 +1,610 @@
+#include "sat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Conflicts in the shortest run between restarts. */
+#define RESTART_BASE 100
+#define VAR_DECAY 0.95
+/* Conflicts before the first reduction of learnt clauses, and growth. */
+#define REDUCE_BASE 2000
+#define REDUCE_STEP 300
+
+/*
+ * Internally variable v is 0 to nvars - 1 and literal 2v + 1 is its
+ * negation. The implied literal of a reason clause is its first.
+ */
+struct clause {
+	int n;
+	int lbd;		/* levels when learnt, 0 if given */
+	int lits[];
+};
+
+struct clist {
+	struct clause **c;
+	int n;
+	int cap;
+};
+
+struct sat {
+	int nvars;
+	int cap;
+	signed char *val;	/* -1 while unassigned */
+	int *level;
+	struct clause **reason;
+	char *phase;
+	char *seen;
+	double *act;
+	double inc;
+	int *heap;		/* of variables by activity */
+	int nheap;
+	int *hpos;		/* -1 when not in the heap */
+	struct clist *watch;	/* clauses watching a literal */
+	int *trail;
+	int ntrail;
+	int qhead;
+	int *lims;		/* trail length at each decision */
+	int nlims;
+	struct clist clauses;
+	struct clist learnts;
+	int *tmp;
+	int ntmp;
+	int *stamp;		/* per level, for counting levels */
+	int nstamp;
+	int unsat;
+	long conflicts;
+	long next_reduce;
+	int nreduce;
+};
+
+static int lit_val(struct sat *s, int l)
+{
+	int v = s->val[l >> 1];
+	return v < 0 ? -1 : v ^ (l & 1);
+}
+
+static void heap_swap(struct sat *s, int i, int j)
+{
+	int t = s->heap[i];
+
+	s->heap[i] = s->heap[j];
+	s->heap[j] = t;
+	s->hpos[s->heap[i]] = i;
+	s->hpos[s->heap[j]] = j;
+}
+
+static void heap_up(struct sat *s, int i)
+{
+	while (i && s->act[s->heap[(i - 1) / 2]] < s->act[s->heap[i]]) {
+		heap_swap(s, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void heap_down(struct sat *s, int i)
+{
+	int c;
+
+	for (; (c = 2 * i + 1) < s->nheap; i = c) {
+		if (c + 1 < s->nheap && s->act[s->heap[c + 1]]
+		    > s->act[s->heap[c]])
+			c++;
+		if (s->act[s->heap[c]] <= s->act[s->heap[i]])
+			break;
+		heap_swap(s, i, c);
+	}
+}
+
+static void heap_insert(struct sat *s, int v)
+{
+	s->hpos[v] = s->nheap;
+	s->heap[s->nheap++] = v;
+	heap_up(s, s->nheap - 1);
+}
+
+static int heap_pop(struct sat *s)
+{
+	int v = s->heap[0];
+
+	heap_swap(s, 0, --s->nheap);
+	s->hpos[v] = -1;
+	heap_down(s, 0);
+	return v;
+}
+
+static void grow(struct sat *s, int nvars)
+{
+	int old = s->cap;
+
+	if (nvars <= s->nvars)
+		return;
+	if (nvars > s->cap) {
+		s->cap = 2 * s->cap > nvars ? 2 * s->cap : nvars;
+		s->val = realloc(s->val, s->cap * sizeof(*s->val));
+		s->level = realloc(s->level, s->cap * sizeof(*s->level));
+		s->reason = realloc(s->reason, s->cap * sizeof(*s->reason));
+		s->phase = realloc(s->phase, s->cap * sizeof(*s->phase));
+		s->seen = realloc(s->seen, s->cap * sizeof(*s->seen));
+		s->act = realloc(s->act, s->cap * sizeof(*s->act));
+		s->heap = realloc(s->heap, s->cap * sizeof(*s->heap));
+		s->hpos = realloc(s->hpos, s->cap * sizeof(*s->hpos));
+		s->trail = realloc(s->trail, s->cap * sizeof(*s->trail));
+		s->lims = realloc(s->lims, s->cap * sizeof(*s->lims));
+		s->tmp = realloc(s->tmp, s->cap * sizeof(*s->tmp));
+		s->stamp = realloc(s->stamp, (s->cap + 1) * sizeof(*s->stamp));
+		s->watch = realloc(s->watch, 2 * s->cap * sizeof(*s->watch));
+		memset(s->watch + 2 * old, 0,
+		       2 * (s->cap - old) * sizeof(*s->watch));
+		memset(s->stamp + old, 0,
+		       (s->cap + 1 - old) * sizeof(*s->stamp));
+	}
+	for (int v = s->nvars; v < nvars; v++) {
+		s->val[v] = -1;
+		s->level[v] = 0;
+		s->reason[v] = NULL;
+		s->phase[v] = 0;
+		s->seen[v] = 0;
+		s->act[v] = 0;
+		heap_insert(s, v);
+	}
+	s->nvars = nvars;
+}
+
+struct sat *sat_new(void)
+{
+	struct sat *s = calloc(1, sizeof(*s));
+
+	s->inc = 1;
+	s->next_reduce = REDUCE_BASE;
+	return s;
+}
+
+void sat_destroy(struct sat *s)
+{
+	if (!s)
+		return;
+	for (int i = 0; i < s->clauses.n; i++)
+		free(s->clauses.c[i]);
+	for (int i = 0; i < s->learnts.n; i++)
+		free(s->learnts.c[i]);
+	for (int i = 0; i < 2 * s->nvars; i++)
+		free(s->watch[i].c);
+	free(s->clauses.c);
+	free(s->learnts.c);
+	free(s->stamp);
+	free(s->watch);
+	free(s->val);
+	free(s->level);
+	free(s->reason);
+	free(s->phase);
+	free(s->seen);
+	free(s->act);
+	free(s->heap);
+	free(s->hpos);
+	free(s->trail);
+	free(s->lims);
+	free(s->tmp);
+	free(s);
+}
+
+static void enqueue(struct sat *s, int l, struct clause *reason)
+{
+	s->val[l >> 1] = !(l & 1);
+	s->level[l >> 1] = s->nlims;
+	s->reason[l >> 1] = reason;
+	s->trail[s->ntrail++] = l;
+}
+
+static void push(struct clist *l, struct clause *c)
+{
+	if (l->n == l->cap) {
+		l->cap = l->cap ? 2 * l->cap : 4;
+		l->c = realloc(l->c, l->cap * sizeof(*l->c));
+	}
+	l->c[l->n++] = c;
+}
+
+static struct clause *new_clause(struct sat *s, const int *lits, int n,
+				 int lbd)
+{
+	struct clause *c = malloc(sizeof(*c) + n * sizeof(*lits));
+
+	c->n = n;
+	c->lbd = lbd;
+	memcpy(c->lits, lits, n * sizeof(*lits));
+	push(lbd ? &s->learnts : &s->clauses, c);
+	push(&s->watch[c->lits[0]], c);
+	push(&s->watch[c->lits[1]], c);
+	return c;
+}
+
+static void backtrack(struct sat *s, int level)
+{
+	int v;
+
+	if (s->nlims <= level)
+		return;
+	for (int i = s->ntrail - 1; i >= s->lims[level]; i--) {
+		v = s->trail[i] >> 1;
+		s->phase[v] = s->val[v];
+		s->val[v] = -1;
+		s->reason[v] = NULL;
+		if (s->hpos[v] < 0)
+			heap_insert(s, v);
+	}
+	s->ntrail = s->qhead = s->lims[level];
+	s->nlims = level;
+}
+
+/* Assigns what the trail implies, returning a clause made false if any. */
+static struct clause *propagate(struct sat *s)
+{
+	struct clist *w;
+	struct clause *c;
+	int fl, i, j, k;
+
+	while (s->qhead < s->ntrail) {
+		fl = s->trail[s->qhead++] ^ 1;
+		w = &s->watch[fl];
+		for (i = j = 0; i < w->n;) {
+			c = w->c[i++];
+			if (c->lits[0] == fl) {
+				c->lits[0] = c->lits[1];
+				c->lits[1] = fl;
+			}
+			if (lit_val(s, c->lits[0]) == 1) {
+				w->c[j++] = c;
+				continue;
+			}
+			for (k = 2; k < c->n && !lit_val(s, c->lits[k]); k++)
+				;
+			if (k < c->n) {
+				c->lits[1] = c->lits[k];
+				c->lits[k] = fl;
+				push(&s->watch[c->lits[1]], c);
+				continue;
+			}
+			w->c[j++] = c;
+			if (!lit_val(s, c->lits[0])) {
+				while (i < w->n)
+					w->c[j++] = w->c[i++];
+				w->n = j;
+				s->qhead = s->ntrail;
+				return c;
+			}
+			enqueue(s, c->lits[0], c);
+		}
+		w->n = j;
+	}
+	return NULL;
+}
+
+/* Whether false literal l of a learnt clause follows from the others. */
+static int redundant(struct sat *s, int l)
+{
+	struct clause *r = s->reason[l >> 1];
+	int v;
+
+	if (!r)
+		return 0;
+	for (int k = 1; k < r->n; k++) {
+		v = r->lits[k] >> 1;
+		if (!s->seen[v] && s->level[v])
+			return 0;
+	}
+	return 1;
+}
+
+static void bump(struct sat *s, int v)
+{
+	if ((s->act[v] += s->inc) > 1e100) {
+		for (int i = 0; i < s->nvars; i++)
+			s->act[i] *= 1e-100;
+		s->inc *= 1e-100;
+	}
+	if (s->hpos[v] >= 0)
+		heap_up(s, s->hpos[v]);
+}
+
+/*
+ * Learns the first UIP clause of a conflict into tmp, asserting literal
+ * first and one of the highest level after it. Literals implied by the
+ * others are left out. Returns the level to go back to.
+ */
+static int analyze(struct sat *s, struct clause *confl)
+{
+	int pathc = 0, p = -1, idx = s->ntrail - 1, q, v, lvl = 0, at = 1, n;
+
+	s->ntmp = 1;
+	do {
+		for (int k = p < 0 ? 0 : 1; k < confl->n; k++) {
+			q = confl->lits[k];
+			v = q >> 1;
+			if (s->seen[v] || !s->level[v])
+				continue;
+			bump(s, v);
+			s->seen[v] = 1;
+			if (s->level[v] >= s->nlims)
+				pathc++;
+			else
+				s->tmp[s->ntmp++] = q;
+		}
+		while (!s->seen[s->trail[idx] >> 1])
+			idx--;
+		p = s->trail[idx--];
+		confl = s->reason[p >> 1];
+		s->seen[p >> 1] = 0;
+	} while (--pathc > 0);
+	s->tmp[0] = p ^ 1;
+
+	/* dropped literals are swapped past the end, to be unmarked */
+	n = s->ntmp;
+	s->ntmp = 1;
+	for (int i = 1; i < n; i++) {
+		if (!redundant(s, s->tmp[i])) {
+			q = s->tmp[s->ntmp];
+			s->tmp[s->ntmp++] = s->tmp[i];
+			s->tmp[i] = q;
+		}
+	}
+	for (int i = 1; i < n; i++)
+		s->seen[s->tmp[i] >> 1] = 0;
+
+	for (int i = 1; i < s->ntmp; i++) {
+		if (s->level[s->tmp[i] >> 1] > lvl) {
+			lvl = s->level[s->tmp[i] >> 1];
+			at = i;
+		}
+	}
+	if (s->ntmp > 1) {
+		q = s->tmp[1];
+		s->tmp[1] = s->tmp[at];
+		s->tmp[at] = q;
+	}
+	return lvl;
+}
+
+/* The number of levels in tmp, which learnt clauses are ranked by. */
+static int count_levels(struct sat *s)
+{
+	int n = 0, lvl;
+
+	s->nstamp++;
+	for (int i = 0; i < s->ntmp; i++) {
+		lvl = s->level[s->tmp[i] >> 1];
+		if (s->stamp[lvl] != s->nstamp) {
+			s->stamp[lvl] = s->nstamp;
+			n++;
+		}
+	}
+	return n;
+}
+
+static int locked(struct sat *s, struct clause *c)
+{
+	return s->reason[c->lits[0] >> 1] == c && lit_val(s, c->lits[0]) == 1;
+}
+
+static int cmp_lbd(const void *a, const void *b)
+{
+	const struct clause *x = *(struct clause *const *)a;
+	const struct clause *y = *(struct clause *const *)b;
+
+	return x->lbd != y->lbd ? x->lbd - y->lbd : x->n - y->n;
+}
+
+/*
+ * Deletes the worse half of the learnt clauses, keeping those over few
+ * levels and those that are reasons.
+ */
+static void reduce(struct sat *s)
+{
+	struct clist *w;
+	struct clause *c;
+	int n = 0;
+
+	qsort(s->learnts.c, s->learnts.n, sizeof(*s->learnts.c), cmp_lbd);
+	for (int i = s->learnts.n / 2; i < s->learnts.n; i++) {
+		c = s->learnts.c[i];
+		if (c->lbd > 2 && !locked(s, c))
+			c->lbd = -1;
+	}
+	for (int l = 0; l < 2 * s->nvars; l++) {
+		w = &s->watch[l];
+		n = 0;
+		for (int i = 0; i < w->n; i++) {
+			if (w->c[i]->lbd >= 0)
+				w->c[n++] = w->c[i];
+		}
+		w->n = n;
+	}
+	n = 0;
+	for (int i = 0; i < s->learnts.n; i++) {
+		c = s->learnts.c[i];
+		if (c->lbd < 0)
+			free(c);
+		else
+			s->learnts.c[n++] = c;
+	}
+	s->learnts.n = n;
+	s->next_reduce = s->conflicts + REDUCE_BASE
+	    + (long)REDUCE_STEP * ++s->nreduce;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* Adds a clause of DIMACS literals, between calls to sat_solve. */
+void sat_add(struct sat *s, const int *lits, int n)
+{
+	int *c = malloc((n + 1) * sizeof(*c)), m = 0, l, v;
+
+	backtrack(s, 0);
+	for (int i = 0; i < n; i++) {
+		v = abs(lits[i]) - 1;
+		grow(s, v + 1);
+		c[i] = 2 * v + (lits[i] < 0);
+	}
+	/* complementary literals are adjacent once sorted */
+	qsort(c, n, sizeof(*c), cmp_int);
+	for (int i = 0; i < n; i++) {
+		l = c[i];
+		if (lit_val(s, l) == 1 || (m && c[m - 1] == (l ^ 1)))
+			goto out;
+		if (!lit_val(s, l) || (m && c[m - 1] == l))
+			continue;
+		c[m++] = l;
+	}
+
+	if (!m)
+		s->unsat = 1;
+	else if (m == 1) {
+		enqueue(s, c[0], NULL);
+		if (propagate(s))
+			s->unsat = 1;
+	} else {
+		new_clause(s, c, m, 0);
+	}
+ out:
+	free(c);
+}
+
+/* Restart intervals 1, 1, 2, 1, 1, 2, 4, ... */
+static long luby(int i)
+{
+	long size = 1;
+	int seq = 0;
+
+	while (size < i + 1) {
+		seq++;
+		size = 2 * size + 1;
+	}
+	while (size - 1 != i) {
+		size = (size - 1) >> 1;
+		seq--;
+		i %= size;
+	}
+	return 1L << seq;
+}
+
+/* Returns SAT_UNKNOWN after max_conflicts conflicts, unless zero. */
+int sat_solve(struct sat *s, long max_conflicts)
+{
+	struct clause *c;
+	long since = 0, limit = max_conflicts ? s->conflicts + max_conflicts
+	    : 0;
+	int restarts = 0, lvl, v;
+
+	backtrack(s, 0);
+	if (s->unsat || propagate(s)) {
+		s->unsat = 1;
+		return SAT_UNSAT;
+	}
+
+	for (;;) {
+		if ((c = propagate(s))) {
+			s->conflicts++;
+			since++;
+			if (!s->nlims) {
+				s->unsat = 1;
+				return SAT_UNSAT;
+			}
+			lvl = analyze(s, c);
+			backtrack(s, lvl);
+			if (s->ntmp == 1)
+				enqueue(s, s->tmp[0], NULL);
+			else
+				enqueue(s, s->tmp[0],
+					new_clause(s, s->tmp, s->ntmp,
+						   count_levels(s)));
+			s->inc /= VAR_DECAY;
+			if (limit && s->conflicts >= limit) {
+				backtrack(s, 0);
+				return SAT_UNKNOWN;
+			}
+			continue;
+		}
+
+		if (since >= RESTART_BASE * luby(restarts)) {
+			backtrack(s, 0);
+			since = 0;
+			restarts++;
+			if (s->conflicts >= s->next_reduce)
+				reduce(s);
+			continue;
+		}
+
+		do {
+			v = s->nheap ? heap_pop(s) : -1;
+		} while (v >= 0 && s->val[v] >= 0);
+		if (v < 0)
+			return SAT_SAT;
+		s->lims[s->nlims++] = s->ntrail;
+		enqueue(s, 2 * v + !s->phase[v], NULL);
+	}
+}
+
+/* The value of var in the model found by the last sat_solve. */
+int sat_value(struct sat *s, int var)
+{
+	return var >= 1 && var <= s->nvars && s->val[var - 1] == 1;
+}
+
+int sat_vars(struct sat *s)
+{
+	return s->nvars;
+}
+
+long sat_conflicts(struct sat *s)
+{
+	return s->conflicts;
+}
+
+/* Reads a problem in DIMACS CNF. */
+struct sat *sat_load(const char *path, char *errbuf, size_t errbufsz)
+{
+	struct sat *s;
+	FILE *f;
+	int *lits = NULL, n = 0, cap = 0, x, ch;
+
+	if (!(f = fopen(path, "r"))) {
+		snprintf(errbuf, errbufsz, "unable to open %s", path);
+		return NULL;
+	}
+	s = sat_new();
+	while ((ch = getc(f)) != EOF) {
+		if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+			continue;
+		if (ch == 'c' || ch == 'p' || ch == '%') {
+			/* comments, and the header, which sizes nothing */
+			while ((ch = getc(f)) != EOF && ch != '\n')
+				;
+			continue;
+		}
+		ungetc(ch, f);
+		if (fscanf(f, "%d", &x) != 1) {
+			snprintf(errbuf, errbufsz, "%s: invalid literal",
+				 path);
+			sat_destroy(s);
+			s = NULL;
+			break;
+		}
+		if (!x) {
+			sat_add(s, lits, n);
+			n = 0;
+			continue;
+		}
+		if (n == cap) {
+			cap = cap ? 2 * cap : 16;
+			lits = realloc(lits, cap * sizeof(*lits));
+		}
+		lits[n++] = x;
+	}
+	if (s && n)
+		sat_add(s, lits, n);
+	free(lits);
+	fclose(f);
+	return s;
+}
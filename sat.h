@@ -0,0 +1,29 @@
+#ifndef SAT_H
+#define SAT_H
+
+#include <stddef.h>
+
+enum {
+	SAT_UNSAT,
+	SAT_SAT,
+	SAT_UNKNOWN,
+};
+
+/*
+ * A CDCL solver: two watched literals per clause, VSIDS decisions with
+ * saved phases, minimized first UIP clauses, Luby restarts and deletion
+ * of learnt clauses spanning many levels. Variables are numbered from 1
+ * and literals are DIMACS style, -v meaning not v.
+ */
+struct sat;
+
+struct sat *sat_new(void);
+void sat_destroy(struct sat *s);
+void sat_add(struct sat *s, const int *lits, int n);
+int sat_solve(struct sat *s, long max_conflicts);
+int sat_value(struct sat *s, int var);
+int sat_vars(struct sat *s);
+long sat_conflicts(struct sat *s);
+struct sat *sat_load(const char *path, char *errbuf, size_t errbufsz);
+
+#endif
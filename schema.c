@@ -0,0 +1,608 @@
+#include "schema.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "syntax.h"
+
+#define TURNSTILE TURNSTILE_STR
+#define ELLIPSIS "..."
+
+struct cdata {
+	struct schema *s;
+	char *errbuf;
+	size_t errbufsz;
+};
+
+static void destroy_pat(struct pat *pat)
+{
+	if (!pat)
+		return;
+	destroy_pat(pat->lhs);
+	destroy_pat(pat->rhs);
+	free(pat);
+}
+
+static struct pat *compile_pat(struct cdata *c, struct ast *form, int bind)
+{
+	struct pat *pat;
+	int var;
+
+	pat = calloc(1, sizeof(*pat));
+	pat->type = form->type;
+	pat->var = -1;
+
+	if (form->type == FORM_NAME) {
+		for (var = 0; var < c->s->nvars; var++) {
+			if (strcmp(c->s->vars[var], form->text) == 0)
+				break;
+		}
+		if (var == c->s->nvars) {
+			if (!bind) {
+				snprintf(c->errbuf, c->errbufsz,
+					 "unbound metavariable %s",
+					 form->text);
+				free(pat);
+				return NULL;
+			}
+			if (var == SCHEMA_MAX_VARS) {
+				snprintf(c->errbuf, c->errbufsz,
+					 "too many metavariables");
+				free(pat);
+				return NULL;
+			}
+			c->s->vars[c->s->nvars++] = strdup(form->text);
+		}
+		pat->var = var;
+		return pat;
+	}
+
+	if (form->lhs && !(pat->lhs = compile_pat(c, form->lhs, bind)))
+		goto err;
+	if (form->rhs && !(pat->rhs = compile_pat(c, form->rhs, bind)))
+		goto err;
+	return pat;
+
+ err:
+	destroy_pat(pat);
+	return NULL;
+}
+
+/* Nodes of a pattern other than its metavariables. */
+static int pat_nodes(struct pat *pat)
+{
+	if (pat->var >= 0)
+		return 0;
+	return 1 + (pat->lhs ? pat_nodes(pat->lhs) : 0)
+	    + (pat->rhs ? pat_nodes(pat->rhs) : 0);
+}
+
+static struct pat *compile_form(struct cdata *c, const char *text,
+				size_t length, int bind)
+{
+	struct ast *form;
+	struct pat *pat;
+
+	form = parse_form(text, length, c->errbuf, c->errbufsz);
+	if (!form)
+		return NULL;
+	pat = compile_pat(c, form, bind);
+	ast_destroy(form);
+	return pat;
+}
+
+static const char *trim(const char **end, const char *text)
+{
+	while (text < *end && (*text == ' ' || *text == '\t'))
+		text++;
+	while (*end > text && ((*end)[-1] == ' ' || (*end)[-1] == '\t'))
+		(*end)--;
+	return text;
+}
+
+static int compile_slot(struct cdata *c, struct slot *slot, const char *text,
+			const char *end)
+{
+	const char *dots;
+
+	text = trim(&end, text);
+
+	if (text < end && *text == '[') {
+		if (end[-1] != ']') {
+			snprintf(c->errbuf, c->errbufsz, "unterminated box");
+			return 0;
+		}
+		text++;
+		end--;
+		dots = strstr(text, ELLIPSIS);
+		if (!dots || dots >= end) {
+			snprintf(c->errbuf, c->errbufsz,
+				 "expected " ELLIPSIS " in box");
+			return 0;
+		}
+		slot->type = INPUT_BOX;
+		slot->first = compile_form(c, text, dots - text, 1);
+		if (!slot->first)
+			return 0;
+		dots += strlen(ELLIPSIS);
+		slot->last = compile_form(c, dots, end - dots, 1);
+		return !!slot->last;
+	}
+
+	if (text < end && *text == '?') {
+		text++;
+		slot->type = INPUT_FORM;
+	} else {
+		slot->type = INPUT_LINE;
+	}
+
+	slot->first = compile_form(c, text, end - text, 1);
+	return !!slot->first;
+}
+
+struct schema *schema_compile(const char *text, char *errbuf, size_t errbufsz)
+{
+	const char *ts, *comma, *end;
+	struct cdata c;
+	int cap = 4;
+
+	c.s = calloc(1, sizeof(*c.s));
+	c.errbuf = errbuf;
+	c.errbufsz = errbufsz;
+
+	ts = strstr(text, TURNSTILE);
+	if (!ts) {
+		snprintf(errbuf, errbufsz, "expected " TURNSTILE);
+		goto err;
+	}
+
+	c.s->slots = calloc(cap, sizeof(*c.s->slots));
+
+	end = ts;
+	text = trim(&end, text);
+	while (text < end) {
+		comma = memchr(text, ',', end - text);
+		if (!comma)
+			comma = end;
+		if (c.s->nslots == cap) {
+			cap *= 2;
+			c.s->slots = realloc(c.s->slots,
+					     cap * sizeof(*c.s->slots));
+		}
+		memset(&c.s->slots[c.s->nslots], 0, sizeof(struct slot));
+		if (!compile_slot(&c, &c.s->slots[c.s->nslots++], text, comma))
+			goto err;
+		text = comma < end ? comma + 1 : end;
+	}
+
+	text = ts + strlen(TURNSTILE);
+	c.s->concl = compile_form(&c, text, strlen(text), 0);
+	if (!c.s->concl)
+		goto err;
+	c.s->concl_nodes = c.s->concl->var >= 0 ? 1 : pat_nodes(c.s->concl);
+
+	return c.s;
+
+ err:
+	schema_destroy(c.s);
+	return NULL;
+}
+
+void schema_destroy(struct schema *s)
+{
+	if (!s)
+		return;
+	for (int i = 0; i < s->nslots; i++) {
+		destroy_pat(s->slots[i].first);
+		destroy_pat(s->slots[i].last);
+	}
+	for (int i = 0; i < s->nvars; i++)
+		free(s->vars[i]);
+	destroy_pat(s->concl);
+	free(s->slots);
+	free(s);
+}
+
+static inline int bind(struct pat *pat, struct ast *form, struct ast **binds)
+{
+	if (binds[pat->var])
+		return ast_equal(binds[pat->var], form);
+	binds[pat->var] = form;
+	return 1;
+}
+
+int pat_match(struct pat *pat, struct ast *form, struct ast **binds)
+{
+	if (pat->var >= 0)
+		return bind(pat, form, binds);
+
+	if (pat->type != form->type)
+		return 0;
+	if (pat->lhs) {
+		if (pat->lhs->var >= 0) {
+			if (!bind(pat->lhs, form->lhs, binds))
+				return 0;
+		} else if (!pat_match(pat->lhs, form->lhs, binds)) {
+			return 0;
+		}
+	}
+	if (pat->rhs) {
+		if (pat->rhs->var >= 0)
+			return bind(pat->rhs, form->rhs, binds);
+		return pat_match(pat->rhs, form->rhs, binds);
+	}
+	return 1;
+}
+
+struct ast *pat_build(struct pat *pat, struct ast **binds)
+{
+	struct ast *form;
+
+	if (pat->var >= 0)
+		return ast_copy(binds[pat->var]);
+
+	form = calloc(1, sizeof(*form));
+	form->type = pat->type;
+	if (pat->lhs)
+		form->lhs = pat_build(pat->lhs, binds);
+	if (pat->rhs)
+		form->rhs = pat_build(pat->rhs, binds);
+	return form;
+}
+
+static int form_size(struct ast *form, long *nodes)
+{
+	int l = 0, r = 0;
+
+	(*nodes)++;
+	if (form->lhs)
+		l = form_size(form->lhs, nodes);
+	if (form->rhs)
+		r = form_size(form->rhs, nodes);
+	return 1 + (l > r ? l : r);
+}
+
+/* The nodes and depth of what build gives, without building it. */
+static int size(struct pat *pat, struct ast **binds, long *nodes)
+{
+	int l = 0, r = 0;
+
+	if (pat->var >= 0)
+		return form_size(binds[pat->var], nodes);
+	(*nodes)++;
+	if (pat->lhs)
+		l = size(pat->lhs, binds, nodes);
+	if (pat->rhs)
+		r = size(pat->rhs, binds, nodes);
+	return 1 + (l > r ? l : r);
+}
+
+/*
+ * Builds a conclusion in preorder from the nodes at *next, so the root is
+ * the first one. Metavariables share the formulas bound to them.
+ */
+static struct ast *build(struct pat *pat, struct ast **binds,
+			 struct ast **next)
+{
+	struct ast *form;
+
+	if (pat->var >= 0)
+		return binds[pat->var];
+
+	form = (*next)++;
+	memset(form, 0, sizeof(*form));
+	form->type = pat->type;
+	if (pat->lhs)
+		form->lhs = build(pat->lhs, binds, next);
+	if (pat->rhs)
+		form->rhs = build(pat->rhs, binds, next);
+	return form;
+}
+
+static int invalid(struct proof *p)
+{
+	p->err = ERR_INPUTS;
+	snprintf(p->errbuf, sizeof(p->errbuf), "invalid rule inputs");
+	return 0;
+}
+
+static int out_of_scope(struct proof *p)
+{
+	p->err = ERR_SCOPE;
+	snprintf(p->errbuf, sizeof(p->errbuf), "input not in scope");
+	return 0;
+}
+
+int schema_apply(struct schema *s, struct proof *p, struct ast *cmd)
+{
+	struct ast *binds[SCHEMA_MAX_VARS];
+	struct ast *in = cmd->rhs, *out, *next;
+	struct box *box;
+	struct slot *slot;
+	long nodes = 0;
+	int depth;
+
+	for (int i = 0; i < s->nvars; i++)
+		binds[i] = NULL;
+
+	for (int i = 0; i < s->nslots; i++, in = in->rhs) {
+		slot = &s->slots[i];
+		if (!in || in->type != slot->type)
+			return invalid(p);
+
+		switch (slot->type) {
+		case INPUT_LINE:
+			if (!can_ref_ln(p, in->start))
+				return out_of_scope(p);
+			if (!pat_match(slot->first, p->lns[in->start].form,
+				       binds))
+				return invalid(p);
+			break;
+		case INPUT_BOX:
+			if (!can_ref_box(p, in->start, in->end))
+				return out_of_scope(p);
+			box = get_box_with_range(p, in->start, in->end);
+			if (!pat_match(slot->first, p->lns[box->start].form,
+				       binds)
+			    || !pat_match(slot->last, p->lns[box->end].form,
+					  binds))
+				return invalid(p);
+			break;
+		case INPUT_FORM:
+			if (!pat_match(slot->first, in->lhs, binds))
+				return invalid(p);
+			break;
+		}
+	}
+
+	if (in)
+		return invalid(p);
+
+	/*
+	 * A conclusion over the limits is never built. One within them
+	 * takes a single allocation, freed as one by destroy_proof: the
+	 * nodes of the pattern, sharing the rest with the inputs, which
+	 * live as long as the proof. A bare metavariable copies the root
+	 * of its formula.
+	 */
+	depth = size(s->concl, binds, &nodes);
+	if (nodes > INT_MAX)
+		nodes = INT_MAX;
+	if (!proof_fits(p, nodes, depth))
+		return 0;
+	next = malloc(s->concl_nodes * sizeof(*next));
+	if (s->concl->var >= 0)
+		*next = *binds[s->concl->var];
+	out = s->concl->var >= 0 ? next : build(s->concl, binds, &next);
+	pushln_fitted(p, cmd, out, nodes);
+	return 1;
+}
+
+/* The formula a pattern stands for, with metavariables as atoms. */
+struct ast *pat_to_ast(struct schema *s, struct pat *pat)
+{
+	struct ast *form;
+
+	form = calloc(1, sizeof(*form));
+	form->type = pat->type;
+	if (pat->var >= 0)
+		form->text = strdup(s->vars[pat->var]);
+	if (pat->lhs)
+		form->lhs = pat_to_ast(s, pat->lhs);
+	if (pat->rhs)
+		form->rhs = pat_to_ast(s, pat->rhs);
+	return form;
+}
+
+#define INFER_MAX_STEPS (1 << 16)
+
+/*
+ * Search state for inferring the inputs of a rule. Slots are filled most
+ * constrained first, and candidate lines come from the index: a slot
+ * whose pattern is fully bound is a hash lookup, otherwise only lines
+ * with the right main connective are tried.
+ */
+struct infer {
+	struct schema *s;
+	struct proof *p;
+	struct ast *binds[SCHEMA_MAX_VARS];
+	int *start;
+	int *end;
+	int nsols;
+	struct ast *sols[2];
+	struct ast *concl;
+	int unbound;
+	int steps;
+};
+
+static int ground(struct pat *pat, struct ast **binds)
+{
+	if (pat->var >= 0)
+		return !!binds[pat->var];
+	return (!pat->lhs || ground(pat->lhs, binds))
+	    && (!pat->rhs || ground(pat->rhs, binds));
+}
+
+static int cost(struct infer *in, struct slot *slot)
+{
+	if (slot->type == INPUT_BOX)
+		return 2;
+	if (ground(slot->first, in->binds))
+		return 0;
+	return slot->first->var >= 0 ? 3 : 1;
+}
+
+static struct ast *input(int type, int start, int end, struct ast *form)
+{
+	struct ast *inp;
+
+	inp = calloc(1, sizeof(*inp));
+	inp->type = type;
+	inp->start = start;
+	inp->end = end;
+	inp->lhs = form;
+	return inp;
+}
+
+/* Records the filled slots as a solution, keeping one per conclusion. */
+static void solution(struct infer *in)
+{
+	struct schema *s = in->s;
+	struct ast *inputs = NULL, **tail = &inputs, *concl;
+	struct slot *slot;
+
+	for (int i = 0; i < s->nslots; i++) {
+		slot = &s->slots[i];
+		if (slot->type == INPUT_FORM && !ground(slot->first, in->binds)) {
+			in->unbound = 1;
+			ast_destroy(inputs);
+			return;
+		}
+		*tail = input(slot->type, in->start[i], in->end[i],
+			      slot->type == INPUT_FORM
+			      ? pat_build(slot->first, in->binds) : NULL);
+		tail = &(*tail)->rhs;
+	}
+
+	concl = pat_build(s->concl, in->binds);
+	if (in->nsols && ast_equal(in->concl, concl)) {
+		ast_destroy(concl);
+		ast_destroy(inputs);
+		return;
+	}
+	if (!in->nsols)
+		in->concl = concl;
+	else
+		ast_destroy(concl);
+	in->sols[in->nsols++] = inputs;
+}
+
+static void search(struct infer *in)
+{
+	struct schema *s = in->s;
+	struct proof *p = in->p;
+	struct ast *saved[SCHEMA_MAX_VARS];
+	struct slot *slot;
+	struct ast *form;
+	struct box *b;
+	int *lines, n, best = -1, c, bestc = 4;
+
+	if (in->nsols == 2 || ++in->steps > INFER_MAX_STEPS)
+		return;
+
+	for (int i = 0; i < s->nslots; i++) {
+		if (s->slots[i].type == INPUT_FORM || in->start[i] >= 0)
+			continue;
+		c = cost(in, &s->slots[i]);
+		if (c < bestc) {
+			best = i;
+			bestc = c;
+		}
+	}
+
+	if (best < 0) {
+		solution(in);
+		return;
+	}
+
+	slot = &s->slots[best];
+	memcpy(saved, in->binds, s->nvars * sizeof(*saved));
+
+	if (slot->type == INPUT_BOX) {
+		for (b = p->boxes; b && in->nsols < 2; b = b->next) {
+			if (!can_ref_box(p, b->start, b->end))
+				continue;
+			if (pat_match(slot->first, p->lns[b->start].form,
+				      in->binds)
+			    && pat_match(slot->last, p->lns[b->end].form,
+					 in->binds)) {
+				in->start[best] = b->start;
+				in->end[best] = b->end;
+				search(in);
+			}
+			memcpy(in->binds, saved, s->nvars * sizeof(*saved));
+		}
+		in->start[best] = -1;
+		return;
+	}
+
+	lines = malloc((p->idx.nents + 1) * sizeof(*lines));
+	if (bestc == 0) {
+		form = pat_build(slot->first, in->binds);
+		n = index_match(p, form, lines, p->idx.nents);
+		ast_destroy(form);
+	} else {
+		n = index_lines(p, bestc == 3 ? -1 : slot->first->type, lines,
+				p->idx.nents);
+	}
+
+	for (int i = 0; i < n && in->nsols < 2; i++) {
+		if (pat_match(slot->first, p->lns[lines[i]].form, in->binds)) {
+			in->start[best] = lines[i];
+			in->end[best] = -1;
+			search(in);
+		}
+		memcpy(in->binds, saved, s->nvars * sizeof(*saved));
+	}
+	in->start[best] = -1;
+	free(lines);
+}
+
+/*
+ * Fills in the inputs of an apply command given without any, searching
+ * the lines and boxes in scope. The rule node may hold a requested
+ * conclusion. Fails if no inputs fit or if they could give different
+ * conclusions.
+ */
+int schema_infer(struct schema *s, struct proof *p, struct ast *cmd)
+{
+	struct infer in = { 0 };
+	struct ast *goal = cmd->lhs->lhs;
+	char buf1[128], buf2[128];
+
+	in.s = s;
+	in.p = p;
+	p->err = ERR_INPUTS;
+
+	if (goal && !pat_match(s->concl, goal, in.binds)) {
+		snprintf(p->errbuf, sizeof(p->errbuf),
+			 "rule cannot conclude the requested formula");
+		return 0;
+	}
+
+	in.start = malloc(2 * s->nslots * sizeof(int));
+	in.end = in.start + s->nslots;
+	for (int i = 0; i < s->nslots; i++)
+		in.start[i] = -1;
+
+	search(&in);
+	free(in.start);
+	ast_destroy(in.concl);
+
+	if (in.nsols == 1) {
+		p->err = ERR_OK;
+		cmd->rhs = in.sols[0];
+		return 1;
+	}
+
+	if (in.nsols == 2) {
+		print_inputs(in.sols[0], buf1, sizeof(buf1));
+		print_inputs(in.sols[1], buf2, sizeof(buf2));
+		snprintf(p->errbuf, sizeof(p->errbuf),
+			 "ambiguous inputs, e.g. %s or %s", buf1, buf2);
+		ast_destroy(in.sols[0]);
+		ast_destroy(in.sols[1]);
+	} else if (in.steps > INFER_MAX_STEPS) {
+		snprintf(p->errbuf, sizeof(p->errbuf),
+			 "too many candidate inputs, give some explicitly");
+	} else if (in.unbound) {
+		snprintf(p->errbuf, sizeof(p->errbuf),
+			 "unable to infer formula input, request a conclusion "
+			 "with " GOAL_STR);
+	} else {
+		snprintf(p->errbuf, sizeof(p->errbuf),
+			 "no inputs in scope fit the rule");
+	}
+	return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <stddef.h>
+#include "proof.h"
+
+#define SCHEMA_MAX_VARS 16
+
+/*
+ * A rule schema such as "A, A => B |- B" or "[A ... B] |- A => B",
+ * compiled into patterns over metavariables. Every name in a schema is a
+ * metavariable; "?A" marks an input given as a formula rather than as a
+ * line reference.
+ */
+struct pat {
+	int type;
+	int var;
+	struct pat *lhs;
+	struct pat *rhs;
+};
+
+struct slot {
+	int type;
+	struct pat *first;
+	struct pat *last;
+};
+
+struct schema {
+	struct slot *slots;
+	int nslots;
+	struct pat *concl;
+	int concl_nodes;	/* allocated for each conclusion */
+	int nvars;
+	char *vars[SCHEMA_MAX_VARS];
+};
+
+struct schema *schema_compile(const char *text, char *errbuf,
+			      size_t errbufsz);
+void schema_destroy(struct schema *s);
+int schema_apply(struct schema *s, struct proof *p, struct ast *cmd);
+int schema_infer(struct schema *s, struct proof *p, struct ast *cmd);
+int pat_match(struct pat *pat, struct ast *form, struct ast **binds);
+struct ast *pat_build(struct pat *pat, struct ast **binds);
+struct ast *pat_to_ast(struct schema *s, struct pat *pat);
+
+#endif
@@ -0,0 +1,177 @@
+#include "sem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "term.h"
+
+struct sem {
+	struct term **atoms;
+	int natoms;
+	int *index;		/* atom by term id, plus one */
+	int nindex;
+	int words;
+	uint64_t **vecs;	/* by term id */
+	int nvecs;
+};
+
+/* A fixed sequence, so that pruning does not vary between runs. */
+static uint64_t xorshift(uint64_t *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+/* The bits of valuation w * 64 + j where atom i is true. */
+static uint64_t pattern(int i, int w)
+{
+	static const uint64_t low[6] = {
+		0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL,
+		0xf0f0f0f0f0f0f0f0ULL, 0xff00ff00ff00ff00ULL,
+		0xffff0000ffff0000ULL, 0xffffffff00000000ULL,
+	};
+
+	if (i < 6)
+		return low[i];
+	return (w >> (i - 6)) & 1 ? ~0ULL : 0;
+}
+
+struct sem *sem_new(struct term **atoms, int natoms)
+{
+	struct sem *s;
+	uint64_t x = 0x9e3779b97f4a7c15ULL;
+	uint64_t *v;
+
+	s = calloc(1, sizeof(*s));
+	s->atoms = malloc((natoms + 1) * sizeof(*s->atoms));
+	memcpy(s->atoms, atoms, natoms * sizeof(*atoms));
+	s->natoms = natoms;
+	if (natoms > SEM_MAX_ATOMS)
+		s->words = SEM_SAMPLE_WORDS;
+	else
+		s->words = natoms > 6 ? 1 << (natoms - 6) : 1;
+
+	for (int i = 0; i < natoms; i++) {
+		if (atoms[i]->id >= s->nindex)
+			s->nindex = atoms[i]->id + 1;
+	}
+	s->index = calloc(s->nindex, sizeof(*s->index));
+	s->nvecs = s->nindex;
+	s->vecs = calloc(s->nvecs, sizeof(*s->vecs));
+	for (int i = 0; i < natoms; i++) {
+		s->index[atoms[i]->id] = i + 1;
+		v = malloc(s->words * sizeof(*v));
+		for (int w = 0; w < s->words; w++)
+			v[w] = natoms > SEM_MAX_ATOMS ? xorshift(&x)
+			    : pattern(i, w);
+		s->vecs[atoms[i]->id] = v;
+	}
+	return s;
+}
+
+void sem_destroy(struct sem *s)
+{
+	if (!s)
+		return;
+	for (int i = 0; i < s->nvecs; i++)
+		free(s->vecs[i]);
+	free(s->vecs);
+	free(s->index);
+	free(s->atoms);
+	free(s);
+}
+
+int sem_words(struct sem *s)
+{
+	return s->words;
+}
+
+/* The table of t, or NULL if t has an atom the tables are not over. */
+const uint64_t *sem_eval(struct sem *s, struct term *t)
+{
+	const uint64_t *a = NULL, *b = NULL;
+	uint64_t *v;
+	int old = s->nvecs;
+
+	if (t->id < s->nvecs && s->vecs[t->id])
+		return s->vecs[t->id];
+	if (t->type == FORM_NAME)
+		return NULL;
+	if (t->lhs && !(a = sem_eval(s, t->lhs)))
+		return NULL;
+	if (t->rhs && !(b = sem_eval(s, t->rhs)))
+		return NULL;
+
+	if (t->id >= s->nvecs) {
+		s->nvecs = t->id + 256;
+		s->vecs = realloc(s->vecs, s->nvecs * sizeof(*s->vecs));
+		memset(s->vecs + old, 0, (s->nvecs - old) * sizeof(*s->vecs));
+	}
+	v = malloc(s->words * sizeof(*v));
+	for (int w = 0; w < s->words; w++) {
+		switch (t->type) {
+		case FORM_NOT:
+			v[w] = ~a[w];
+			break;
+		case FORM_AND:
+			v[w] = a[w] & b[w];
+			break;
+		case FORM_OR:
+			v[w] = a[w] | b[w];
+			break;
+		case FORM_IMPL:
+			v[w] = ~a[w] | b[w];
+			break;
+		default:
+			v[w] = 0;
+			break;
+		}
+	}
+	s->vecs[t->id] = v;
+	return v;
+}
+
+/* Index of a valuation in models where t is false, or -1. */
+static int falsifier(struct sem *s, const uint64_t *models, struct term *t)
+{
+	const uint64_t *v = sem_eval(s, t);
+	uint64_t m;
+
+	if (!v)
+		return -1;
+	for (int w = 0; w < s->words; w++) {
+		if ((m = models[w] & ~v[w]))
+			return w * 64 + __builtin_ctzll(m);
+	}
+	return -1;
+}
+
+/* Whether t is false under one of the valuations in models, which makes
+ * it no consequence of the formulas they are models of. */
+int sem_refutes(struct sem *s, const uint64_t *models, struct term *t)
+{
+	return falsifier(s, models, t) >= 0;
+}
+
+/* The valuation sem_refutes found, as "p = T, q = F", or NULL. */
+char *sem_model(struct sem *s, const uint64_t *models, struct term *t)
+{
+	const uint64_t *v;
+	char *text = NULL;
+	size_t len;
+	FILE *f;
+	int k;
+
+	if ((k = falsifier(s, models, t)) < 0)
+		return NULL;
+	f = open_memstream(&text, &len);
+	for (int i = 0; i < s->natoms; i++) {
+		v = s->vecs[s->atoms[i]->id];
+		fprintf(f, "%s%s = %c", i ? ", " : "", s->atoms[i]->name,
+			v[k / 64] >> (k % 64) & 1 ? 'T' : 'F');
+	}
+	fclose(f);
+	return text;
+}
@@ -0,0 +1,29 @@
+#ifndef SEM_H
+#define SEM_H
+
+#include <stdint.h>
+
+struct term;
+
+/* Atoms up to which every valuation is tried, 64 in each word. */
+#define SEM_MAX_ATOMS 12
+/* Words of random valuations tried with more atoms than that. */
+#define SEM_SAMPLE_WORDS 8
+
+/*
+ * Truth tables of formulas over a fixed set of atoms, one bit per
+ * valuation. With more than SEM_MAX_ATOMS atoms only a sample of the
+ * valuations is kept, so a formula false somewhere is still false under
+ * some valuation, but one true everywhere need not be valid. Tables are
+ * memoized by term id. A struct sem is not shared between threads.
+ */
+struct sem;
+
+struct sem *sem_new(struct term **atoms, int natoms);
+void sem_destroy(struct sem *s);
+int sem_words(struct sem *s);
+const uint64_t *sem_eval(struct sem *s, struct term *t);
+int sem_refutes(struct sem *s, const uint64_t *models, struct term *t);
+char *sem_model(struct sem *s, const uint64_t *models, struct term *t);
+
+#endif
@@ -0,0 +1,210 @@
+#include "spec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "bdd.h"
+
+/*
+ * An exercise specification lists the premises a proof may use and the
+ * formula it has to end with:
+ *
+ *	presume <formula>
+ *	goal <formula>
+ *
+ * Blank lines and lines starting with '#' are ignored.
+ */
+
+static int wspc(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skip_wspc(const char *c, const char *end)
+{
+	while (c < end && wspc(*c))
+		c++;
+	return c;
+}
+
+/* A keyword followed by whitespace, spaces or tabs. */
+static int keyword(const char **c, const char *end, const char *kw)
+{
+	size_t n = strlen(kw);
+	if ((size_t)(end - *c) <= n || strncmp(*c, kw, n) != 0
+	    || !wspc((*c)[n]))
+		return 0;
+	*c += n;
+	return 1;
+}
+
+struct spec *spec_new(void)
+{
+	struct spec *s;
+
+	s = calloc(1, sizeof(*s));
+	s->cap = 8;
+	s->prems = malloc(s->cap * sizeof(*s->prems));
+	s->premhashes = malloc(s->cap * sizeof(*s->premhashes));
+	return s;
+}
+
+void spec_add_premise(struct spec *s, struct ast *form)
+{
+	if (s->nprems == s->cap) {
+		s->cap *= 2;
+		s->prems = realloc(s->prems, s->cap * sizeof(*s->prems));
+		s->premhashes = realloc(s->premhashes,
+					s->cap * sizeof(*s->premhashes));
+	}
+	s->premhashes[s->nprems] = ast_hash(form);
+	s->prems[s->nprems++] = form;
+}
+
+/* Sets the goal, once all premises have been added. */
+void spec_set_goal(struct spec *s, struct ast *goal)
+{
+	s->goal = goal;
+	s->hash = ast_hash(s->goal);
+	for (int i = 0; i < s->nprems; i++)
+		s->hash = (s->hash ^ s->premhashes[i]) * 0x100000001b3ULL;
+}
+
+struct spec *spec_parse(const char *text, size_t length, char *errbuf,
+			size_t errbufsz)
+{
+	const char *line, *end = text + length, *nl, *c;
+	struct ast *form, *goal = NULL;
+	struct spec *s;
+	int lnum = 0;
+	char ferr[128];
+
+	s = spec_new();
+
+	for (line = text; line < end; line = nl + 1) {
+		nl = memchr(line, '\n', end - line);
+		if (!nl)
+			nl = end;
+		lnum++;
+
+		c = skip_wspc(line, nl);
+		if (c == nl || *c == '#')
+			continue;
+
+		if (keyword(&c, nl, "presume")) {
+			form = parse_form(c, nl - c, ferr, sizeof(ferr));
+			if (!form)
+				goto err;
+			spec_add_premise(s, form);
+			continue;
+		}
+
+		if (keyword(&c, nl, "goal")) {
+			if (goal) {
+				snprintf(ferr, sizeof(ferr),
+					 "more than one goal");
+				goto err;
+			}
+			goal = parse_form(c, nl - c, ferr, sizeof(ferr));
+			if (!goal)
+				goto err;
+			continue;
+		}
+
+		snprintf(ferr, sizeof(ferr), "expected presume or goal");
+		goto err;
+	}
+
+	if (!goal) {
+		snprintf(errbuf, errbufsz, "missing goal");
+		spec_destroy(s);
+		return NULL;
+	}
+
+	spec_set_goal(s, goal);
+	return s;
+
+ err:
+	snprintf(errbuf, errbufsz, "%d: %s", lnum, ferr);
+	ast_destroy(goal);
+	spec_destroy(s);
+	return NULL;
+}
+
+struct spec *spec_load(const char *path, char *errbuf, size_t errbufsz)
+{
+	struct spec *s;
+	char *buf;
+	long n;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		snprintf(errbuf, errbufsz, "unable to read file");
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(n + 1);
+	n = fread(buf, 1, n, f);
+	fclose(f);
+
+	s = spec_parse(buf, n, errbuf, errbufsz);
+	free(buf);
+	return s;
+}
+
+void spec_destroy(struct spec *s)
+{
+	if (!s)
+		return;
+	for (int i = 0; i < s->nprems; i++)
+		ast_destroy(s->prems[i]);
+	ast_destroy(s->goal);
+	free(s->prems);
+	free(s->premhashes);
+	free(s);
+}
+
+int spec_allows_premise(struct spec *s, struct ast *form)
+{
+	uint64_t h = ast_hash(form);
+
+	for (int i = 0; i < s->nprems; i++) {
+		if (s->premhashes[i] == h && ast_equal(s->prems[i], form))
+			return 1;
+	}
+	return 0;
+}
+
+int spec_reaches_goal(struct spec *s, struct proof *p)
+{
+	struct ln *last;
+
+	if (p->boxhead || !p->nlns)
+		return 0;
+
+	last = &p->lns[p->nlns - 1];
+	return !last->box && ast_equal(last->form, s->goal);
+}
+
+/* Whether the proof ends, outside of boxes, with an equivalent of the goal. */
+int spec_ends_equivalent(struct spec *s, struct proof *p)
+{
+	struct ln *last;
+	struct bdd *m;
+	int a, b;
+
+	if (p->boxhead || !p->nlns)
+		return 0;
+
+	last = &p->lns[p->nlns - 1];
+	if (last->box)
+		return 0;
+	m = bdd_new(NULL);
+	a = bdd_of(m, last->form);
+	b = a < 0 ? -1 : bdd_of(m, s->goal);
+	bdd_destroy(m);
+	return a >= 0 && a == b;
+}
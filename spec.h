@@ -0,0 +1,28 @@
+#ifndef SPEC_H
+#define SPEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "proof.h"
+
+struct spec {
+	struct ast **prems;
+	uint64_t *premhashes;
+	int nprems;
+	int cap;
+	struct ast *goal;
+	uint64_t hash;
+};
+
+struct spec *spec_new(void);
+void spec_add_premise(struct spec *s, struct ast *form);
+void spec_set_goal(struct spec *s, struct ast *goal);
+struct spec *spec_load(const char *path, char *errbuf, size_t errbufsz);
+struct spec *spec_parse(const char *text, size_t length, char *errbuf,
+			size_t errbufsz);
+void spec_destroy(struct spec *s);
+int spec_allows_premise(struct spec *s, struct ast *form);
+int spec_reaches_goal(struct spec *s, struct proof *p);
+int spec_ends_equivalent(struct spec *s, struct proof *p);
+
+#endif
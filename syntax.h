@@ -27,4 +27,18 @@
 #define LEM_STR "LEM"
 #define COPY_STR "copy"
 
+/* Separates premises from the conclusion of a sequent or rule */
+#define TURNSTILE_STR "|-"
+
+/* Requested conclusion when inputs are left out */
+#define GOAL_STR "->"
+
+/* Options of prove, told apart from a double negation by what follows */
+#define PORTFOLIO_STR "--portfolio"
+#define MINIMAL_STR "--minimal"
+#define INTUITIONISTIC_STR "--intuitionistic"
+#define NO_PRUNE_STR "--no-prune"
+#define RESOLUTION_STR "--resolution"
+#define TABLEAU_STR "--tableau"
+
 #endif
@@ -0,0 +1,377 @@
+#include "tableau.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "parse.h"
+#include "prover.h"
+#include "term.h"
+
+struct tab_ent {
+	struct term *t;
+	struct deriv *d;
+	int sign;
+	int from;		/* the entry it was expanded from, or -1 */
+	int used;		/* by the derivation of _|_ */
+};
+
+struct tableau {
+	struct prover *pv;
+	int *at[2];		/* entry plus one by term id, for F and T */
+	struct tab_ent *ents;
+	int nents;
+	int cap;
+	struct deriv *closed;
+	char *model;		/* of the first open branch */
+};
+
+static struct deriv *seq(struct prover *pv, struct deriv *a,
+			 struct deriv *b)
+{
+	struct deriv *d = mk(pv, SEQ, b->form);
+
+	line_in(d, a);
+	line_in(d, b);
+	return d;
+}
+
+static int has(struct tableau *tb, int sign, struct term *t)
+{
+	return tb->at[sign][t->id];
+}
+
+/* The derivation of an entry, marking it and those it came from used. */
+static struct deriv *use(struct tableau *tb, int i)
+{
+	struct deriv *d = tb->ents[i].d;
+
+	for (; i >= 0 && !tb->ents[i].used; i = tb->ents[i].from)
+		tb->ents[i].used = 1;
+	return d;
+}
+
+static struct deriv *fact(struct tableau *tb, int sign, struct term *t)
+{
+	return use(tb, tb->at[sign][t->id] - 1);
+}
+
+static void tab_add(struct tableau *tb, int sign, struct term *t,
+		    struct deriv *d, int from)
+{
+	struct prover *pv = tb->pv;
+	struct term *bot = pv->sh->bot;
+	struct tab_ent *e;
+	int i = tb->nents;
+
+	if (tb->closed || has(tb, sign, t))
+		return;
+	if (has(tb, !sign, t)) {
+		if (from >= 0)
+			use(tb, from);
+		tb->closed = sign
+		    ? elim2(pv, RULE_NOT_ELIM, bot, d, fact(tb, 0, t))
+		    : elim2(pv, RULE_NOT_ELIM, bot, fact(tb, 1, t), d);
+		return;
+	}
+	if (tb->nents == tb->cap) {
+		tb->cap = tb->cap ? 2 * tb->cap : 64;
+		tb->ents = realloc(tb->ents, tb->cap * sizeof(*tb->ents));
+	}
+	e = &tb->ents[tb->nents++];
+	e->t = t;
+	e->d = d;
+	e->sign = sign;
+	e->from = from;
+	e->used = 0;
+	tb->at[sign][t->id] = tb->nents;
+
+	switch (t->type) {
+	case FORM_CON:
+		if (sign)
+			tb->closed = use(tb, i);
+		break;
+	case FORM_NOT:
+		if (sign)
+			tab_add(tb, 0, t->lhs, d, i);
+		else
+			tab_add(tb, 1, t->lhs,
+				elim1(pv, RULE_NOT_NOT_ELIM, t->lhs, d), i);
+		break;
+	case FORM_AND:
+		if (!sign)
+			break;
+		tab_add(tb, 1, t->lhs, elim1(pv, RULE_AND_ELIM_1, t->lhs, d),
+			i);
+		tab_add(tb, 1, t->rhs, elim1(pv, RULE_AND_ELIM_2, t->rhs, d),
+			i);
+		break;
+	case FORM_OR:
+		if (sign)
+			break;
+		tab_add(tb, 0, t->lhs, not_disjunct(pv, neg(pv, t),
+						    RULE_OR_INTR_1, d), i);
+		tab_add(tb, 0, t->rhs, not_disjunct(pv, neg(pv, t),
+						    RULE_OR_INTR_2, d), i);
+		break;
+	case FORM_IMPL:
+		if (sign)
+			break;
+		tab_add(tb, 1, t->lhs, not_impl(pv, neg(pv, t), 1, d), i);
+		tab_add(tb, 0, t->rhs, not_impl(pv, neg(pv, t), 0, d), i);
+		break;
+	}
+}
+
+static void tab_undo(struct tableau *tb, int mark)
+{
+	struct tab_ent *e;
+
+	while (tb->nents > mark) {
+		e = &tb->ents[--tb->nents];
+		tb->at[e->sign][e->t->id] = 0;
+	}
+	tb->closed = NULL;
+}
+
+/* The signs of the two branches of T t, or F t if !sign, or 0 if it does
+ * not branch. */
+static int beta(int sign, struct term *t, int *s)
+{
+	switch (t->type) {
+	case FORM_OR:
+		s[0] = s[1] = 1;
+		return sign;
+	case FORM_AND:
+		s[0] = s[1] = 0;
+		return !sign;
+	case FORM_IMPL:
+		s[0] = 0;
+		s[1] = 1;
+		return sign;
+	}
+	return 0;
+}
+
+/* The entry to split on next, or -1. */
+static int pick(struct tableau *tb)
+{
+	struct term *t;
+	int s[2], best = -1;
+
+	for (int i = 0; i < tb->nents; i++) {
+		t = tb->ents[i].t;
+		if (!beta(tb->ents[i].sign, t, s) || has(tb, s[0], t->lhs)
+		    || has(tb, s[1], t->rhs))
+			continue;
+		if (has(tb, !s[0], t->lhs) || has(tb, !s[1], t->rhs))
+			return i;
+		if (best < 0)
+			best = i;
+	}
+	return best;
+}
+
+/* Describes the atoms true on an open branch, the others being false. */
+static char *branch_model(struct tableau *tb)
+{
+	struct shared *sh = tb->pv->sh;
+	char *text = NULL;
+	size_t len;
+	FILE *f;
+
+	f = open_memstream(&text, &len);
+	for (int i = 0; i < sh->natoms; i++)
+		fprintf(f, "%s%s = %c", i ? ", " : "", sh->atoms[i]->name,
+			has(tb, 1, sh->atoms[i]) ? 'T' : 'F');
+	fclose(f);
+	return text;
+}
+
+static struct deriv *tab_close(struct tableau *tb);
+
+/* Closes the branch with the entries from mark on, which are then
+ * removed. Those the closure uses come first. */
+static struct deriv *tab_finish(struct tableau *tb, int mark)
+{
+	int end = tb->nents;
+	struct deriv *r = tab_close(tb);
+
+	for (int i = end - 1; i >= mark && r; i--) {
+		if (tb->ents[i].used && tb->ents[i].d->rule != HYP)
+			r = seq(tb->pv, tb->ents[i].d, r);
+	}
+	tab_undo(tb, mark);
+	return r;
+}
+
+static struct deriv *tab_with(struct tableau *tb, int sign, struct term *t,
+			      struct deriv *d)
+{
+	int mark = tb->nents;
+
+	tab_add(tb, sign, t, d, -1);
+	return tab_finish(tb, mark);
+}
+
+/* T A / B: by /e, -A being a lemma for the branch of B. */
+static struct deriv *split_or(struct tableau *tb, struct term *t,
+			      struct deriv *d)
+{
+	struct prover *pv = tb->pv;
+	struct term *a = t->lhs, *b = t->rhs, *na = neg(pv, a);
+	struct deriv *l, *r, *lem = NULL, *res;
+	int mark = tb->nents;
+
+	if (has(tb, 0, a)) {
+		l = elim2(pv, RULE_NOT_ELIM, pv->sh->bot, mk(pv, HYP, a),
+			  fact(tb, 0, a));
+	} else if (!(l = tab_with(tb, 1, a, mk(pv, HYP, a)))) {
+		return NULL;
+	} else if (!has(tb, 0, b)) {
+		lem = mk(pv, RULE_NOT_INTR, na);
+		box_in(lem, a, l);
+		l = elim2(pv, RULE_NOT_ELIM, pv->sh->bot, mk(pv, HYP, a),
+			  mk(pv, HYP, na));
+		tab_add(tb, 0, a, mk(pv, HYP, na), -1);
+	}
+	tab_add(tb, 1, b, mk(pv, HYP, b), -1);
+	if (!(r = tab_finish(tb, mark)))
+		return NULL;
+
+	res = mk(pv, RULE_OR_ELIM, pv->sh->bot);
+	line_in(res, d);
+	box_in(res, a, l);
+	box_in(res, b, r);
+	return lem ? seq(pv, lem, res) : res;
+}
+
+/* T A => B: by =>e once A is known, by MT once -B is. */
+static struct deriv *split_impl(struct tableau *tb, struct term *t,
+				struct deriv *d)
+{
+	struct prover *pv = tb->pv;
+	struct term *a = t->lhs, *b = t->rhs;
+	struct deriv *l, *lem, *r;
+	int mark = tb->nents;
+
+	if (has(tb, 1, a))
+		return tab_with(tb, 1, b, elim2(pv, RULE_IMPL_ELIM, b,
+						fact(tb, 1, a), d));
+	if (has(tb, 0, b))
+		return tab_with(tb, 0, a, elim2(pv, RULE_MT, neg(pv, a), d,
+						fact(tb, 0, b)));
+
+	if (!(l = tab_with(tb, 0, a, mk(pv, HYP, neg(pv, a)))))
+		return NULL;
+	lem = mk(pv, RULE_PBC, a);
+	box_in(lem, neg(pv, a), l);
+	tab_add(tb, 1, a, mk(pv, HYP, a), -1);
+	tab_add(tb, 1, b, elim2(pv, RULE_IMPL_ELIM, b, mk(pv, HYP, a), d), -1);
+	r = tab_finish(tb, mark);
+	return r ? seq(pv, lem, r) : NULL;
+}
+
+/* -A, or -B if left, from -(A ^ B) and a derivation x of the other. */
+static struct deriv *not_conjunct(struct prover *pv, struct term *t,
+				  struct deriv *d, struct deriv *x, int left)
+{
+	struct term *u = left ? t->rhs : t->lhs;
+	struct deriv *h = mk(pv, HYP, u), *r;
+
+	r = mk(pv, RULE_NOT_INTR, neg(pv, u));
+	box_in(r, u, elim2(pv, RULE_NOT_ELIM, pv->sh->bot,
+			   left ? elim2(pv, RULE_AND_INTR, t, x, h)
+			   : elim2(pv, RULE_AND_INTR, t, h, x), d));
+	return r;
+}
+
+/* F A ^ B: A by PBC, then -B by -i. */
+static struct deriv *split_and(struct tableau *tb, struct term *t,
+			       struct deriv *d)
+{
+	struct prover *pv = tb->pv;
+	struct term *a = t->lhs, *b = t->rhs;
+	struct deriv *l, *x, *lem = NULL;
+	int mark = tb->nents;
+
+	if (has(tb, 1, b) && !has(tb, 1, a))
+		return tab_with(tb, 0, a, not_conjunct(pv, t, d,
+						       fact(tb, 1, b), 0));
+	if (has(tb, 1, a)) {
+		x = fact(tb, 1, a);
+	} else {
+		if (!(l = tab_with(tb, 0, a, mk(pv, HYP, neg(pv, a)))))
+			return NULL;
+		lem = mk(pv, RULE_PBC, a);
+		box_in(lem, neg(pv, a), l);
+		x = mk(pv, HYP, a);
+		tab_add(tb, 1, a, x, -1);
+	}
+	tab_add(tb, 0, b, not_conjunct(pv, t, d, x, 1), -1);
+	l = tab_finish(tb, mark);
+	return l && lem ? seq(pv, lem, l) : l;
+}
+
+/* _|_ from the branch, or NULL if it stays open or the steps run out. */
+static struct deriv *tab_close(struct tableau *tb)
+{
+	struct term *t;
+	struct deriv *d;
+	int i;
+
+	if (tb->closed)
+		return tb->closed;
+	if ((i = pick(tb)) < 0) {
+		if (!tb->model)
+			tb->model = branch_model(tb);
+		return NULL;
+	}
+	if (!tick(tb->pv))
+		return NULL;
+
+	t = tb->ents[i].t;
+	d = use(tb, i);
+	switch (t->type) {
+	case FORM_OR:
+		return split_or(tb, t, d);
+	case FORM_IMPL:
+		return split_impl(tb, t, d);
+	}
+	return split_and(tb, t, d);
+}
+
+/*
+ * Proves g from the n lines in scope, forms, by a tableau for them and
+ * F g, or T A for a goal -A. Sets model if a branch stays open.
+ */
+struct deriv *tableau(struct prover *pv, struct term **forms, int n,
+		      struct term *g, char **model)
+{
+	struct tableau tb = { 0 };
+	struct term *hyp;
+	struct deriv *r, *d = NULL;
+
+	tb.pv = pv;
+	tb.at[0] = calloc(terms_count(pv->sh->terms), sizeof(*tb.at[0]));
+	tb.at[1] = calloc(terms_count(pv->sh->terms), sizeof(*tb.at[1]));
+	for (int i = 0; i < n; i++)
+		tab_add(&tb, 1, forms[i], mk(pv, HYP, forms[i]), -1);
+	if (g->type == FORM_NOT) {
+		hyp = g->lhs;
+		tab_add(&tb, 1, hyp, mk(pv, HYP, hyp), -1);
+	} else {
+		hyp = neg(pv, g);
+		tab_add(&tb, 0, g, mk(pv, HYP, hyp), -1);
+	}
+
+	if ((r = tab_finish(&tb, 0))) {
+		d = mk(pv, g->type == FORM_NOT ? RULE_NOT_INTR : RULE_PBC, g);
+		box_in(d, hyp, r);
+	} else if (!pv->sh->aborted) {
+		*model = tb.model;
+		tb.model = NULL;
+	}
+	free(tb.model);
+	free(tb.ents);
+	free(tb.at[0]);
+	free(tb.at[1]);
+	return d;
+}
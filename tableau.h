@@ -0,0 +1,25 @@
+#ifndef TABLEAU_H
+#define TABLEAU_H
+
+struct deriv;
+struct prover;
+struct term;
+
+/*
+ * Signed tableaux. T A on a branch comes with a derivation of A and F A
+ * with one of -A, found by term id, so a branch closes on T A and F A by
+ * lookup, giving _|_ by -e. Formulas that do not branch are expanded as
+ * they are added. Of those that do, one with a side already false is
+ * taken first, as it adds the other without branching, and one with a
+ * side already on the branch is satisfied and left alone.
+ *
+ * Closing a branch proves the negation of its side, which then joins the
+ * other branch as a lemma: A by PBC from the branch F A, -A by -i from
+ * the branch T A. Lemmas, and the formulas a branch adds that its
+ * closure uses, are put on lines before the rest of the branch, so that
+ * they are not proved again in each box they are used in.
+ */
+struct deriv *tableau(struct prover *pv, struct term **forms, int n,
+		      struct term *g, char **model);
+
+#endif
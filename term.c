@@ -0,0 +1,217 @@
+#include "term.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "syntax.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define CHUNK 1024
+
+/* Interning is serialized, terms themselves are immutable. */
+struct terms {
+	pthread_mutex_t lock;
+	struct term **table;
+	size_t cap;
+	int count;
+	struct term **chunks;
+	int nchunks;
+};
+
+struct terms *terms_new(void)
+{
+	struct terms *t;
+
+	t = calloc(1, sizeof(*t));
+	pthread_mutex_init(&t->lock, NULL);
+	t->cap = 256;
+	t->table = calloc(t->cap, sizeof(*t->table));
+	return t;
+}
+
+void terms_destroy(struct terms *t)
+{
+	if (!t)
+		return;
+	for (int i = 0; i < t->count; i++)
+		free(t->chunks[i / CHUNK][i % CHUNK].name);
+	for (int i = 0; i < t->nchunks; i++)
+		free(t->chunks[i]);
+	free(t->chunks);
+	free(t->table);
+	pthread_mutex_destroy(&t->lock);
+	free(t);
+}
+
+int terms_count(struct terms *t)
+{
+	int n;
+
+	pthread_mutex_lock(&t->lock);
+	n = t->count;
+	pthread_mutex_unlock(&t->lock);
+	return n;
+}
+
+static uint64_t hash(int type, const char *name, struct term *lhs,
+		     struct term *rhs)
+{
+	uint64_t h = FNV_OFFSET;
+
+	h = (h ^ type) * FNV_PRIME;
+	if (name)
+		for (; *name; name++)
+			h = (h ^ (unsigned char)*name) * FNV_PRIME;
+	if (lhs)
+		h = (h ^ lhs->hash) * FNV_PRIME;
+	if (rhs)
+		h = (h ^ rhs->hash) * FNV_PRIME;
+	return h;
+}
+
+static int same(struct term *term, int type, const char *name,
+		struct term *lhs, struct term *rhs)
+{
+	if (term->type != type || term->lhs != lhs || term->rhs != rhs)
+		return 0;
+	return !name || strcmp(term->name, name) == 0;
+}
+
+static void grow(struct terms *t)
+{
+	struct term **old = t->table;
+	size_t oldcap = t->cap, i;
+
+	t->cap *= 2;
+	t->table = calloc(t->cap, sizeof(*t->table));
+	for (size_t j = 0; j < oldcap; j++) {
+		if (!old[j])
+			continue;
+		for (i = old[j]->hash & (t->cap - 1); t->table[i];
+		     i = (i + 1) & (t->cap - 1)) ;
+		t->table[i] = old[j];
+	}
+	free(old);
+}
+
+static struct term *intern(struct terms *t, int type, const char *name,
+			   struct term *lhs, struct term *rhs)
+{
+	struct term *term;
+	uint64_t h = hash(type, name, lhs, rhs);
+	size_t i;
+
+	pthread_mutex_lock(&t->lock);
+	for (i = h & (t->cap - 1); t->table[i]; i = (i + 1) & (t->cap - 1)) {
+		term = t->table[i];
+		if (term->hash == h && same(term, type, name, lhs, rhs)) {
+			pthread_mutex_unlock(&t->lock);
+			return term;
+		}
+	}
+
+	if (t->count % CHUNK == 0) {
+		t->chunks = realloc(t->chunks,
+				    (t->nchunks + 1) * sizeof(*t->chunks));
+		t->chunks[t->nchunks++] = malloc(CHUNK * sizeof(**t->chunks));
+	}
+	term = &t->chunks[t->count / CHUNK][t->count % CHUNK];
+	term->type = type;
+	term->id = t->count++;
+	term->name = name ? strdup(name) : NULL;
+	term->lhs = lhs;
+	term->rhs = rhs;
+	term->hash = h;
+	t->table[i] = term;
+
+	if (2 * (size_t)t->count > t->cap)
+		grow(t);
+	pthread_mutex_unlock(&t->lock);
+	return term;
+}
+
+struct term *term_atom(struct terms *t, const char *name)
+{
+	return intern(t, FORM_NAME, name, NULL, NULL);
+}
+
+struct term *term_make(struct terms *t, int type, struct term *lhs,
+		       struct term *rhs)
+{
+	return intern(t, type, NULL, lhs, rhs);
+}
+
+struct term *term_from_ast(struct terms *t, struct ast *form)
+{
+	struct term *lhs = NULL, *rhs = NULL;
+
+	if (form->type == FORM_NAME)
+		return term_atom(t, form->text);
+	if (form->lhs)
+		lhs = term_from_ast(t, form->lhs);
+	if (form->rhs)
+		rhs = term_from_ast(t, form->rhs);
+	return term_make(t, form->type, lhs, rhs);
+}
+
+struct ast *term_to_ast(struct term *term)
+{
+	struct ast *form;
+
+	form = calloc(1, sizeof(*form));
+	form->type = term->type;
+	if (term->name)
+		form->text = strdup(term->name);
+	if (term->lhs)
+		form->lhs = term_to_ast(term->lhs);
+	if (term->rhs)
+		form->rhs = term_to_ast(term->rhs);
+	return form;
+}
+
+static void put(FILE *f, struct term *term)
+{
+	const char *op = NULL;
+
+	switch (term->type) {
+	case FORM_NOT:
+		fputs(NOT_STR, f);
+		put(f, term->lhs);
+		return;
+	case FORM_CON:
+		fputs(CON_STR, f);
+		return;
+	case FORM_NAME:
+		fputs(term->name, f);
+		return;
+	case FORM_AND:
+		op = AND_STR;
+		break;
+	case FORM_OR:
+		op = OR_STR;
+		break;
+	case FORM_IMPL:
+		op = IMPL_STR;
+		break;
+	}
+	fputc('(', f);
+	put(f, term->lhs);
+	fprintf(f, " %s ", op);
+	put(f, term->rhs);
+	fputc(')', f);
+}
+
+/* Prints a term in the syntax of print_form, without its length limits. */
+char *term_str(struct term *term)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f;
+
+	f = open_memstream(&buf, &len);
+	put(f, term);
+	fclose(f);
+	return buf;
+}
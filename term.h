@@ -0,0 +1,35 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ast;
+
+/*
+ * Hash-consed formulas: equal formulas are the same term, so they can be
+ * compared by pointer and numbered densely by id. The hash equals
+ * ast_hash of the corresponding formula.
+ */
+struct term {
+	int type;
+	int id;
+	char *name;
+	struct term *lhs;
+	struct term *rhs;
+	uint64_t hash;
+};
+
+struct terms;
+
+struct terms *terms_new(void);
+void terms_destroy(struct terms *t);
+int terms_count(struct terms *t);
+struct term *term_atom(struct terms *t, const char *name);
+struct term *term_make(struct terms *t, int type, struct term *lhs,
+		       struct term *rhs);
+struct term *term_from_ast(struct terms *t, struct ast *form);
+struct ast *term_to_ast(struct term *term);
+char *term_str(struct term *term);
+
+#endif
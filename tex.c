@@ -159,7 +159,7 @@ static int printcmd(FILE *f, struct ast *cmd)
 		fprintf(f, "\\(\\lor i_2\\) ");
 		break;
 	case RULE_OR_ELIM:
-		fprintf(f, "\\(\\lor e_2\\) ");
+		fprintf(f, "\\(\\lor e\\) ");
 		break;
 	case RULE_IMPL_INTR:
 		fprintf(f, "\\(\\to i\\) ");
@@ -188,6 +188,9 @@ static int printcmd(FILE *f, struct ast *cmd)
 	case RULE_COPY:
 		fprintf(f, "copy ");
 		break;
+	case RULE_NAMED:
+		fprintf(f, "%s ", rule->text);
+		break;
 	default:
 		assert(0 && "invalid rule");
 	}
@@ -216,22 +219,18 @@ static int prec(int type)
 
 static int printinps(FILE *f, struct ast *inps)
 {
-	for (;;) {
-		if (inps->type == INPUT_FORM) {
-			inps = inps->rhs;
-			continue;
-		}
-		if (inps->type == INPUT_LINE) {
-			fprintf(f, "%d", inps->start + 1);
-		}
-		if (inps->type == INPUT_BOX) {
-			fprintf(f, "%d-%d", inps->start + 1, inps->end + 1);
-		}
-		inps = inps->rhs;
-		if (inps)
-			fprintf(f, ", ");
+	const char *sep = "";
+
+	/* formula inputs are not shown, they may end the list */
+	for (; inps; inps = inps->rhs) {
+		if (inps->type == INPUT_LINE)
+			fprintf(f, "%s%d", sep, inps->start + 1);
+		else if (inps->type == INPUT_BOX)
+			fprintf(f, "%s%d-%d", sep, inps->start + 1,
+				inps->end + 1);
 		else
-			break;
+			continue;
+		sep = ", ";
 	}
 	return 1;
 }
@@ -0,0 +1,111 @@
+#include "valid.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse.h"
+#include "prog.h"
+#include "cnf.h"
+#include "sat.h"
+
+/* A valuation, vals[k] being the value of atoms[k], as "p = T, q = F". */
+char *valid_describe(const char **atoms, const char *vals, int natoms)
+{
+	char *text = NULL;
+	size_t len;
+	FILE *f;
+
+	f = open_memstream(&text, &len);
+	for (int k = 0; k < natoms; k++)
+		fprintf(f, "%s%s = %c", k ? ", " : "", atoms[k],
+			vals[k] ? 'T' : 'F');
+	fclose(f);
+	return text;
+}
+
+/*
+ * Past the atoms tables handle, goal is valid when the premises and its
+ * negation are unsatisfiable.
+ */
+static int valid_sat(struct ast **prems, int nprems, struct ast *goal,
+		     char **model, char *errbuf, size_t errbufsz)
+{
+	struct cnf *c = cnf_sequent(prems, nprems, goal);
+	struct sat *s = sat_new();
+	char *vals;
+	int res;
+
+	for (int i = 0, j = 0; i < c->nlits; i = ++j) {
+		while (c->lits[j])
+			j++;
+		sat_add(s, c->lits + i, j - i);
+	}
+
+	res = sat_solve(s, VALID_MAX_CONFLICTS);
+	if (res == SAT_UNKNOWN) {
+		snprintf(errbuf, errbufsz, "%d atoms, gave up after %ld "
+			 "conflicts", c->natoms, sat_conflicts(s));
+		res = -1;
+	} else if (res == SAT_SAT) {
+		vals = malloc(c->natoms + 1);
+		for (int k = 0; k < c->natoms; k++)
+			vals[k] = sat_value(s, c->atom_vars[k]);
+		*model = valid_describe(c->atoms, vals, c->natoms);
+		free(vals);
+		res = 0;
+	} else {
+		res = 1;
+	}
+
+	sat_destroy(s);
+	cnf_destroy(c);
+	return res;
+}
+
+int valid(struct ast **prems, int nprems, struct ast *goal, char **model,
+	  char *errbuf, size_t errbufsz)
+{
+	struct ast **forms;
+	struct prog *p;
+	block *regs;
+	lane m[PROG_LANES];
+	char vals[VALID_TABLE_ATOMS];
+	int res = 1, i;
+
+	/* the goal first, a block is done once no counterexample is left */
+	*model = NULL;
+	forms = malloc((nprems + 1) * sizeof(*forms));
+	forms[0] = goal;
+	memcpy(forms + 1, prems, nprems * sizeof(*prems));
+	p = prog_compile(forms, nprems + 1);
+	free(forms);
+
+	if (p->natoms > VALID_TABLE_ATOMS) {
+		prog_destroy(p);
+		return valid_sat(prems, nprems, goal, model, errbuf,
+				 errbufsz);
+	}
+
+	regs = prog_regs(p);
+	for (uint64_t blk = 0; blk < prog_blocks(p) && res == 1; blk++) {
+		prog_set_atoms(p, regs, blk);
+		prog_run(p, 0, p->ends[0], regs);
+		for (int i = 0; i < PROG_LANES; i++)
+			m[i] = ~regs[p->outs[0]][i];
+		for (int f = 1; f <= nprems && prog_any(m); f++) {
+			prog_run(p, p->ends[f - 1], p->ends[f], regs);
+			for (int i = 0; i < PROG_LANES; i++)
+				m[i] &= regs[p->outs[f]][i];
+		}
+
+		if ((i = prog_first(m)) >= 0) {
+			prog_valuation(p, blk, i, vals);
+			*model = valid_describe(p->atoms, vals, p->natoms);
+			res = 0;
+		}
+	}
+
+	free(regs);
+	prog_destroy(p);
+	return res;
+}
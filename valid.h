@@ -0,0 +1,21 @@
+#ifndef VALID_H
+#define VALID_H
+
+#include <stddef.h>
+
+struct ast;
+
+/* Above this many atoms sequents go to the SAT solver. */
+#define VALID_TABLE_ATOMS 20
+#define VALID_MAX_CONFLICTS 1000000
+
+/*
+ * Whether goal holds under every valuation of the atoms that makes all
+ * of prems true. Returns 1 if so, 0 with a falsifying valuation such as
+ * "p = T, q = F" in *model, to be freed, or -1 with a message in errbuf.
+ */
+int valid(struct ast **prems, int nprems, struct ast *goal, char **model,
+	  char *errbuf, size_t errbufsz);
+char *valid_describe(const char **atoms, const char *vals, int natoms);
+
+#endif